@@ -0,0 +1,166 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Compares classifying words of a script with KeywordTable, which finds all word lists a word is in with a single probe,
+// against calling WordList::InList on each word list in turn, the way the lexer did before. Words are the identifiers
+// and symbols of a generated script in order, so keywords and names appear as often as they do in real scripts.
+#include "Measurement.hpp"
+#include "ScriptGenerator.hpp"
+
+#include "LexerHost.hpp"
+
+#include "Plugin/Lexer/KeywordTable.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace papyrus;
+using namespace papyrus::benchmark;
+
+namespace {
+  void printUsage() {
+    std::fprintf(stderr,
+      "Usage: KeywordBenchmark [--help] [--lines N] [--passes N]\n"
+      "  --lines N   lines of generated script words are taken from (default 10000)\n"
+      "  --passes N  passes over all words per measurement (default 20)\n");
+  }
+
+  inline bool isWordChar(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_';
+  }
+
+  // Split lower case script text into words and single character symbols, same as tokens the lexer classifies
+  std::vector<std::string> splitWords(const std::string& text) {
+    std::vector<std::string> words;
+    for (size_t pos = 0; pos < text.size();) {
+      char ch = text[pos];
+      if (isWordChar(ch)) {
+        size_t end = pos;
+        while (end < text.size() && isWordChar(text[end])) {
+          end++;
+        }
+        words.emplace_back(text, pos, end - pos);
+        pos = end;
+      } else {
+        if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n' && static_cast<unsigned char>(ch) < 0x80) {
+          words.emplace_back(1, ch);
+        }
+        pos++;
+      }
+    }
+    return words;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ScriptShape shape;
+  size_t passes = 20;
+  for (int i = 1; i < argc; i++) {
+    std::string_view argument(argv[i]);
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (argument == "--help") {
+      printUsage();
+      return 0;
+    } else if (argument == "--lines" && value) {
+      shape.lineCount = std::strtoull(value, nullptr, 10);
+    } else if (argument == "--passes" && value && std::strtoull(value, nullptr, 10) > 0) {
+      passes = std::strtoull(value, nullptr, 10);
+    } else {
+      std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      printUsage();
+      return 2;
+    }
+    i++;
+  }
+
+  shape.utf8Identifiers = false;
+  std::string text = generateScript(shape);
+  for (char& ch : text) {
+    ch = (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+  }
+  std::vector<std::string> words = splitWords(text);
+
+  const std::vector<const char*>& wordListTexts = LexerHost::wordLists();
+  std::vector<WordList> wordLists(wordListTexts.size());
+  std::vector<WordList*> wordListPointers;
+  for (size_t index = 0; index < wordListTexts.size(); index++) {
+    wordLists[index].Set(wordListTexts[index]);
+    wordListPointers.push_back(&wordLists[index]);
+  }
+  KeywordTable keywordTable;
+  keywordTable.build(wordListPointers);
+
+  // Both ways have to agree on every word before their speed is worth comparing
+  auto classifyWithWordLists = [&wordLists](const std::string& word) {
+    uint32_t mask = 0;
+    for (size_t index = 0; index < wordLists.size(); index++) {
+      if (wordLists[index].InList(word.c_str())) {
+        mask |= 1u << index;
+      }
+    }
+    return mask;
+  };
+  size_t keywordCount = 0;
+  for (const std::string& word : words) {
+    uint32_t mask = keywordTable.find(word);
+    if (mask != classifyWithWordLists(word)) {
+      std::fprintf(stderr, "KeywordTable and word lists disagree on \"%s\"\n", word.c_str());
+      return 1;
+    }
+    keywordCount += (mask != 0) ? 1 : 0;
+  }
+
+  // Masks are summed up and printed, so lookups can't be optimized away
+  uint64_t wordListSum = 0;
+  uint64_t keywordTableSum = 0;
+  std::vector<double> wordListSamples;
+  std::vector<double> keywordTableSamples;
+  for (size_t pass = 0; pass < passes; pass++) {
+    auto startTime = Clock::now();
+    for (const std::string& word : words) {
+      wordListSum += classifyWithWordLists(word);
+    }
+    wordListSamples.push_back(elapsedMicroseconds(startTime));
+
+    startTime = Clock::now();
+    for (const std::string& word : words) {
+      keywordTableSum += keywordTable.find(word);
+    }
+    keywordTableSamples.push_back(elapsedMicroseconds(startTime));
+  }
+
+  double wordListTime = median(wordListSamples);
+  double keywordTableTime = median(keywordTableSamples);
+  double wordCount = static_cast<double>(words.size());
+  std::printf("Words: %zu, %zu distinct, %.1f%% keywords or symbols in word lists\n", words.size(),
+    std::set<std::string>(words.begin(), words.end()).size(), keywordCount * 100.0 / (std::max)(wordCount, 1.0));
+  std::printf("WordList::InList chain: %.1f ns/word (checksum %llu)\n", wordListTime * 1000 / wordCount, static_cast<unsigned long long>(wordListSum));
+  std::printf("KeywordTable::find:     %.1f ns/word (checksum %llu)\n", keywordTableTime * 1000 / wordCount, static_cast<unsigned long long>(keywordTableSum));
+  if (keywordTableTime > 0) {
+    std::printf("Speedup: %.1fx\n", wordListTime / keywordTableTime);
+  }
+  return 0;
+}
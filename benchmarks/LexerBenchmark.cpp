@@ -0,0 +1,357 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Measures how fast the lexer styles scripts: full-document Lex, full-document Fold, and restyling after a single-line
+// edit, the way Notepad++ does it while typing. Scripts are generated with a configurable shape, and/or read from a
+// directory of real scripts. Results are written as JSON or CSV, so they can be tracked over time.
+#include "Measurement.hpp"
+#include "ScriptGenerator.hpp"
+
+#include "LexerHost.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace papyrus;
+using namespace papyrus::benchmark;
+
+namespace {
+  struct Options {
+    ScriptShape shape;
+    bool synthetic {true};
+    std::filesystem::path corpusDirectory;
+    size_t iterations {5};
+    size_t edits {50};
+    size_t lexWorkers {1};
+    std::string format {"json"};
+    std::filesystem::path outputFile;
+    std::filesystem::path savedScriptFile;
+  };
+
+  struct Script {
+    std::string name;
+    std::string text;
+  };
+
+  struct Result {
+    std::string script;
+    size_t lines;
+    size_t bytes;
+    std::string metric;
+    std::vector<double> samples; // In microseconds
+  };
+
+  void printUsage() {
+    std::fprintf(stderr,
+      "Usage: LexerBenchmark [--help] [options]\n"
+      "Synthetic script shape:\n"
+      "  --lines N           number of lines (default 10000)\n"
+      "  --depth N           deepest nesting of If/While blocks (default 4)\n"
+      "  --properties N      number of properties (default 200)\n"
+      "  --doc-lines N       lines of doc comment before each function (default 3)\n"
+      "  --comment-lines N   lines of ;/ /; comment before every fourth function (default 6)\n"
+      "  --ascii             only use ASCII identifiers, strings and comments\n"
+      "  --seed N            random seed (default 1)\n"
+      "  --save-script FILE  also write generated script to FILE\n"
+      "Inputs:\n"
+      "  --corpus DIR        also benchmark every .psc file under DIR\n"
+      "  --no-synthetic      don't benchmark a generated script\n"
+      "Measurement:\n"
+      "  --iterations N      full Lex/Fold runs per script (default 5)\n"
+      "  --edits N           single-line edits per script (default 50)\n"
+      "  --workers N         threads preparing lines of large Lex ranges (default 1, 0 for one per processor core)\n"
+      "Output:\n"
+      "  --format json|csv   output format (default json)\n"
+      "  --output FILE       write results to FILE instead of stdout\n");
+  }
+
+  bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+      std::string_view argument(argv[i]);
+      auto value = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+      auto number = [&](size_t& target) {
+        const char* text = value();
+        if (!text) {
+          return false;
+        }
+        char* end {};
+        target = std::strtoull(text, &end, 10);
+        return *end == '\0';
+      };
+
+      bool valid = true;
+      if (argument == "--lines") {
+        valid = number(options.shape.lineCount);
+      } else if (argument == "--depth") {
+        valid = number(options.shape.nestingDepth);
+      } else if (argument == "--properties") {
+        valid = number(options.shape.propertyCount);
+      } else if (argument == "--doc-lines") {
+        valid = number(options.shape.docCommentLines);
+      } else if (argument == "--comment-lines") {
+        valid = number(options.shape.multiLineCommentLines);
+      } else if (argument == "--ascii") {
+        options.shape.utf8Identifiers = false;
+      } else if (argument == "--seed") {
+        size_t seed {};
+        valid = number(seed);
+        options.shape.seed = static_cast<uint32_t>(seed);
+      } else if (argument == "--save-script") {
+        const char* text = value();
+        valid = (text != nullptr);
+        options.savedScriptFile = valid ? text : "";
+      } else if (argument == "--corpus") {
+        const char* text = value();
+        valid = (text != nullptr);
+        options.corpusDirectory = valid ? text : "";
+      } else if (argument == "--no-synthetic") {
+        options.synthetic = false;
+      } else if (argument == "--iterations") {
+        valid = number(options.iterations) && options.iterations > 0;
+      } else if (argument == "--edits") {
+        valid = number(options.edits);
+      } else if (argument == "--workers") {
+        valid = number(options.lexWorkers);
+      } else if (argument == "--format") {
+        const char* text = value();
+        valid = (text != nullptr) && (std::string_view(text) == "json" || std::string_view(text) == "csv");
+        options.format = valid ? text : "";
+      } else if (argument == "--output") {
+        const char* text = value();
+        valid = (text != nullptr);
+        options.outputFile = valid ? text : "";
+      } else {
+        valid = false;
+      }
+
+      if (!valid) {
+        std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Collect scripts to benchmark. Returns false if corpus can't be read.
+  bool loadScripts(const Options& options, std::vector<Script>& scripts) {
+    if (options.synthetic) {
+      scripts.push_back(Script {
+        .name = "synthetic",
+        .text = generateScript(options.shape)
+      });
+      if (!options.savedScriptFile.empty()) {
+        std::ofstream(options.savedScriptFile, std::ios::binary) << scripts.back().text;
+      }
+    }
+
+    if (!options.corpusDirectory.empty()) {
+      std::error_code ec;
+      std::vector<std::filesystem::path> files;
+      for (auto iter = std::filesystem::recursive_directory_iterator(options.corpusDirectory, ec); !ec && iter != std::filesystem::recursive_directory_iterator(); iter.increment(ec)) {
+        std::string extension = iter->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        if (iter->is_regular_file() && extension == ".psc") {
+          files.push_back(iter->path());
+        }
+      }
+      if (ec) {
+        std::fprintf(stderr, "Can't read corpus directory %s\n", options.corpusDirectory.string().c_str());
+        return false;
+      }
+
+      // Sorted, so results are always in the same order
+      std::sort(files.begin(), files.end());
+      for (const auto& file : files) {
+        std::ifstream stream(file, std::ios::binary);
+        std::stringstream text;
+        text << stream.rdbuf();
+        scripts.push_back(Script {
+          .name = file.lexically_relative(options.corpusDirectory).generic_string(),
+          .text = text.str()
+        });
+      }
+    }
+    return true;
+  }
+
+  void benchmarkScript(const Script& script, const Options& options, std::vector<Result>& results) {
+    size_t lineCount = static_cast<size_t>(std::count(script.text.begin(), script.text.end(), '\n')) + 1;
+    Result lexResult {
+      .script = script.name,
+      .lines = lineCount,
+      .bytes = script.text.size(),
+      .metric = "lex",
+      .samples = {}
+    };
+    Result foldResult = lexResult;
+    foldResult.metric = "fold";
+    Result editResult = lexResult;
+    editResult.metric = "edit_relex";
+
+    // Each run starts from a document never styled by a lexer that has never seen it, same as opening a script
+    for (size_t i = 0; i < options.iterations; i++) {
+      LexerHost host(script.text);
+      host.setLexWorkers(options.lexWorkers);
+      Sci_Position length = host.document().Length();
+      auto startTime = Clock::now();
+      host.lexer().Lex(0, length, 0, &host.document());
+      lexResult.samples.push_back(elapsedMicroseconds(startTime));
+
+      startTime = Clock::now();
+      host.lexer().Fold(0, length, 0, &host.document());
+      foldResult.samples.push_back(elapsedMicroseconds(startTime));
+    }
+
+    // Type a character at the start of lines spread over the document, then delete it, restyling after each edit
+    LexerHost host(script.text);
+    host.setLexWorkers(options.lexWorkers);
+    host.colourise();
+    Sci_Position documentLineCount = host.document().LineFromPosition(host.document().Length()) + 1;
+    for (size_t i = 0; i < options.edits; i++) {
+      Sci_Position line = static_cast<Sci_Position>((i * 7919) % static_cast<size_t>(documentLineCount));
+      Sci_Position position = host.document().LineStart(line);
+      auto startTime = Clock::now();
+      host.insertText(position, "x");
+      editResult.samples.push_back(elapsedMicroseconds(startTime));
+
+      startTime = Clock::now();
+      host.deleteText(position, 1);
+      editResult.samples.push_back(elapsedMicroseconds(startTime));
+    }
+
+    results.push_back(std::move(lexResult));
+    results.push_back(std::move(foldResult));
+    if (!editResult.samples.empty()) {
+      results.push_back(std::move(editResult));
+    }
+  }
+
+  // Sample at the given percentile of sorted samples
+  double percentile(const std::vector<double>& sortedSamples, double value) {
+    size_t index = static_cast<size_t>(value * static_cast<double>(sortedSamples.size() - 1) + 0.5);
+    return sortedSamples[index];
+  }
+
+  std::string escapeJson(const std::string& text) {
+    std::string result;
+    for (char ch : text) {
+      if (ch == '"' || ch == '\\') {
+        result += '\\';
+      }
+      result += ch;
+    }
+    return result;
+  }
+
+  std::string escapeCsv(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+      return text;
+    }
+    std::string result("\"");
+    for (char ch : text) {
+      if (ch == '"') {
+        result += '"';
+      }
+      result += ch;
+    }
+    return result + '"';
+  }
+
+  void writeResults(const std::vector<Result>& results, const std::string& format, std::ostream& stream) {
+    char buffer[256];
+    if (format == "csv") {
+      stream << "script,lines,bytes,metric,samples,min_us,median_us,p95_us,max_us,lines_per_second\n";
+    } else {
+      stream << "{\n  \"benchmark\": \"lexer\",\n  \"results\": [";
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result& result = results[i];
+      std::vector<double> samples = result.samples;
+      std::sort(samples.begin(), samples.end());
+      double median = percentile(samples, 0.5);
+
+      // Edits restyle a few lines, so only full-document runs have meaningful throughput
+      double linesPerSecond = (result.metric == "edit_relex" || median <= 0) ? 0 : static_cast<double>(result.lines) * 1e6 / median;
+      if (format == "csv") {
+        std::snprintf(buffer, sizeof(buffer), ",%zu,%zu,%s,%zu,%.1f,%.1f,%.1f,%.1f,%.0f\n",
+          result.lines, result.bytes, result.metric.c_str(), samples.size(), samples.front(), median, percentile(samples, 0.95), samples.back(), linesPerSecond);
+        stream << escapeCsv(result.script) << buffer;
+      } else {
+        std::snprintf(buffer, sizeof(buffer),
+          "\", \"lines\": %zu, \"bytes\": %zu, \"metric\": \"%s\", \"samples\": %zu, "
+          "\"min_us\": %.1f, \"median_us\": %.1f, \"p95_us\": %.1f, \"max_us\": %.1f, \"lines_per_second\": %.0f}",
+          result.lines, result.bytes, result.metric.c_str(), samples.size(), samples.front(), median, percentile(samples, 0.95), samples.back(), linesPerSecond);
+        stream << ((i == 0) ? "\n" : ",\n") << "    {\"script\": \"" << escapeJson(result.script) << buffer;
+      }
+    }
+
+    if (format != "csv") {
+      stream << "\n  ]\n}\n";
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string_view(argv[1]) == "--help") {
+    printUsage();
+    return 0;
+  }
+
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 2;
+  }
+
+  std::vector<Script> scripts;
+  if (!loadScripts(options, scripts)) {
+    return 1;
+  }
+  if (scripts.empty()) {
+    std::fprintf(stderr, "No script to benchmark\n");
+    return 1;
+  }
+
+  std::vector<Result> results;
+  for (const auto& script : scripts) {
+    benchmarkScript(script, options, results);
+  }
+
+  if (options.outputFile.empty()) {
+    writeResults(results, options.format, std::cout);
+  } else {
+    std::ofstream stream(options.outputFile);
+    writeResults(results, options.format, stream);
+    if (!stream) {
+      std::fprintf(stderr, "Can't write results to %s\n", options.outputFile.string().c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace papyrus::benchmark {
+
+  using Clock = std::chrono::steady_clock;
+
+  // Microseconds elapsed since given start time
+  inline double elapsedMicroseconds(Clock::time_point startTime) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
+  }
+
+  // Median of samples, or 0 if there isn't any
+  inline double median(std::vector<double> samples) {
+    if (samples.empty()) {
+      return 0;
+    }
+    auto middle = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), middle, samples.end());
+    return *middle;
+  }
+
+} // namespace
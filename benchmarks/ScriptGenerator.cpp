@@ -0,0 +1,287 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ScriptGenerator.hpp"
+
+#include <iterator>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace papyrus::benchmark {
+
+  namespace {
+    // Suffixes making identifiers non-ASCII. Papyrus compiler doesn't accept them, but lexer still sees them in scripts
+    // being written, and in strings and comments.
+    const char* const utf8Suffixes[] {
+      "Größe",
+      "Ñandú",
+      "Ωmega",
+      "Пример",
+      "魔法"
+    };
+
+    const char* const typeNames[] {
+      "Int",
+      "Float",
+      "Bool",
+      "String",
+      "Actor",
+      "ObjectReference"
+    };
+
+    class ScriptGenerator {
+      public:
+        explicit ScriptGenerator(const ScriptShape& shape)
+          : shape(shape), random(shape.seed) {
+        }
+
+        std::string generate() {
+          line("Scriptname GeneratedScript extends Quest Conditional");
+          line("{ Generated script used to benchmark the lexer }");
+          line("");
+          line("Import Debug");
+          line("Import Utility");
+          line("");
+          for (size_t index = 0; index < shape.propertyCount && lineCount < shape.lineCount; index++) {
+            property(index);
+          }
+          line("");
+
+          for (size_t index = 0; lineCount < shape.lineCount; index++) {
+            if (index % 10 == 9) {
+              state(index);
+            } else {
+              function(index);
+            }
+            line("");
+          }
+          return text;
+        }
+
+      private:
+        void line(std::string_view content) {
+          text.append(indent * 2, ' ');
+          text.append(content);
+          text += '\n';
+          lineCount++;
+        }
+
+        size_t pick(size_t count) {
+          return std::uniform_int_distribution<size_t>(0, count - 1)(random);
+        }
+
+        std::string identifier(std::string_view name, size_t index) {
+          std::string result(name);
+          result += std::to_string(index);
+          if (shape.utf8Identifiers && pick(4) == 0) {
+            result += utf8Suffixes[pick(std::size(utf8Suffixes))];
+          }
+          return result;
+        }
+
+        // Name of a declared property of the given type index, if there is any
+        std::string propertyName(size_t typeIndex) {
+          if (shape.propertyCount < 3) {
+            return "value";
+          }
+          size_t index = pick(shape.propertyCount / 3) * 3 + typeIndex;
+          return (index < shape.propertyCount) ? propertyNames[index] : "value";
+        }
+
+        void property(size_t index) {
+          switch (index % 3) {
+            case 0: {
+              std::string name = identifier("Count", index);
+              propertyNames.push_back(name);
+              line("Int Property " + name + " = " + std::to_string(index) + " Auto");
+              break;
+            }
+
+            case 1: {
+              std::string name = identifier("Target", index);
+              propertyNames.push_back(name);
+              line("Actor Property " + name + " Auto Hidden Conditional ; Set by quest alias");
+              break;
+            }
+
+            default: {
+              std::string name = identifier("Speed", index);
+              std::string variable = "speed" + std::to_string(index);
+              propertyNames.push_back(name);
+              line("Float " + variable + " = 1.5");
+              line("Float Property " + name + " Hidden");
+              indent++;
+              line("Float Function Get()");
+              indent++;
+              line("Return " + variable);
+              indent--;
+              line("EndFunction");
+              line("Function Set(Float value)");
+              indent++;
+              line(variable + " = value");
+              indent--;
+              line("EndFunction");
+              indent--;
+              line("EndProperty");
+              break;
+            }
+          }
+        }
+
+        void docComment(size_t index) {
+          if (shape.docCommentLines == 1) {
+            line("{ Handles step " + std::to_string(index) + " of the quest }");
+          } else if (shape.docCommentLines > 1) {
+            line("{ Handles step " + std::to_string(index) + " of the quest.");
+            for (size_t i = 2; i < shape.docCommentLines; i++) {
+              line("  Details about parameters, side effects and return value, line " + std::to_string(i) + ".");
+            }
+            line("}");
+          }
+        }
+
+        void multiLineComment(size_t index) {
+          if (shape.multiLineCommentLines > 0) {
+            line(";/ Disabled implementation of step " + std::to_string(index));
+            for (size_t i = 2; i < shape.multiLineCommentLines; i++) {
+              line("  value = value * " + std::to_string(i) + " ; kept for reference \"quoted\" text");
+            }
+            line("/;");
+          }
+        }
+
+        void function(size_t index) {
+          if (index % 4 == 0) {
+            multiLineComment(index);
+          }
+          docComment(index);
+
+          bool isEvent = (index % 5 == 4);
+          if (isEvent) {
+            line("Event " + identifier("OnStep", index) + "(ObjectReference akSender, Int aiValue)");
+          } else {
+            line(std::string(typeNames[index % 4]) + " Function " + identifier("Compute", index) + "(Int value, Float factor = 1.5, String label = \"text\") Global");
+          }
+          indent++;
+          line("Int[] items = new Int[16]");
+          line("Int i = 0");
+          block(1);
+          if (!isEvent) {
+            line((index % 4 == 3) ? "Return label + \" done\"" : "Return value");
+          }
+          indent--;
+          line(isEvent ? "EndEvent" : "EndFunction");
+        }
+
+        void state(size_t index) {
+          line("State " + identifier("Busy", index));
+          indent++;
+          docComment(index);
+          line("Event OnBeginState()");
+          indent++;
+          line("RegisterForSingleUpdate(" + std::to_string(index) + ".0)");
+          block(1);
+          indent--;
+          line("EndEvent");
+          indent--;
+          line("EndState");
+        }
+
+        void block(size_t depth) {
+          size_t statementCount = 2 + pick(4);
+          for (size_t i = 0; i < statementCount; i++) {
+            statement();
+          }
+
+          if (depth <= shape.nestingDepth) {
+            if (pick(2) == 0) {
+              line("If value > " + std::to_string(pick(100)) + " && " + propertyName(0) + " != 0");
+              indent++;
+              block(depth + 1);
+              indent--;
+              line("ElseIf value < 0 || !(factor as Bool)");
+              indent++;
+              statement();
+              indent--;
+              line("Else");
+              indent++;
+              block(depth + 1);
+              indent--;
+              line("EndIf");
+            } else {
+              line("While i < items.Length");
+              indent++;
+              block(depth + 1);
+              line("i += 1");
+              indent--;
+              line("EndWhile");
+            }
+          }
+        }
+
+        void statement() {
+          switch (pick(7)) {
+            case 0:
+              line("value += " + propertyName(0) + " * " + std::to_string(pick(1000)) + " ; Scale by count");
+              break;
+
+            case 1:
+              line("String message = \"Value of \" + label + \" is \" + value");
+              break;
+
+            case 2:
+              line(propertyName(1) + ".MoveTo(Game.GetPlayer(), 0.0, 0.0, 128.0)");
+              break;
+
+            case 3:
+              line(std::string("Debug.Trace(\"Step finished: ") + (shape.utf8Identifiers ? utf8Suffixes[pick(std::size(utf8Suffixes))] : "none") + "\")");
+              break;
+
+            case 4:
+              line("items[i] = (value / 2) as Int");
+              break;
+
+            case 5:
+              line("factor = " + propertyName(2) + " * 0." + std::to_string(pick(100)) + " - 1.0");
+              break;
+
+            default:
+              line("Wait(0.5)");
+              break;
+          }
+        }
+
+        // Private members
+        //
+        const ScriptShape& shape;
+        std::mt19937 random;
+        std::string text;
+        size_t lineCount {0};
+        size_t indent {0};
+        std::vector<std::string> propertyNames;
+    };
+  }
+
+  std::string generateScript(const ScriptShape& shape) {
+    return ScriptGenerator(shape).generate();
+  }
+
+} // namespace
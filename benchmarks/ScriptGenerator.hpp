@@ -0,0 +1,44 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace papyrus::benchmark {
+
+  // Shape of a generated Papyrus script. Scripts are made of properties followed by functions, events and states, until
+  // they reach the given number of lines.
+  struct ScriptShape {
+    size_t lineCount {10000};
+    size_t nestingDepth {4};           // Deepest nesting of If and While blocks in function bodies
+    size_t propertyCount {200};
+    size_t docCommentLines {3};        // Lines of { } doc comment before each function and event
+    size_t multiLineCommentLines {6};  // Lines of ;/ /; comment before every fourth function
+    bool utf8Identifiers {true};       // Mix identifiers, strings and comments with non-ASCII characters
+    uint32_t seed {1};
+  };
+
+  // Generate a script of the given shape. The same shape always generates the same script.
+  std::string generateScript(const ScriptShape& shape);
+
+} // namespace
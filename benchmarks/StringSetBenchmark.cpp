@@ -0,0 +1,177 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Compares looking up names in FlatStringSet, which the lexer keeps property names in, against std::set. Names are
+// looked up the way the lexer does it: every identifier of a generated script that isn't a keyword is probed, in order,
+// in a set of the names the script defines properties with.
+#include "Measurement.hpp"
+#include "ScriptGenerator.hpp"
+
+#include "LexerHost.hpp"
+
+#include "Plugin/Lexer/FlatStringSet.hpp"
+#include "Plugin/Lexer/KeywordTable.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace papyrus;
+using namespace papyrus::benchmark;
+
+namespace {
+  void printUsage() {
+    std::fprintf(stderr,
+      "Usage: StringSetBenchmark [--help] [--lines N] [--properties N] [--passes N]\n"
+      "  --lines N       lines of generated script names are taken from (default 10000)\n"
+      "  --properties N  properties defined by the script (default 200)\n"
+      "  --passes N      passes over all names per measurement (default 20)\n");
+  }
+
+  // Same as the tokenizer, non-ASCII characters are part of identifiers
+  inline bool isNameChar(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '_' || static_cast<unsigned char>(ch) >= 0x80;
+  }
+
+  // Split lower case script text into identifiers, skipping numbers
+  std::vector<std::string_view> splitNames(std::string_view text) {
+    std::vector<std::string_view> names;
+    for (size_t pos = 0; pos < text.size();) {
+      if (isNameChar(text[pos])) {
+        size_t end = pos;
+        while (end < text.size() && isNameChar(text[end])) {
+          end++;
+        }
+        if (text[pos] < '0' || text[pos] > '9') {
+          names.push_back(text.substr(pos, end - pos));
+        }
+        pos = end;
+      } else {
+        pos++;
+      }
+    }
+    return names;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ScriptShape shape;
+  size_t passes = 20;
+  for (int i = 1; i < argc; i++) {
+    std::string_view argument(argv[i]);
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (argument == "--help") {
+      printUsage();
+      return 0;
+    } else if (argument == "--lines" && value) {
+      shape.lineCount = std::strtoull(value, nullptr, 10);
+    } else if (argument == "--properties" && value) {
+      shape.propertyCount = std::strtoull(value, nullptr, 10);
+    } else if (argument == "--passes" && value && std::strtoull(value, nullptr, 10) > 0) {
+      passes = std::strtoull(value, nullptr, 10);
+    } else {
+      std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      printUsage();
+      return 2;
+    }
+    i++;
+  }
+
+  std::string text = generateScript(shape);
+  for (char& ch : text) {
+    ch = (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+  }
+  std::vector<std::string_view> identifiers = splitNames(text);
+
+  // Keywords are styled without looking them up in property names
+  std::vector<WordList> wordLists(LexerHost::wordLists().size());
+  std::vector<WordList*> wordListPointers;
+  for (size_t index = 0; index < wordLists.size(); index++) {
+    wordLists[index].Set(LexerHost::wordLists()[index]);
+    wordListPointers.push_back(&wordLists[index]);
+  }
+  KeywordTable keywordTable;
+  keywordTable.build(wordListPointers);
+
+  std::vector<std::string_view> names;
+  FlatStringSet flatSet;
+  std::set<std::string> treeSet;
+  std::set<std::string, std::less<>> transparentTreeSet;
+  for (size_t index = 0; index < identifiers.size(); index++) {
+    if (keywordTable.find(identifiers[index]) != 0) {
+      continue;
+    }
+    names.push_back(identifiers[index]);
+    if (index > 0 && identifiers[index - 1] == "property") {
+      flatSet.insert(identifiers[index]);
+      treeSet.emplace(identifiers[index]);
+      transparentTreeSet.emplace(identifiers[index]);
+    }
+  }
+
+  // All sets have to find the same names before their speed is worth comparing
+  size_t hits = 0;
+  for (std::string_view name : names) {
+    bool found = flatSet.contains(name);
+    if (found != (treeSet.count(std::string(name)) > 0) || found != (transparentTreeSet.find(name) != transparentTreeSet.end())) {
+      std::fprintf(stderr, "Sets disagree on \"%.*s\"\n", static_cast<int>(name.size()), name.data());
+      return 1;
+    }
+    hits += found ? 1 : 0;
+  }
+
+  // Hits are counted and printed, so lookups can't be optimized away
+  size_t checksum = 0;
+  std::vector<double> treeSamples;
+  std::vector<double> transparentTreeSamples;
+  std::vector<double> flatSamples;
+  for (size_t pass = 0; pass < passes; pass++) {
+    auto startTime = Clock::now();
+    for (std::string_view name : names) {
+      checksum += treeSet.count(std::string(name));
+    }
+    treeSamples.push_back(elapsedMicroseconds(startTime));
+
+    startTime = Clock::now();
+    for (std::string_view name : names) {
+      checksum += (transparentTreeSet.find(name) != transparentTreeSet.end()) ? 1 : 0;
+    }
+    transparentTreeSamples.push_back(elapsedMicroseconds(startTime));
+
+    startTime = Clock::now();
+    for (std::string_view name : names) {
+      checksum += flatSet.contains(name) ? 1 : 0;
+    }
+    flatSamples.push_back(elapsedMicroseconds(startTime));
+  }
+
+  double nameCount = static_cast<double>((std::max)(names.size(), size_t(1)));
+  std::printf("Set: %zu property names. Probes: %zu names, %.1f%% found (checksum %zu)\n", flatSet.size(), names.size(),
+    hits * 100.0 / nameCount, checksum);
+  std::printf("std::set<std::string>, string per probe: %.1f ns/probe\n", median(treeSamples) * 1000 / nameCount);
+  std::printf("std::set<std::string, std::less<>>:      %.1f ns/probe\n", median(transparentTreeSamples) * 1000 / nameCount);
+  std::printf("FlatStringSet:                           %.1f ns/probe\n", median(flatSamples) * 1000 / nameCount);
+  return 0;
+}
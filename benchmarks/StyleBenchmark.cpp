@@ -0,0 +1,109 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Measures how many style runs the lexer writes and how long styling takes per 10k lines. Runs written are compared with
+// style transitions in the styled document, which is the fewest runs possible, and with tokens, since styling each token
+// on its own writes at least one run per token.
+#include "Measurement.hpp"
+#include "ScriptGenerator.hpp"
+
+#include "LexerHost.hpp"
+
+#include "Plugin/Lexer/LexerIDs.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace papyrus;
+using namespace papyrus::benchmark;
+
+namespace {
+  void printUsage() {
+    std::fprintf(stderr,
+      "Usage: StyleBenchmark [--help] [--lines N] [--iterations N]\n"
+      "  --lines N       lines of generated script (default 10000)\n"
+      "  --iterations N  runs, of which the median is reported (default 5)\n");
+  }
+
+  // Number of positions where style differs from the one before
+  size_t countTransitions(const std::string& styles) {
+    size_t transitions = 0;
+    for (size_t index = 1; index < styles.size(); index++) {
+      transitions += (styles[index] != styles[index - 1]) ? 1 : 0;
+    }
+    return transitions;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ScriptShape shape;
+  size_t iterations = 5;
+  for (int i = 1; i < argc; i++) {
+    std::string_view argument(argv[i]);
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (argument == "--help") {
+      printUsage();
+      return 0;
+    } else if (argument == "--lines" && value) {
+      shape.lineCount = std::strtoull(value, nullptr, 10);
+    } else if (argument == "--iterations" && value && std::strtoull(value, nullptr, 10) > 0) {
+      iterations = std::strtoull(value, nullptr, 10);
+    } else {
+      std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      printUsage();
+      return 2;
+    }
+    i++;
+  }
+
+  std::string text = generateScript(shape);
+  std::vector<double> lexSamples;
+  std::vector<double> restyleSamples;
+  Lexer::Statistics statistics {};
+  size_t transitions = 0;
+  for (size_t i = 0; i < iterations; i++) {
+    LexerHost host(text);
+    auto startTime = Clock::now();
+    host.lexer().Lex(0, host.document().Length(), 0, &host.document());
+    lexSamples.push_back(elapsedMicroseconds(startTime));
+    statistics = host.statistics();
+    transitions = countTransitions(host.document().styles(0, host.document().Length()));
+
+    // A new property may change styles of names on any line, so the whole script is styled again from token cache
+    SCNotification notification = host.document().insertText(0, "Int Property StyleBenchmarkProbe Auto\n");
+    host.lexer().PrivateCall(PAPYRUS_LEXER_CALL_DOCUMENT_MODIFIED, &notification);
+    startTime = Clock::now();
+    host.lexer().Lex(0, host.document().Length(), 0, &host.document());
+    restyleSamples.push_back(elapsedMicroseconds(startTime));
+  }
+
+  double linesIn10k = static_cast<double>(statistics.lexTiming.lines) / 10000;
+  std::printf("Script: %zu lines, %zu bytes, %zu tokens\n", statistics.lexTiming.lines, text.size(), statistics.tokensScanned);
+  std::printf("Style runs written: %zu, %.2f per token\n", statistics.styleRuns,
+    static_cast<double>(statistics.styleRuns) / static_cast<double>((std::max)(statistics.tokensScanned, size_t(1))));
+  std::printf("Style transitions in document: %zu\n", transitions);
+  std::printf("Lex with empty token cache: %.2f ms per 10k lines\n", median(lexSamples) / 1000 / linesIn10k);
+  std::printf("Lex from token cache:       %.2f ms per 10k lines\n", median(restyleSamples) / 1000 / linesIn10k);
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Measures how fast the lexer tokenizes a large script read through an in-memory document. Each run lexes the script
+// with an empty token cache, so every line is tokenized, then adds a property on top, which restyles the whole script
+// with every line found in token cache. Time spent tokenizing is the difference between the two.
+#include "Measurement.hpp"
+#include "ScriptGenerator.hpp"
+
+#include "LexerHost.hpp"
+
+#include "Plugin/Lexer/LexerIDs.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace papyrus;
+using namespace papyrus::benchmark;
+
+namespace {
+  void printUsage() {
+    std::fprintf(stderr,
+      "Usage: TokenizerBenchmark [--help] [--lines N] [--script FILE] [--iterations N]\n"
+      "  --lines N       lines of generated script (default 10000)\n"
+      "  --script FILE   tokenize FILE instead of a generated script\n"
+      "  --iterations N  runs, of which the median is reported (default 5)\n");
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ScriptShape shape;
+  std::filesystem::path scriptFile;
+  size_t iterations = 5;
+  for (int i = 1; i < argc; i++) {
+    std::string_view argument(argv[i]);
+    const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (argument == "--help") {
+      printUsage();
+      return 0;
+    } else if (argument == "--lines" && value) {
+      shape.lineCount = std::strtoull(value, nullptr, 10);
+    } else if (argument == "--script" && value) {
+      scriptFile = value;
+    } else if (argument == "--iterations" && value && std::strtoull(value, nullptr, 10) > 0) {
+      iterations = std::strtoull(value, nullptr, 10);
+    } else {
+      std::fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+      printUsage();
+      return 2;
+    }
+    i++;
+  }
+
+  std::string text;
+  if (scriptFile.empty()) {
+    text = generateScript(shape);
+  } else {
+    std::ifstream stream(scriptFile, std::ios::binary);
+    std::stringstream content;
+    content << stream.rdbuf();
+    text = content.str();
+    if (!stream) {
+      std::fprintf(stderr, "Can't read %s\n", scriptFile.string().c_str());
+      return 1;
+    }
+  }
+
+  std::vector<double> coldSamples;
+  std::vector<double> warmSamples;
+  Lexer::Statistics coldStatistics {};
+  for (size_t i = 0; i < iterations; i++) {
+    // Lines are prepared on this thread only, so the rate is what a single thread tokenizes
+    LexerHost host(text);
+    host.setLexWorkers(1);
+    auto startTime = Clock::now();
+    host.lexer().Lex(0, host.document().Length(), 0, &host.document());
+    coldSamples.push_back(elapsedMicroseconds(startTime));
+    coldStatistics = host.statistics();
+
+    // A new property may change styles of names on any line, so lexing doesn't stop early
+    SCNotification notification = host.document().insertText(0, "Int Property TokenizerBenchmarkProbe Auto\n");
+    host.lexer().PrivateCall(PAPYRUS_LEXER_CALL_DOCUMENT_MODIFIED, &notification);
+    startTime = Clock::now();
+    host.lexer().Lex(0, host.document().Length(), 0, &host.document());
+    warmSamples.push_back(elapsedMicroseconds(startTime));
+  }
+
+  double coldTime = median(coldSamples);
+  double warmTime = median(warmSamples);
+  double tokenizeTime = coldTime - warmTime;
+  std::printf("Script: %zu lines, %zu bytes, %zu tokens\n", coldStatistics.tokenCacheMisses, text.size(), coldStatistics.tokensScanned);
+  std::printf("Lex with empty token cache: %.1f ms\n", coldTime / 1000);
+  std::printf("Lex from token cache:       %.1f ms\n", warmTime / 1000);
+  if (tokenizeTime > 0) {
+    std::printf("Tokenize:                   %.1f ms, %.0f tokens/s, %.0f lines/s\n", tokenizeTime / 1000,
+      static_cast<double>(coldStatistics.tokensScanned) * 1e6 / tokenizeTime, static_cast<double>(coldStatistics.tokenCacheMisses) * 1e6 / tokenizeTime);
+  } else {
+    std::printf("Tokenize:                   too fast to tell apart from styling\n");
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BinaryFile.hpp"
+
+#include <system_error>
+
+namespace utility {
+
+  BinaryFileReader::BinaryFileReader(const std::filesystem::path& filePath) {
+    std::error_code ec;
+    fileSize = std::filesystem::file_size(filePath, ec);
+    if (!ec) {
+      stream.open(filePath, std::ios::binary);
+      isOpen = stream.is_open();
+    }
+  }
+
+  uintmax_t BinaryFileReader::bytesLeft() {
+    std::streamoff position = stream.tellg();
+    return (position < 0 || static_cast<uintmax_t>(position) > fileSize) ? 0 : fileSize - static_cast<uintmax_t>(position);
+  }
+
+  bool BinaryFileReader::readBytes(void* data, size_t size) {
+    return isOpen && static_cast<bool>(stream.read(static_cast<char*>(data), static_cast<std::streamsize>(size)));
+  }
+
+  bool BinaryFileReader::readString(std::wstring& value) {
+    uint32_t length {};
+    if (!read(length) || length > bytesLeft() / sizeof(wchar_t)) {
+      return false;
+    }
+    value.assign(length, L'\0');
+    return readBytes(value.data(), length * sizeof(wchar_t));
+  }
+
+  BinaryFileWriter::BinaryFileWriter(const std::filesystem::path& filePath)
+    : filePath(filePath), tempFilePath(std::filesystem::path(filePath) += L".tmp"), stream(tempFilePath, std::ios::binary | std::ios::trunc) {
+  }
+
+  BinaryFileWriter::~BinaryFileWriter() {
+    if (!committed) {
+      stream.close();
+      std::error_code ec;
+      std::filesystem::remove(tempFilePath, ec);
+    }
+  }
+
+  void BinaryFileWriter::writeBytes(const void* data, size_t size) {
+    stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+  }
+
+  void BinaryFileWriter::writeString(const std::wstring& value) {
+    write<uint32_t>(static_cast<uint32_t>(value.size()));
+    writeBytes(value.data(), value.size() * sizeof(wchar_t));
+  }
+
+  bool BinaryFileWriter::commit() {
+    stream.close();
+    if (!stream) {
+      return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempFilePath, filePath, ec);
+    committed = !ec;
+    return committed;
+  }
+
+} // namespace
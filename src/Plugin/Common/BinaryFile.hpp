@@ -0,0 +1,88 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace utility {
+
+  // Reads a binary file of values in native byte order. Lengths and counts read from the file should be checked against
+  // bytesLeft() before anything is allocated for them, so a corrupt file is treated the same as a missing one instead of
+  // exhausting memory.
+  //
+  class BinaryFileReader {
+    public:
+      explicit BinaryFileReader(const std::filesystem::path& filePath);
+
+      // If the file is open and everything so far has been read
+      inline explicit operator bool() const { return isOpen && static_cast<bool>(stream); }
+
+      // Number of bytes left in the file
+      uintmax_t bytesLeft();
+
+      template <typename T>
+      inline bool read(T& value) { return readBytes(&value, sizeof(T)); }
+
+      bool readBytes(void* data, size_t size);
+
+      // Read a string written by BinaryFileWriter::writeString(), checking its length against bytes left first
+      bool readString(std::wstring& value);
+
+    private:
+      std::ifstream stream;
+      uintmax_t fileSize {};
+      bool isOpen {false};
+  };
+
+  // Writes values in native byte order to a temporary file, which only replaces the target file once everything has been
+  // written, so an interrupted save never leaves a truncated file behind.
+  //
+  class BinaryFileWriter {
+    public:
+      explicit BinaryFileWriter(const std::filesystem::path& filePath);
+
+      // Temporary file is removed if it hasn't been committed
+      ~BinaryFileWriter();
+
+      BinaryFileWriter(const BinaryFileWriter&) = delete;
+      BinaryFileWriter& operator=(const BinaryFileWriter&) = delete;
+
+      template <typename T>
+      inline void write(T value) { writeBytes(&value, sizeof(T)); }
+
+      void writeBytes(const void* data, size_t size);
+
+      // Write a string as uint32 length followed by wchar_t units
+      void writeString(const std::wstring& value);
+
+      // Replace target file with what has been written. Returns false if anything failed to be written.
+      bool commit();
+
+    private:
+      std::filesystem::path filePath;
+      std::filesystem::path tempFilePath;
+      std::ofstream stream;
+      bool committed {false};
+  };
+
+} // namespace
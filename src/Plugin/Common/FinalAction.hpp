@@ -18,6 +18,7 @@
 #pragma once
 
 #include <functional>
+#include <utility>
 
 // This class is modified from Microsoft's gsl::util.
 // The major change is to remove the use of template to reduce the number of generated
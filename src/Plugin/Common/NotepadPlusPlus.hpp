@@ -19,7 +19,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 using npp_view_t      = int;
 using npp_lang_type_t = int;
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 
 #include <functional>
+#include <utility>
 #include <vector>
 
 namespace utility {
@@ -39,9 +39,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PPM_COMPILER_NOT_FOUND    (WM_USER + 3)
 #define PPM_OTHER_ERROR           (WM_USER + 4)
 #define PPM_JUMP_TO_ERROR         (WM_USER + 5)
+#define PPM_CLASS_NAMES_UPDATED   (WM_USER + 6)
+#define PPM_RESTYLE_DOCUMENTS     (WM_USER + 7)
+#define PPM_COMPILATION_PROGRESS  (WM_USER + 8)
 
 #define PARAM_COMPILATION_ONLY                0
 #define PARAM_COMPILATION_WITH_ANONYMIZATION  1
+#define PARAM_COMPILATION_FROM_CACHE          2
+#define PARAM_COMPILATION_UP_TO_DATE          3
 
 //
 // Resources
@@ -85,6 +90,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IDC_SETTINGS_LEXER_SCRIPT_GROUP                   (IDC_SETTINGS_TAB_LEXER + 1)
 #define IDC_SETTINGS_LEXER_FOLDMIDDLE                     (IDC_SETTINGS_TAB_LEXER + 2)
 #define IDC_SETTINGS_LEXER_CLASSNAMECACHING               (IDC_SETTINGS_TAB_LEXER + 3)
+#define IDC_SETTINGS_LEXER_CLASSNAMECACHE_SIZE_LABEL      (IDC_SETTINGS_TAB_LEXER + 4)
+#define IDC_SETTINGS_LEXER_CLASSNAMECACHE_SIZE            (IDC_SETTINGS_TAB_LEXER + 5)
 
 #define IDC_SETTINGS_TAB_ERROR_ANNOTATOR                  (IDD_SETTINGS_DIALOG + 200)
 #define IDC_SETTINGS_ANNOTATOR_ANNOTATION_GROUP           (IDC_SETTINGS_TAB_ERROR_ANNOTATOR + 1)
@@ -108,6 +115,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define IDC_SETTINGS_COMPILER_RADIO_SSE                   (IDC_SETTINGS_TAB_COMPILER + 4)
 #define IDC_SETTINGS_COMPILER_RADIO_FO4                   (IDC_SETTINGS_TAB_COMPILER + 5)
 #define IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE      (IDC_SETTINGS_TAB_COMPILER + 6)
+#define IDC_SETTINGS_COMPILER_SKIP_UP_TO_DATE_SCRIPTS     (IDC_SETTINGS_TAB_COMPILER + 7)
 #define IDC_SETTINGS_COMPILER_AUTO_DEFAULT_GAME_LABEL     (IDC_SETTINGS_TAB_COMPILER + 31)
 #define IDC_SETTINGS_COMPILER_AUTO_DEFAULT_GAME_DROPDOWN  (IDC_SETTINGS_TAB_COMPILER + 32)
 #define IDC_SETTINGS_COMPILER_AUTO_DEFAULT_OUTPUT_LABEL   (IDC_SETTINGS_TAB_COMPILER + 33)
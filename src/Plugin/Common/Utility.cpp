@@ -73,86 +73,6 @@ namespace utility {
     return strStream.str();
   }
 
-  // String utilites
-  //
-  bool compare(const std::string& str1, const std::string& str2, bool ignoreCase) noexcept {
-    if (str1.length() != str2.length()) {
-      return false;
-    }
-
-    if (!ignoreCase) {
-      return str1.compare(str2) == 0;
-    }
-
-    return std::equal(str1.begin(), str1.end(), str2.begin(), str2.end(),
-      [](const char ch1, const char ch2) {
-        return toupper(ch1) == toupper(ch2);
-      }
-    );
-  }
-
-  bool compare(const std::wstring& str1, const std::wstring& str2, bool ignoreCase) noexcept {
-    if (str1.length() != str2.length()) {
-      return false;
-    }
-
-    if (!ignoreCase) {
-      return str1.compare(str2) == 0;
-    }
-
-    return std::equal(str1.begin(), str1.end(), str2.begin(), str2.end(),
-      [](const wchar_t ch1, const wchar_t ch2) {
-        return towupper(ch1) == towupper(ch2);
-      }
-    );
-  }
-
-  bool startsWith(const std::wstring& str1, const std::wstring& str2, bool ignoreCase) noexcept {
-    if (str1.length() < str2.length()) {
-      return false;
-    }
-
-    return compare(str1.substr(0, str2.length()), str2, ignoreCase);
-  }
-
-  bool endsWith(const std::wstring& str1, const std::wstring& str2, bool ignoreCase) noexcept {
-    if (str1.length() < str2.length()) {
-      return false;
-    }
-
-    return compare(str1.substr(str1.length() - str2.length(), std::string::npos), str2, ignoreCase);
-  }
-
-  size_t findIndex(const std::wstring& str1, const std::wstring& str2, bool ignoreCase) noexcept {
-    if (!ignoreCase) {
-      return str1.find(str2);
-    }
-
-    auto iter = std::search(str1.begin(), str1.end(), str2.begin(), str2.end(),
-      [](const wchar_t ch1, const wchar_t ch2) {
-        return towupper(ch1) == towupper(ch2);
-      }
-    );
-
-    if (iter != str1.end()) {
-      return iter - str1.begin();
-    } else {
-      return std::string::npos;
-    }
-  }
-
-  std::wstring toUpper(const std::wstring& str) noexcept {
-    std::wstring upper;
-    std::transform(str.begin(), str.end(), std::back_inserter(upper), towupper);
-    return upper;
-  }
-
-  std::wstring toLower(const std::wstring& str) noexcept {
-    std::wstring lower;
-    std::transform(str.begin(), str.end(), std::back_inserter(lower), towlower);
-    return lower;
-  }
-
   // Date/Time utilities
   int currentYear() noexcept {
     struct tm time {};
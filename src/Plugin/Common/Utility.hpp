@@ -19,6 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "StringUtil.hpp"
+
 #include <string>
 
 #include "windows.h"
@@ -34,18 +36,6 @@ namespace utility {
   COLORREF hexStrToColor(const std::wstring& hexStr) noexcept;
   std::wstring colorToHexStr(COLORREF color) noexcept;
 
-  // String utilites
-  //
-  inline bool isNumber(const std::wstring& str) noexcept { return !str.empty() && std::find_if(str.begin(), str.end(), [](wchar_t ch) { return !iswdigit(ch); }) == str.end(); }
-  inline bool isHexNumber(const std::wstring& str) noexcept { return !str.empty() && std::find_if(str.begin(), str.end(), [](wchar_t ch) { return !iswxdigit(ch); }) == str.end(); }
-  bool compare(const std::string& str1, const std::string& str2, bool ignoreCase = true) noexcept;
-  bool compare(const std::wstring& str1, const std::wstring& str2, bool ignoreCase = true) noexcept;
-  bool startsWith(const std::wstring& str1, const std::wstring& str2, bool ignoreCase = true) noexcept;
-  bool endsWith(const std::wstring& str1, const std::wstring& str2, bool ignoreCase = true) noexcept;
-  size_t findIndex(const std::wstring& str1, const std::wstring& str2, bool ignoreCase = true) noexcept;
-  std::wstring toUpper(const std::wstring& str) noexcept;
-  std::wstring toLower(const std::wstring& str) noexcept;
-
   // Date/Time utilities
   int currentYear() noexcept;
 
@@ -0,0 +1,365 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ChildProcess.hpp"
+
+#include "../Common/FinalAction.hpp"
+
+#ifdef _WIN32
+#include <memory>
+
+#define PIPE_BUFFER_SIZE  0  // Use system default size, as output pipes are drained while the process is running
+#else
+#include <cerrno>
+#include <csignal>
+#include <string>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define HAVE_PIPE2
+#endif
+#endif
+
+namespace papyrus {
+
+#ifndef _WIN32
+  namespace {
+#ifndef HAVE_PIPE2
+    // Without pipe2, close-on-exec can only be set after a pipe is created, so spawning is held off meanwhile. Otherwise
+    // another job's process could inherit the pipe, and keep it open until that process exits.
+    std::mutex pipeCreationMutex;
+#endif
+
+    // Encode command line as UTF-8 for the shell
+    std::string toUtf8(const std::wstring& str) {
+      std::string result;
+      for (wchar_t ch : str) {
+        auto codePoint = static_cast<uint32_t>(ch);
+        if (codePoint < 0x80) {
+          result += static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+          result += static_cast<char>(0xC0 | (codePoint >> 6));
+          result += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+          result += static_cast<char>(0xE0 | (codePoint >> 12));
+          result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+          result += static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+          result += static_cast<char>(0xF0 | (codePoint >> 18));
+          result += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+          result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+          result += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+      }
+      return result;
+    }
+  }
+#endif
+
+  ChildProcess::ChildProcess(const std::wstring& commandLine, PipeReader::lines_callback_t onOutputLines, PipeReader::lines_callback_t onErrorLines)
+    : commandLine(commandLine), onOutputLines(onOutputLines), onErrorLines(onErrorLines) {
+  }
+
+  ChildProcess::~ChildProcess() {
+    closePipes();
+  }
+
+  ChildProcess::Result ChildProcess::run() {
+    Result result {
+      .status = Status::Exited,
+      .exitCode = 0,
+      .errorCode = 0,
+      .outputBytes = 0,
+      .errorBytes = 0
+    };
+    auto autoClosePipes = utility::finally([&] { closePipes(); });
+    if (!createPipes(result)) {
+      result.status = Status::PipeFailed;
+      return result;
+    }
+
+    {
+      std::lock_guard lock(mutex);
+      if (terminated) {
+        result.status = Status::Terminated;
+        return result;
+      }
+      if (!start(result)) {
+        result.status = Status::StartFailed;
+        return result;
+      }
+    }
+
+    // Close our copies of write ends, so pipes are closed as soon as the process exits
+#ifdef _WIN32
+    ::CloseHandle(outputHandles[1]);
+    outputHandles[1] = nullptr;
+    ::CloseHandle(errorHandles[1]);
+    errorHandles[1] = nullptr;
+#else
+    ::close(outputHandles[1]);
+    outputHandles[1] = -1;
+    ::close(errorHandles[1]);
+    errorHandles[1] = -1;
+#endif
+
+    {
+      PipeReader outputReader(readPipe(outputHandles[0]), onOutputLines);
+      PipeReader errorReader(readPipe(errorHandles[0]), onErrorLines);
+      if (!wait(result)) {
+        // Readers would never see the pipes closed while the process is still running
+        std::lock_guard lock(mutex);
+        kill();
+        result.status = Status::WaitFailed;
+      }
+
+      outputReader.join();
+      errorReader.join();
+      result.outputBytes = outputReader.bytesRead();
+      result.errorBytes = errorReader.bytesRead();
+      if (result.status == Status::Exited && (outputReader.hasFailed() || errorReader.hasFailed())) {
+        result.status = Status::ReadFailed;
+      }
+    }
+
+    std::lock_guard lock(mutex);
+    release();
+    if (terminated && result.status == Status::Exited) {
+      result.status = Status::Terminated;
+    }
+    return result;
+  }
+
+  void ChildProcess::terminate() {
+    std::lock_guard lock(mutex);
+    terminated = true;
+    kill();
+  }
+
+  // Private methods
+  //
+
+#ifdef _WIN32
+  bool ChildProcess::createPipes(Result& result) {
+    // Write ends need to be inheritable, but are only inherited by the process they are explicitly handed to
+    SECURITY_ATTRIBUTES attr {
+      .nLength = sizeof(SECURITY_ATTRIBUTES),
+      .bInheritHandle = TRUE
+    };
+    if (::CreatePipe(&outputHandles[0], &outputHandles[1], &attr, PIPE_BUFFER_SIZE) && ::CreatePipe(&errorHandles[0], &errorHandles[1], &attr, PIPE_BUFFER_SIZE)
+      && ::SetHandleInformation(outputHandles[0], HANDLE_FLAG_INHERIT, 0) && ::SetHandleInformation(errorHandles[0], HANDLE_FLAG_INHERIT, 0)) {
+      return true;
+    }
+    result.errorCode = ::GetLastError();
+    return false;
+  }
+
+  bool ChildProcess::start(Result& result) {
+    // Processes of concurrent jobs would otherwise inherit each other's write ends, so a job's pipes wouldn't be closed until
+    // all those processes exit. Only this job's write ends are handed to the process.
+    SIZE_T attributeListSize {};
+    ::InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSize);
+    auto attributeListBuffer = std::make_unique<char[]>(attributeListSize);
+    auto attributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.get());
+    if (!::InitializeProcThreadAttributeList(attributeList, 1, 0, &attributeListSize)) {
+      result.errorCode = ::GetLastError();
+      return false;
+    }
+    auto autoDeleteAttributeList = utility::finally([&] { ::DeleteProcThreadAttributeList(attributeList); });
+    HANDLE inheritedHandles[] { outputHandles[1], errorHandles[1] };
+    if (!::UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inheritedHandles, sizeof(inheritedHandles), nullptr, nullptr)) {
+      result.errorCode = ::GetLastError();
+      return false;
+    }
+
+    STARTUPINFOEX startupInfo {
+      .StartupInfo = {
+        .cb = sizeof(STARTUPINFOEX),
+        .dwFlags = STARTF_USESTDHANDLES,
+        .hStdOutput = outputHandles[1],
+        .hStdError = errorHandles[1]
+      },
+      .lpAttributeList = attributeList
+    };
+    PROCESS_INFORMATION processInfo {};
+    std::wstring mutableCommandLine = commandLine;
+    if (!::CreateProcess(nullptr, &mutableCommandLine[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT | EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startupInfo.StartupInfo, &processInfo)) {
+      result.errorCode = ::GetLastError();
+      return false;
+    }
+    ::CloseHandle(processInfo.hThread);
+    processHandle = processInfo.hProcess;
+    return true;
+  }
+
+  bool ChildProcess::wait(Result& result) {
+    DWORD exitCode {};
+    if (::WaitForSingleObject(processHandle, INFINITE) == WAIT_FAILED || !::GetExitCodeProcess(processHandle, &exitCode)) {
+      result.errorCode = ::GetLastError();
+      return false;
+    }
+    result.exitCode = exitCode;
+    return true;
+  }
+
+  void ChildProcess::release() {
+    if (processHandle) {
+      ::CloseHandle(processHandle);
+      processHandle = nullptr;
+    }
+  }
+
+  void ChildProcess::closePipes() {
+    for (HANDLE* handle : { &outputHandles[0], &outputHandles[1], &errorHandles[0], &errorHandles[1] }) {
+      if (*handle) {
+        ::CloseHandle(*handle);
+        *handle = nullptr;
+      }
+    }
+  }
+
+  void ChildProcess::kill() {
+    if (processHandle) {
+      ::TerminateProcess(processHandle, 1);
+    }
+  }
+
+  PipeReader::read_t ChildProcess::readPipe(HANDLE readHandle) {
+    return [readHandle](char* buffer, size_t size) -> int64_t {
+      DWORD bytesRead {};
+      do {
+        if (!::ReadFile(readHandle, buffer, static_cast<DWORD>(size), &bytesRead, nullptr)) {
+          // Pipe is broken once all write ends are closed, i.e. the process has exited
+          return (::GetLastError() == ERROR_BROKEN_PIPE) ? 0 : -1;
+        }
+      } while (bytesRead == 0);
+      return bytesRead;
+    };
+  }
+#else
+  bool ChildProcess::createPipes(Result& result) {
+    // All ends are closed on exec, so the process only gets write ends duplicated as its stdout and stderr
+#ifdef HAVE_PIPE2
+    if (::pipe2(outputHandles, O_CLOEXEC) == 0 && ::pipe2(errorHandles, O_CLOEXEC) == 0) {
+      return true;
+    }
+#else
+    std::lock_guard lock(pipeCreationMutex);
+    if (::pipe(outputHandles) == 0 && ::pipe(errorHandles) == 0
+      && ::fcntl(outputHandles[0], F_SETFD, FD_CLOEXEC) == 0 && ::fcntl(outputHandles[1], F_SETFD, FD_CLOEXEC) == 0
+      && ::fcntl(errorHandles[0], F_SETFD, FD_CLOEXEC) == 0 && ::fcntl(errorHandles[1], F_SETFD, FD_CLOEXEC) == 0) {
+      return true;
+    }
+#endif
+    result.errorCode = static_cast<uint32_t>(errno);
+    return false;
+  }
+
+  bool ChildProcess::start(Result& result) {
+    posix_spawn_file_actions_t fileActions;
+    posix_spawnattr_t attr;
+    ::posix_spawn_file_actions_init(&fileActions);
+    ::posix_spawnattr_init(&attr);
+    auto autoCleanup = utility::finally([&] {
+      ::posix_spawnattr_destroy(&attr);
+      ::posix_spawn_file_actions_destroy(&fileActions);
+    });
+
+    // Duplicated descriptors don't inherit close-on-exec flag. Running in its own process group allows killing the shell
+    // along with everything it starts.
+    ::posix_spawn_file_actions_adddup2(&fileActions, outputHandles[1], STDOUT_FILENO);
+    ::posix_spawn_file_actions_adddup2(&fileActions, errorHandles[1], STDERR_FILENO);
+    ::posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    ::posix_spawnattr_setpgroup(&attr, 0);
+
+    std::string command = toUtf8(commandLine);
+    char shell[] = "/bin/sh";
+    char option[] = "-c";
+    char* argv[] = { shell, option, command.data(), nullptr };
+#ifndef HAVE_PIPE2
+    std::lock_guard lock(pipeCreationMutex);
+#endif
+    int error = ::posix_spawn(&processId, shell, &fileActions, &attr, argv, environ);
+    if (error != 0) {
+      processId = 0;
+      result.errorCode = static_cast<uint32_t>(error);
+      return false;
+    }
+    return true;
+  }
+
+  bool ChildProcess::wait(Result& result) {
+    // Process is left as a zombie, so its process group stays valid until it's released
+    siginfo_t info {};
+    while (::waitid(P_PID, static_cast<id_t>(processId), &info, WEXITED | WNOWAIT) != 0) {
+      if (errno != EINTR) {
+        result.errorCode = static_cast<uint32_t>(errno);
+        return false;
+      }
+    }
+    result.exitCode = (info.si_code == CLD_EXITED) ? static_cast<uint32_t>(info.si_status) : 128 + static_cast<uint32_t>(info.si_status);
+    return true;
+  }
+
+  void ChildProcess::release() {
+    if (processId != 0) {
+      while (::waitpid(processId, nullptr, 0) < 0 && errno == EINTR) {}
+      processId = 0;
+    }
+  }
+
+  void ChildProcess::closePipes() {
+    for (int* handle : { &outputHandles[0], &outputHandles[1], &errorHandles[0], &errorHandles[1] }) {
+      if (*handle >= 0) {
+        ::close(*handle);
+        *handle = -1;
+      }
+    }
+  }
+
+  void ChildProcess::kill() {
+    if (processId != 0) {
+      ::kill(-processId, SIGKILL);
+    }
+  }
+
+  PipeReader::read_t ChildProcess::readPipe(int readHandle) {
+    return [readHandle](char* buffer, size_t size) -> int64_t {
+      while (true) {
+        ssize_t bytesRead = ::read(readHandle, buffer, size);
+        if (bytesRead >= 0) {
+          // 0 once all write ends are closed, i.e. the process and everything it started have exited
+          return bytesRead;
+        }
+        if (errno != EINTR) {
+          return -1;
+        }
+      }
+    };
+  }
+#endif
+
+} // namespace
@@ -0,0 +1,114 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "PipeReader.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#endif
+
+namespace papyrus {
+
+  // Runs a command line as a child process with its stdout and stderr redirected to pipes, which are drained by a PipeReader
+  // each while the process is running, so lines are handled as soon as they are written. On Windows the process is created
+  // directly with CreateProcess, elsewhere the command line is run by /bin/sh with posix_spawn in its own process group.
+  //
+  class ChildProcess {
+    public:
+      enum class Status {
+        Exited,
+        PipeFailed,
+        StartFailed,
+        WaitFailed,
+        ReadFailed,
+        Terminated
+      };
+
+      struct Result {
+        Status status;
+        uint32_t exitCode;   // Only valid when process has exited
+        uint32_t errorCode;  // System error code of the failed step
+        size_t outputBytes;
+        size_t errorBytes;
+      };
+
+      // Callbacks are invoked on reader threads
+      ChildProcess(const std::wstring& commandLine, PipeReader::lines_callback_t onOutputLines, PipeReader::lines_callback_t onErrorLines);
+      ~ChildProcess();
+
+      // Disable all copy/move constructor/assignment operator
+      ChildProcess(const ChildProcess&) = delete;
+      ChildProcess(ChildProcess&& other) = delete;
+      ChildProcess& operator=(const ChildProcess&) = delete;
+      ChildProcess& operator=(ChildProcess&& other) = delete;
+
+      // Start the process, and wait until it exits and both pipes are drained. Can only be called once.
+      Result run();
+
+      // Kill the process if it's running, or keep it from being started. Can be called from any thread.
+      void terminate();
+
+    private:
+      // Platform specific steps of run. Each failed one sets result's error code.
+      bool createPipes(Result& result);
+      bool start(Result& result);
+      bool wait(Result& result);  // Doesn't release the process, so it can still be killed until released
+      void release();
+      void closePipes();
+
+      // Kill the process. Must be called with lock held.
+      void kill();
+
+      // Get function that reads the given pipe for PipeReader
+#ifdef _WIN32
+      static PipeReader::read_t readPipe(HANDLE readHandle);
+#else
+      static PipeReader::read_t readPipe(int readHandle);
+#endif
+
+      // Private members
+      //
+      const std::wstring commandLine;
+      const PipeReader::lines_callback_t onOutputLines;
+      const PipeReader::lines_callback_t onErrorLines;
+
+      std::mutex mutex;
+      bool terminated {false};
+
+#ifdef _WIN32
+      HANDLE outputHandles[2] {};  // Read and write ends of stdout pipe
+      HANDLE errorHandles[2] {};   // Read and write ends of stderr pipe
+      HANDLE processHandle {};
+#else
+      int outputHandles[2] {-1, -1};
+      int errorHandles[2] {-1, -1};
+      pid_t processId {0};
+#endif
+  };
+
+} // namespace
@@ -0,0 +1,129 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "CompilationQueue.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+#define SHUTDOWN_POLL_INTERVAL  10  // Milliseconds between calls of shutdown's waiting function
+
+namespace papyrus {
+
+  CompilationQueue::CompilationQueue(size_t capacity, size_t workerCount, job_t job)
+    : capacity(capacity),
+      workerCount((workerCount > 0) ? workerCount : (std::max)(std::thread::hardware_concurrency(), 1u)),
+      job(job) {
+  }
+
+  CompilationQueue::~CompilationQueue() {
+    stop();
+    for (std::thread& worker : workers) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+  }
+
+  bool CompilationQueue::push(const CompilationRequest& request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || requests.size() >= capacity) {
+      return false;
+    }
+
+    // Start another worker if all running ones are busy. Queued requests are still compiled by running workers if it can't
+    // be started.
+    if (idleWorkers <= requests.size() && workers.size() < workerCount) {
+      try {
+        workers.emplace_back([this]() { run(); });
+        idleWorkers++;
+        runningWorkers++;
+      } catch (const std::system_error&) {
+        if (workers.empty()) {
+          return false;
+        }
+      }
+    }
+    requests.push_back(request);
+    condition.notify_one();
+    return true;
+  }
+
+  bool CompilationQueue::shutdown(std::chrono::milliseconds timeout, std::function<void()> whileWaiting) {
+    stop();
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (runningWorkers > 0 && std::chrono::steady_clock::now() < deadline) {
+      if (!condition.wait_for(lock, std::chrono::milliseconds(SHUTDOWN_POLL_INTERVAL), [this] { return runningWorkers == 0; })) {
+        lock.unlock();
+        whileWaiting();
+        lock.lock();
+      }
+    }
+
+    bool stopped = (runningWorkers == 0);
+    lock.unlock();
+    for (std::thread& worker : workers) {
+      if (worker.joinable()) {
+        if (stopped) {
+          worker.join();
+        } else {
+          worker.detach();
+        }
+      }
+    }
+    return stopped;
+  }
+
+  // Private methods
+  //
+
+  void CompilationQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      condition.wait(lock, [this] { return stopping || !requests.empty(); });
+      if (stopping) {
+        break;
+      }
+
+      CompilationRequest request = std::move(requests.front());
+      requests.pop_front();
+      idleWorkers--;
+      lock.unlock();
+      job(request);
+      lock.lock();
+      idleWorkers++;
+    }
+
+    // Let shutdown know once all workers are done
+    runningWorkers--;
+    condition.notify_all();
+  }
+
+  void CompilationQueue::stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      requests.clear();
+    }
+    condition.notify_all();
+  }
+
+} // namespace
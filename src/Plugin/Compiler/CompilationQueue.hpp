@@ -0,0 +1,84 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "CompilationRequest.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace papyrus {
+
+  // Bounded queue of compilation requests, drained by a pool of worker threads that each run one job at a time, so several
+  // scripts can be compiled at once. Workers are only started when requests are queued and no worker is idle, up to the
+  // size of the pool. Requests are compiled in the order they are queued.
+  //
+  class CompilationQueue {
+    public:
+      using job_t = std::function<void(const CompilationRequest&)>;
+
+      // Worker count of 0 means one worker per processor core
+      CompilationQueue(size_t capacity, size_t workerCount, job_t job);
+      ~CompilationQueue();
+
+      // Disable all copy/move constructor/assignment operator
+      CompilationQueue(const CompilationQueue&) = delete;
+      CompilationQueue(CompilationQueue&& other) = delete;
+      CompilationQueue& operator=(const CompilationQueue&) = delete;
+      CompilationQueue& operator=(CompilationQueue&& other) = delete;
+
+      // Queue a request to be compiled by a worker. Returns false if the queue is full, no worker can be started, or the
+      // queue has been shut down.
+      bool push(const CompilationRequest& request);
+
+      // Drop queued requests, wait up to the given timeout for workers to exit once their current jobs are done, and join
+      // them. Running jobs may be waiting for the calling thread to handle their messages, so the given function is called
+      // periodically while waiting. Returns false if workers are still running after timeout, in which case they are detached.
+      bool shutdown(std::chrono::milliseconds timeout, std::function<void()> whileWaiting);
+
+    private:
+      // Worker thread procedure
+      void run();
+
+      // Drop queued requests and wake up all workers to exit
+      void stop();
+
+      // Private members
+      //
+      const size_t capacity;
+      const size_t workerCount;
+      const job_t job;
+
+      std::mutex mutex;
+      std::condition_variable condition;
+      std::deque<CompilationRequest> requests;
+      size_t idleWorkers {0};
+      size_t runningWorkers {0};
+      bool stopping {false};
+      std::vector<std::thread> workers;
+  };
+
+} // namespace
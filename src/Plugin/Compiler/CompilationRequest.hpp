@@ -19,8 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
-#include "..\Common\Game.hpp"
-#include "..\Common\NotepadPlusPlus.hpp"
+#include "../Common/Game.hpp"
+#include "../Common/NotepadPlusPlus.hpp"
 
 #include <string>
 
@@ -31,8 +31,11 @@ namespace papyrus {
   struct CompilationRequest {
     Game game;
     npp_buffer_t bufferID;
-    std::wstring filePath;
+    std::wstring filePath;            // Script file, or folder of scripts if compileFolder is set
     bool useAutoModeOutputDirectory;
+    bool compileFolder {false};       // Compile all scripts in folder "filePath" with one compiler invocation
+    bool isBatchJob {false};          // Part of a batch compilation, whose results are reported together
+    bool skipIfUpToDate {false};      // Report scripts that are up to date instead of compiling them
   };
 
 } // namespace
@@ -23,146 +23,318 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "..\Common\FinalAction.hpp"
 #include "..\Common\Utility.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
 
-#define STDOUT_PIPE_SIZE 10485760   // Allow up to 10MiB data to be returned from stdout
-#define STDERR_PIPE_SIZE 524288000  // Allow up to 500MiB data to be returned from stderr
+#define COMPILATION_QUEUE_SIZE  64         // Maximum number of compilation requests waiting for a worker thread
+#define OUTPUT_CACHE_CAPACITY   268435456  // Allow up to 256MiB of compiled output to be cached
+#define SHUTDOWN_TIMEOUT        5000       // Milliseconds to wait for worker threads to stop on shutdown
 
 namespace papyrus {
 
-  Compiler::Compiler(HWND messageWindow, const CompilerMessages compilerMessages, const CompilerSettings& settings)
-   : messageWindow(messageWindow), messages(compilerMessages), settings(settings) {
+  Compiler::Compiler(HWND messageWindow, const CompilerMessages compilerMessages, const CompilerSettings& settings, size_t workerCount)
+   : messageWindow(messageWindow), messages(compilerMessages), settings(settings), outputCache(OUTPUT_CACHE_CAPACITY),
+     queue(COMPILATION_QUEUE_SIZE, workerCount, [this](const CompilationRequest& request) { compile(request); }) {
   }
 
-  void Compiler::start(const CompilationRequest& request) {
-    try {
-      if (!compilationThread.joinable()) {
-        compilationThread = std::thread([=]() { compile(request); });
-      } else {
-        ::SendMessage(messageWindow, messages.otherErrordMessage, reinterpret_cast<WPARAM>(L"Compilation thread unusable."), reinterpret_cast<LPARAM>(L"Compilation aborted."));
+  void Compiler::loadDependencyGraph(const std::filesystem::path& filePath) {
+    dependencyGraph.load(filePath);
+  }
+
+  void Compiler::openOutputCache(const std::filesystem::path& directory) {
+    outputCache.open(directory);
+  }
+
+  bool Compiler::start(const CompilationRequest& request) {
+    return queue.push(request);
+  }
+
+  void Compiler::shutdown() {
+    // Results of running compilations would not be shown anyway
+    {
+      std::lock_guard lock(processesMutex);
+      cancelled = true;
+      for (ChildProcess* process : runningProcesses) {
+        process->terminate();
+      }
+    }
+
+    // Worker threads may be waiting for their messages to be handled by this thread. Peeking handles sent messages.
+    bool stopped = queue.shutdown(std::chrono::milliseconds(SHUTDOWN_TIMEOUT),
+      [] {
+        MSG msg;
+        ::PeekMessage(&msg, nullptr, 0, 0, PM_NOREMOVE);
       }
-    } catch (const std::system_error&) {
-      ::SendMessage(messageWindow, messages.otherErrordMessage, reinterpret_cast<WPARAM>(L"Starting compiler in thread failed."), reinterpret_cast<LPARAM>(L"Compilation stopped."));
+    );
+    if (stopped) {
+      dependencyGraph.save();
     }
   }
 
   // Private methods
   //
 
-  void Compiler::compile(CompilationRequest request) {
+  void Compiler::compile(const CompilationRequest& request) {
     try {
       auto gameSettings = settings.gameSettings(request.game);
       std::wstring path = gameSettings.compilerPath;
       if (std::ifstream(path).good()) {
-        // Input file path
-        std::wstring outputDirectory = gameSettings.outputDirectory;
-        if (request.useAutoModeOutputDirectory) {
-          if (std::filesystem::path(settings.autoModeOutputDirectory).is_absolute()) {
-            outputDirectory = settings.autoModeOutputDirectory;
-          } else {
-            outputDirectory = std::filesystem::path(request.filePath).parent_path() / settings.autoModeOutputDirectory;
-          }
+        std::wstring outputDirectory = getOutputDirectory(request, gameSettings);
+        std::wstring buildSignature = getBuildSignature(gameSettings, outputDirectory);
+        std::vector<std::wstring> importDirectories = getImportDirectories(gameSettings);
+        auto compiledScripts = getCompiledScripts(request, importDirectories, outputDirectory);
+        if (request.skipIfUpToDate && isUpToDate(compiledScripts, buildSignature)) {
+          sendMessage(request, messages.compilationDoneMessage, messages.upToDate);
+          return;
+        }
+
+        // Inputs and cache keys are collected before compiling, so they match what compiler reads
+        auto scriptInputs = getScriptInputs(compiledScripts, importDirectories, gameSettings);
+        auto cachedOutputs = getCachedOutputs(compiledScripts, scriptInputs, gameSettings, buildSignature);
+        if (outputCache.restore(cachedOutputs)) {
+          recordBuilds(compiledScripts, scriptInputs, buildSignature);
+          sendMessage(request, messages.compilationDoneMessage, messages.restoredFromCache);
+          return;
+        }
+
+        // A trailing backslash, e.g. of a drive's root folder, would escape the closing quote
+        std::wstring sourcePath = request.filePath;
+        if (utility::endsWith(sourcePath, L"\\")) {
+          sourcePath += L"\\";
         }
 
         // Define compiler process.
         std::wstring commandLine =
           L"\"" + path + L"\"" +
-          L" \"" + request.filePath + L"\"" +
-          L" -i=\"" + gameSettings.importDirectories + L"\"" +
-          L" -o=\"" + outputDirectory + L"\"" +
-          L" -f=\"" + gameSettings.flagFile + L"\"" +
-          (gameSettings.optimizeFlag ? L" -op" : L"") +
-          (gameSettings.releaseFlag ? L" -r" : L"") +
-          (gameSettings.finalFlag ? L" -final" : L"") +
-          L" " + gameSettings.additionalArguments;
-        STARTUPINFO startupInfo {
-          .dwFlags = STARTF_USESTDHANDLES
-        };
-
-        // Setup error output pipe
-        HANDLE outputReadHandle {};
-        HANDLE errorReadHandle {};
-        SECURITY_ATTRIBUTES attr {};
-        attr.bInheritHandle = TRUE;
-        if (::CreatePipe(&outputReadHandle, &startupInfo.hStdOutput, &attr, STDOUT_PIPE_SIZE) && ::CreatePipe(&errorReadHandle, &startupInfo.hStdError, &attr, STDERR_PIPE_SIZE)) {
-          // Run the process
-          PROCESS_INFORMATION compilationProcess {};
-          if (::CreateProcess(nullptr, &commandLine[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT, nullptr, nullptr, &startupInfo, &compilationProcess)) {
-            if (::WaitForSingleObject(compilationProcess.hProcess, INFINITE) != WAIT_FAILED) {
-              DWORD size {};
-              if (::PeekNamedPipe(errorReadHandle, nullptr, 0, nullptr, &size, nullptr)) {
-                // Check if there are error reported by compiler on stderr
-                if (size > 0) {
-                  // Read the error output from pipe
-                  std::vector<char> data(size);
-                  if (::ReadFile(errorReadHandle, &data[0], size, nullptr, nullptr)) {
-                    std::wstring errorOutput(data.begin(), data.end());
-                    parseErrors(errorOutput, gameSettings, outputDirectory);
-                  } else {
-                    sendOtherErrorMessage(L"ReadFile failed. Compilation stopped.");
-                    return;
-                  }
-                } else {
-                  // Check stdout as well. This is for the rare case that compilation passed but somehow the compiler chokes at .pas file, when optimize flag is used
-                  if (::PeekNamedPipe(outputReadHandle, nullptr, 0, nullptr, &size, nullptr)) {
-                    bool hasError = false;
-                    if (size > 0) {
-                      std::vector<char> data(size);
-                      if (::ReadFile(outputReadHandle, &data[0], size, nullptr, nullptr)) {
-                        std::wstring stdOutput(data.begin(), data.end());
-                        if (stdOutput.find(L"compilation failed") != std::string::npos) {
-                          hasError = true;
-                          parseErrors(stdOutput, gameSettings, outputDirectory);
-                        }
-                      }
-                    }
-
-                    if (!hasError) {
-                      // No error, check if anonymization is needed
-                      if (gameSettings.anonynmizeFlag) {
-                        // Output file has the same name as input file, with file extension set as ".pex"
-                        std::wstring outputFile = std::filesystem::path(outputDirectory) / std::filesystem::path(request.filePath).replace_extension(L".pex").filename();
-                        std::wstring errorMsg;
-                        if (anonymizeOutput(outputFile, errorMsg)) {
-                          ::SendMessage(messageWindow, messages.compilationDoneMessage, messages.withAnonymization, 0);
-                        } else {
-                          ::SendMessage(messageWindow, messages.anonymizationFailureMessage, reinterpret_cast<WPARAM>(errorMsg.c_str()), 0);
-                        }
-                      } else {
-                        ::SendMessage(messageWindow, messages.compilationDoneMessage, messages.compilationOnly, 0);
-                      }
-                    }
-                  } else {
-                    sendOtherErrorMessage(L"PeekNamedPipe failed on stdout. Compilation stopped.");
-                    return;
-                  }
-                }
+          L" \"" + sourcePath + L"\"" +
+          (request.compileFolder ? L" -all" : L"") +
+          getArguments(gameSettings, outputDirectory);
+
+        // Drain both pipes while compiler is running, so it never blocks on a full pipe. Errors reported on stderr are sent to
+        // plugin message window as they are parsed.
+        std::vector<std::string> outputLines;
+        CompilationErrors compilationErrors {};
+        ChildProcess compilerProcess(commandLine,
+          [&](const std::vector<std::string>& lines) {
+            outputLines.insert(outputLines.end(), lines.begin(), lines.end());
+          },
+          [&](const std::vector<std::string>& lines) {
+            std::vector<Error> newErrors;
+            for (const auto& line : lines) {
+              parseErrorLine(std::wstring(line.begin(), line.end()), gameSettings, outputDirectory, compilationErrors, newErrors);
+            }
+            if (!newErrors.empty()) {
+              sendMessage(request, messages.compilationProgressMessage, reinterpret_cast<LPARAM>(&newErrors));
+            }
+          }
+        );
+
+        auto result = runProcess(compilerProcess);
+        switch (result.status) {
+          case ChildProcess::Status::PipeFailed:
+            sendOtherErrorMessage(request, L"CreatePipe failed. Compilation stopped.", result.errorCode);
+            return;
+
+          case ChildProcess::Status::StartFailed:
+            sendOtherErrorMessage(request, L"CreateProcess failed. Compilation stopped.", result.errorCode);
+            return;
+
+          case ChildProcess::Status::WaitFailed:
+            sendOtherErrorMessage(request, L"WaitForSingleObject failed. Compilation stopped.", result.errorCode);
+            return;
+
+          case ChildProcess::Status::ReadFailed:
+            sendOtherErrorMessage(request, L"ReadFile failed. Compilation stopped.", result.errorCode);
+            return;
+
+          case ChildProcess::Status::Terminated:
+            return;
+
+          case ChildProcess::Status::Exited:
+            break;
+        }
+
+        // Check if there are error reported by compiler on stderr
+        if (result.errorBytes > 0) {
+          sendMessage(request, messages.compilationFailureMessage, reinterpret_cast<LPARAM>(&compilationErrors));
+        } else {
+          // Check stdout as well. This is for the rare case that compilation passed but somehow the compiler chokes at .pas file, when optimize flag is used
+          bool hasError = std::any_of(outputLines.begin(), outputLines.end(), [](const std::string& line) { return line.find("compilation failed") != std::string::npos; });
+          if (hasError) {
+            CompilationErrors outputErrors {};
+            std::vector<Error> newErrors;
+            for (const auto& line : outputLines) {
+              parseErrorLine(std::wstring(line.begin(), line.end()), gameSettings, outputDirectory, outputErrors, newErrors);
+            }
+            sendMessage(request, messages.compilationFailureMessage, reinterpret_cast<LPARAM>(&outputErrors));
+          } else {
+            // No error, check if anonymization is needed
+            if (gameSettings.anonynmizeFlag) {
+              std::wstring errorMsg;
+              if (std::all_of(compiledScripts.begin(), compiledScripts.end(), [&](const std::pair<std::wstring, std::wstring>& compiledScript) { return anonymizeOutput(compiledScript.second, errorMsg); })) {
+                outputCache.store(cachedOutputs);
+                recordBuilds(compiledScripts, scriptInputs, buildSignature);
+                sendMessage(request, messages.compilationDoneMessage, messages.withAnonymization);
               } else {
-                sendOtherErrorMessage(L"PeekNamedPipe failed on stderr. Compilation stopped.");
-                return;
+                sendMessage(request, messages.anonymizationFailureMessage, reinterpret_cast<LPARAM>(errorMsg.c_str()));
               }
             } else {
-              sendOtherErrorMessage(L"WaitForSingleObject failed. Compilation stopped.");
-              return;
+              outputCache.store(cachedOutputs);
+              recordBuilds(compiledScripts, scriptInputs, buildSignature);
+              sendMessage(request, messages.compilationDoneMessage, messages.compilationOnly);
             }
-          } else {
-            sendOtherErrorMessage(L"CreateProcess failed. Compilation stopped.");
-            return;
           }
-        } else {
-            sendOtherErrorMessage(L"CreatePipe failed. Compilation stopped.");
-          return;
         }
       } else {
-        ::SendMessage(messageWindow, messages.compilerNotFoundMessage, 0, 0);
+        sendMessage(request, messages.compilerNotFoundMessage, 0);
       }
     } catch (...) {
       // In case of any exception
-      ::SendMessage(messageWindow, messages.otherErrordMessage, reinterpret_cast<WPARAM>(L"Running compiler in thread failed."), reinterpret_cast<LPARAM>(L"Compilation stopped."));
+      CompilerError error {
+        .message = L"Running compiler in thread failed.",
+        .title = L"Compilation stopped."
+      };
+      sendMessage(request, messages.otherErrordMessage, reinterpret_cast<LPARAM>(&error));
+    }
+  }
+
+  std::wstring Compiler::getOutputDirectory(const CompilationRequest& request, const CompilerSettings::GameSettings& gameSettings) const {
+    std::wstring outputDirectory = gameSettings.outputDirectory;
+    if (request.useAutoModeOutputDirectory) {
+      if (std::filesystem::path(settings.autoModeOutputDirectory).is_absolute()) {
+        outputDirectory = settings.autoModeOutputDirectory;
+      } else {
+        std::filesystem::path sourceDirectory = request.compileFolder ? std::filesystem::path(request.filePath) : std::filesystem::path(request.filePath).parent_path();
+        outputDirectory = sourceDirectory / settings.autoModeOutputDirectory;
+      }
+    }
+
+    return outputDirectory;
+  }
+
+  std::wstring Compiler::getArguments(const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory) const {
+    return
+      L" -i=\"" + gameSettings.importDirectories + L"\"" +
+      L" -o=\"" + outputDirectory + L"\"" +
+      L" -f=\"" + gameSettings.flagFile + L"\"" +
+      (gameSettings.optimizeFlag ? L" -op" : L"") +
+      (gameSettings.releaseFlag ? L" -r" : L"") +
+      (gameSettings.finalFlag ? L" -final" : L"") +
+      L" " + gameSettings.additionalArguments;
+  }
+
+  std::wstring Compiler::getBuildSignature(const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory) const {
+    // Anonymization changes output files, so it's part of the signature as well
+    return L"\"" + gameSettings.compilerPath + L"\"" + getArguments(gameSettings, outputDirectory) + (gameSettings.anonynmizeFlag ? L" (anonymized)" : L"");
+  }
+
+  std::vector<std::pair<std::wstring, std::wstring>> Compiler::getCompiledScripts(const CompilationRequest& request, const std::vector<std::wstring>& importDirectories,
+    const std::wstring& outputDirectory) const {
+    std::vector<std::pair<std::wstring, std::wstring>> compiledScripts;
+    if (request.compileFolder) {
+      for (const auto& entry : std::filesystem::directory_iterator(request.filePath)) {
+        if (entry.is_regular_file() && utility::endsWith(entry.path().filename(), L".psc")) {
+          compiledScripts.push_back(std::make_pair(entry.path(), getOutputFile(entry.path(), request.game, importDirectories, outputDirectory)));
+        }
+      }
+    } else {
+      compiledScripts.push_back(std::make_pair(request.filePath, getOutputFile(request.filePath, request.game, importDirectories, outputDirectory)));
+    }
+
+    return compiledScripts;
+  }
+
+  std::wstring Compiler::getOutputFile(const std::filesystem::path& scriptFile, Game game, const std::vector<std::wstring>& importDirectories,
+    const std::wstring& outputDirectory) const {
+    // Output file has the same name as input file, with file extension set as ".pex". FO4 scripts in a subfolder of an import
+    // directory belong to a namespace, and compiler puts them in the same subfolder of output directory.
+    std::filesystem::path outputFolder(outputDirectory);
+    if (game == Game::Fallout4) {
+      std::wstring scriptFolder = (scriptFile.parent_path().lexically_normal() / L"").wstring();
+      std::wstring importRoot;
+      for (const auto& importDirectory : importDirectories) {
+        // Use the deepest import directory that contains the script, in case they are nested
+        std::wstring directory = (std::filesystem::path(importDirectory).lexically_normal() / L"").wstring();
+        if (directory.size() > importRoot.size() && utility::startsWith(scriptFolder, directory)) {
+          importRoot = directory;
+        }
+      }
+      if (!importRoot.empty()) {
+        outputFolder /= scriptFolder.substr(importRoot.size());
+      }
+    }
+
+    return (outputFolder / scriptFile.filename().replace_extension(L".pex")).wstring();
+  }
+
+  bool Compiler::isUpToDate(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts, const std::wstring& buildSignature) const {
+    return !compiledScripts.empty() && std::all_of(compiledScripts.begin(), compiledScripts.end(),
+      [&](const std::pair<std::wstring, std::wstring>& compiledScript) {
+        return dependencyGraph.isUpToDate(compiledScript.first, compiledScript.second, buildSignature);
+      }
+    );
+  }
+
+  std::vector<std::wstring> Compiler::getImportDirectories(const CompilerSettings::GameSettings& gameSettings) const {
+    std::vector<std::wstring> importDirectories;
+    std::wstringstream stream(gameSettings.importDirectories);
+    std::wstring path;
+    while (std::getline(stream, path, L';')) {
+      importDirectories.push_back(path);
+    }
+    return importDirectories;
+  }
+
+  std::vector<DependencyGraph::file_times_t> Compiler::getScriptInputs(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts,
+    const std::vector<std::wstring>& importDirectories, const CompilerSettings::GameSettings& gameSettings) {
+    std::vector<DependencyGraph::file_times_t> scriptInputs;
+    for (const auto& [scriptFile, outputFile] : compiledScripts) {
+      scriptInputs.push_back(dependencyGraph.getInputs(scriptFile, importDirectories, gameSettings.flagFile));
+    }
+    return scriptInputs;
+  }
+
+  std::vector<std::pair<std::wstring, std::wstring>> Compiler::getCachedOutputs(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts,
+    const std::vector<DependencyGraph::file_times_t>& scriptInputs, const CompilerSettings::GameSettings& gameSettings, const std::wstring& buildSignature) {
+    std::vector<std::pair<std::wstring, std::wstring>> cachedOutputs;
+    for (size_t i = 0; i < compiledScripts.size(); i++) {
+      std::vector<std::wstring> inputFiles;
+      for (const auto& input : scriptInputs[i]) {
+        inputFiles.push_back(input.first);
+      }
+      auto key = outputCache.computeKey(inputFiles, gameSettings.compilerPath, buildSignature);
+      if (!key) {
+        return std::vector<std::pair<std::wstring, std::wstring>>();
+      }
+      cachedOutputs.push_back(std::make_pair(key.value(), compiledScripts[i].second));
+    }
+    return cachedOutputs;
+  }
+
+  ChildProcess::Result Compiler::runProcess(ChildProcess& process) {
+    {
+      std::lock_guard lock(processesMutex);
+      if (cancelled) {
+        process.terminate();
+      } else {
+        runningProcesses.insert(&process);
+      }
+    }
+    auto autoUnregister = utility::finally([&] {
+      std::lock_guard lock(processesMutex);
+      runningProcesses.erase(&process);
+    });
+
+    return process.run();
+  }
+
+  void Compiler::recordBuilds(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts, const std::vector<DependencyGraph::file_times_t>& scriptInputs,
+    const std::wstring& buildSignature) {
+    for (size_t i = 0; i < compiledScripts.size(); i++) {
+      dependencyGraph.recordBuild(compiledScripts[i].first, compiledScripts[i].second, buildSignature, scriptInputs[i]);
     }
-    compilationThread.detach();
   }
 
   bool Compiler::anonymizeOutput(const std::wstring& outputFile, std::wstring& errorMsg) {
@@ -246,75 +418,79 @@ namespace papyrus {
     return size;
   }
 
-  void Compiler::parseErrors(const std::wstring& errorText, const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory) {
-    bool hasUnparsableLines = false;
-    std::vector<Error> errors;
-    std::wstringstream output(errorText);
-    std::wstring line;
-    while (std::getline(output, line)) {
-      try {
-        std::wstring lineError = line;
-        Error error;
-        bool isScriptError = false;
-        if (utility::startsWith(lineError, L"<unknown>")) {
-          error.file = L"<unknown>";
-          lineError.erase(0, 10);
-        } else {
-          size_t fileExtIndex = utility::findIndex(lineError, L".psc(");
-          if (fileExtIndex == std::string::npos && gameSettings.optimizeFlag) {
-            fileExtIndex = utility::findIndex(lineError, L".pas(");
-            isScriptError = true;
-          }
+  void Compiler::parseErrorLine(const std::wstring& line, const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory,
+    CompilationErrors& compilationErrors, std::vector<Error>& newErrors) {
+    try {
+      std::wstring lineError = line;
+      Error error;
+      bool isScriptError = false;
+      if (utility::startsWith(lineError, L"<unknown>")) {
+        error.file = L"<unknown>";
+        lineError.erase(0, 10);
+      } else {
+        size_t fileExtIndex = utility::findIndex(lineError, L".psc(");
+        if (fileExtIndex == std::string::npos && gameSettings.optimizeFlag) {
+          fileExtIndex = utility::findIndex(lineError, L".pas(");
+          isScriptError = true;
+        }
 
-          if (fileExtIndex != std::string::npos) {
-            error.file = lineError.substr(0, fileExtIndex + 4);
-            if (isScriptError) {
-              error.file = std::filesystem::path(outputDirectory) / error.file; // Papyrus compiler doesn't provide full path for .pas files
-            }
-            lineError.erase(0, fileExtIndex + 5);
+        if (fileExtIndex != std::string::npos) {
+          error.file = lineError.substr(0, fileExtIndex + 4);
+          if (isScriptError) {
+            error.file = std::filesystem::path(outputDirectory) / error.file; // Papyrus compiler doesn't provide full path for .pas files
           }
+          lineError.erase(0, fileExtIndex + 5);
         }
+      }
 
-        if (!error.file.empty()) {
-          if (!isScriptError) { // .psc
-            size_t indexComma = lineError.find_first_of(L',');
-            error.line = std::stoi(lineError.substr(0, indexComma));
-
-            size_t indexParenthesis = lineError.find_first_of(L')');
-            error.column = std::stoi(lineError.substr(indexComma + 1, indexParenthesis - (indexComma - 1)));
-            error.message = lineError.substr(indexParenthesis + 3);
-          } else { // .pas
-            size_t indexParenthesis = lineError.find_first_of(L')');
-            error.line = std::stoi(lineError.substr(0, indexParenthesis));
-            error.column = 1; // Papyrus compiler doesn't provide column info for .pas files
-            error.message = lineError.substr(indexParenthesis + 4);
-          }
+      if (!error.file.empty()) {
+        if (!isScriptError) { // .psc
+          size_t indexComma = lineError.find_first_of(L',');
+          error.line = std::stoi(lineError.substr(0, indexComma));
+
+          size_t indexParenthesis = lineError.find_first_of(L')');
+          error.column = std::stoi(lineError.substr(indexComma + 1, indexParenthesis - (indexComma - 1)));
+          error.message = lineError.substr(indexParenthesis + 3);
+        } else { // .pas
+          size_t indexParenthesis = lineError.find_first_of(L')');
+          error.line = std::stoi(lineError.substr(0, indexParenthesis));
+          error.column = 1; // Papyrus compiler doesn't provide column info for .pas files
+          error.message = lineError.substr(indexParenthesis + 4);
+        }
 
-          // Discard duplicate errors
-          auto iter = std::find_if(errors.begin(), errors.end(),
-            [&](Error& comparisionError) {
-              return comparisionError.file == error.file
-                && comparisionError.message == error.message
-                && comparisionError.line == error.line
-                && comparisionError.column == error.column;
-            }
-          );
-          if (iter == errors.end()) {
-            errors.push_back(error);
+        // Discard duplicate errors
+        auto& errors = compilationErrors.errors;
+        auto iter = std::find_if(errors.begin(), errors.end(),
+          [&](Error& comparisionError) {
+            return comparisionError.file == error.file
+              && comparisionError.message == error.message
+              && comparisionError.line == error.line
+              && comparisionError.column == error.column;
           }
+        );
+        if (iter == errors.end()) {
+          errors.push_back(error);
+          newErrors.push_back(error);
         }
-      } catch (...) {
-        //log(line);
-        hasUnparsableLines = true;
       }
+    } catch (...) {
+      //log(line);
+      compilationErrors.hasUnparsableLines = true;
     }
+  }
 
-    ::SendMessage(messageWindow, messages.compilationFailureMessage, reinterpret_cast<WPARAM>(&errors), hasUnparsableLines);
+  void Compiler::sendMessage(const CompilationRequest& request, UINT message, LPARAM details) {
+    if (!cancelled) {
+      ::SendMessage(messageWindow, message, reinterpret_cast<WPARAM>(&request), details);
+    }
   }
 
-  void Compiler::sendOtherErrorMessage(const wchar_t* msg) {
-    std::wstring errorMsg(L"Error code: " + std::to_wstring(::GetLastError()));
-    ::SendMessage(messageWindow, messages.otherErrordMessage, reinterpret_cast<WPARAM>(errorMsg.c_str()), reinterpret_cast<LPARAM>(msg));
+  void Compiler::sendOtherErrorMessage(const CompilationRequest& request, const wchar_t* msg, DWORD errorCode) {
+    CompilerError error {
+      .message = L"Error code: " + std::to_wstring(errorCode),
+      .title = msg
+    };
+    sendMessage(request, messages.otherErrordMessage, reinterpret_cast<LPARAM>(&error));
   }
 
 } // namespace
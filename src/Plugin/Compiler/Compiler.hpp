@@ -20,13 +20,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "ChildProcess.hpp"
+#include "CompilationQueue.hpp"
 #include "CompilationRequest.hpp"
 #include "CompilerMessages.hpp"
 #include "CompilerSettings.hpp"
+#include "DependencyGraph.hpp"
+#include "OutputCache.hpp"
 
 #include "..\CompilationErrorHandling\Error.hpp"
 
-#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <windows.h>
@@ -35,13 +44,67 @@ namespace papyrus {
 
   class Compiler {
     public:
-      Compiler(HWND messageWindow, const CompilerMessages compilerMessages, const CompilerSettings& settings);
+      // Worker count of 0 means one worker per processor core
+      Compiler(HWND messageWindow, const CompilerMessages compilerMessages, const CompilerSettings& settings, size_t workerCount = 0);
 
-      void start(const CompilationRequest& request);
+      // Load dependency graph saved in last session, which is saved to the same file on shutdown
+      void loadDependencyGraph(const std::filesystem::path& filePath);
+
+      // Use the given directory for output cache, which keeps files cached in last session
+      void openOutputCache(const std::filesystem::path& directory);
+
+      inline OutputCache::Statistics outputCacheStatistics() const { return outputCache.statistics(); }
+
+      // Queue the given request to be compiled in a worker thread. Returns false if it can't be queued.
+      bool start(const CompilationRequest& request);
+
+      // Drop queued requests, kill running compiler processes, wait for worker threads to stop, and save dependency graph.
+      // Graph is not saved if worker threads don't stop in time, as they may still be updating it.
+      void shutdown();
 
     private:
-      // Compile the given script file in a separate thread
-      void compile(CompilationRequest request);
+      // Compile the given script file. Runs in a worker thread.
+      void compile(const CompilationRequest& request);
+
+      // Get output directory of the given request
+      std::wstring getOutputDirectory(const CompilationRequest& request, const CompilerSettings::GameSettings& gameSettings) const;
+
+      // Get compiler arguments other than source file
+      std::wstring getArguments(const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory) const;
+
+      // Get signature of everything other than source files that affects compiled output
+      std::wstring getBuildSignature(const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory) const;
+
+      // Get scripts compiled by the given request, each along with its generated PEX file
+      std::vector<std::pair<std::wstring, std::wstring>> getCompiledScripts(const CompilationRequest& request, const std::vector<std::wstring>& importDirectories,
+        const std::wstring& outputDirectory) const;
+
+      // Get PEX file generated from the given script, which is in a namespace subfolder of output directory for FO4
+      std::wstring getOutputFile(const std::filesystem::path& scriptFile, Game game, const std::vector<std::wstring>& importDirectories,
+        const std::wstring& outputDirectory) const;
+
+      // Check if all compiled scripts have been compiled with the given build signature, and neither they nor any scripts they
+      // depend on have changed since. Scans scripts that have been modified, so it's only done in worker threads.
+      bool isUpToDate(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts, const std::wstring& buildSignature) const;
+
+      // Split import directories setting
+      std::vector<std::wstring> getImportDirectories(const CompilerSettings::GameSettings& gameSettings) const;
+
+      // Collect inputs of each compiled script, which are used for both its output cache key and its build record
+      std::vector<DependencyGraph::file_times_t> getScriptInputs(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts,
+        const std::vector<std::wstring>& importDirectories, const CompilerSettings::GameSettings& gameSettings);
+
+      // Get output cache keys of compiled scripts from their inputs, each along with its generated PEX file. Returns an empty
+      // list if any of the keys can't be computed.
+      std::vector<std::pair<std::wstring, std::wstring>> getCachedOutputs(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts,
+        const std::vector<DependencyGraph::file_times_t>& scriptInputs, const CompilerSettings::GameSettings& gameSettings, const std::wstring& buildSignature);
+
+      // Run compiler process unless shutting down, keeping it registered while running so it can be killed on shutdown
+      ChildProcess::Result runProcess(ChildProcess& process);
+
+      // Record successful compilation of scripts in dependency graph, with inputs collected before compiling
+      void recordBuilds(const std::vector<std::pair<std::wstring, std::wstring>>& compiledScripts, const std::vector<DependencyGraph::file_times_t>& scriptInputs,
+        const std::wstring& buildSignature);
 
       // Anonymize generated PEX script
       bool anonymizeOutput(const std::wstring& outputFile, std::wstring& errorMsg);
@@ -52,18 +115,31 @@ namespace papyrus {
       // Read size of a field from PEX header. Skyrim & SSE use big endian, FO4 uses little endian
       int readSize(std::fstream& file, bool isBigEndian);
 
-      // Parse compilation errors and send the result back to plugin message window
-      void parseErrors(const std::wstring& errorText, const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory);
+      // Parse a line of compiler output into compilation errors. An error not yet reported is also added to newErrors.
+      void parseErrorLine(const std::wstring& line, const CompilerSettings::GameSettings& gameSettings, const std::wstring& outputDirectory,
+        CompilationErrors& compilationErrors, std::vector<Error>& newErrors);
+
+      // Send a message about the given request to plugin message window, unless shutting down
+      void sendMessage(const CompilationRequest& request, UINT message, LPARAM details);
 
-      // Send any unexpected "other error message" to plugin main processor, along with last error code from Win32 API
-      void sendOtherErrorMessage(const wchar_t* msg);
+      // Send any unexpected "other error message" to plugin main processor, along with the given error code, which is last
+      // error code from Win32 API by default
+      void sendOtherErrorMessage(const CompilationRequest& request, const wchar_t* msg, DWORD errorCode = ::GetLastError());
 
       // Private members
       //
       const HWND messageWindow;
       const CompilerMessages messages;
       const CompilerSettings& settings;
-      std::thread compilationThread;
+      DependencyGraph dependencyGraph;
+      OutputCache outputCache;
+
+      std::atomic<bool> cancelled {false};
+      std::mutex processesMutex;
+      std::set<ChildProcess*> runningProcesses;
+
+      // Declared last, so workers are stopped before anything they use is destroyed
+      CompilationQueue queue;
   };
 
 } // namespace
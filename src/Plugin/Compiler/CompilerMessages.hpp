@@ -19,22 +19,49 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "..\CompilationErrorHandling\Error.hpp"
+
 #include <string>
+#include <vector>
 
 #include <windows.h>
 
 namespace papyrus {
 
-  // Remove dependency on parent's message definition to decouple message handling
+  // Remove dependency on parent's message definition to decouple message handling. Each compilation job reports its
+  // completion by one of these messages, with WPARAM pointing to its CompilationRequest and LPARAM carrying details:
+  //   compilationProgressMessage:  pointer to std::vector<Error> with errors newly reported while compiler is running. Not a
+  //                                completion message, and may be sent several times before compilationFailureMessage.
+  //   compilationDoneMessage:      withAnonymization, compilationOnly, restoredFromCache or upToDate
+  //   compilationFailureMessage:   pointer to CompilationErrors
+  //   anonymizationFailureMessage: pointer to error message
+  //   compilerNotFoundMessage:     0
+  //   otherErrordMessage:          pointer to CompilerError
+  // Pointers are only valid while the message is being handled.
   struct CompilerMessages {
     UINT compilationDoneMessage;
     UINT compilationFailureMessage;
+    UINT compilationProgressMessage;
     UINT anonymizationFailureMessage;
     UINT compilerNotFoundMessage;
     UINT otherErrordMessage;
 
-    WPARAM withAnonymization;
-    WPARAM compilationOnly;
+    LPARAM withAnonymization;
+    LPARAM compilationOnly;
+    LPARAM restoredFromCache;
+    LPARAM upToDate;
+  };
+
+  // Errors parsed from compiler output
+  struct CompilationErrors {
+    std::vector<Error> errors;
+    bool hasUnparsableLines;
+  };
+
+  // Unexpected error that stopped compilation
+  struct CompilerError {
+    std::wstring message;
+    std::wstring title;
   };
 
 } // namespace
@@ -55,6 +55,7 @@ namespace papyrus {
     Game autoModeDefaultGame;
     std::wstring autoModeOutputDirectory;
     utility::PrimitiveTypeValueMonitor<bool> allowUnmanagedSource;
+    utility::PrimitiveTypeValueMonitor<bool> skipUpToDateScripts;
 
     const GameSettings& gameSettings(Game game) const;
     GameSettings& gameSettings(Game game);
@@ -0,0 +1,431 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "DependencyGraph.hpp"
+
+#include "../Common/BinaryFile.hpp"
+#include "../Common/StringUtil.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <system_error>
+
+// Graph file format, all numbers in native byte order, strings as uint32 length followed by wchar_t units:
+//   uint32 magic, uint32 version, uint32 script count, then for each scanned script:
+//     string path, int64 modification time, uint32 name count, then each name as string
+//   uint32 build count, then for each compiled script:
+//     string path, string build signature, string output file, int64 output modification time, uint32 input count,
+//     then for each input: string path, int64 modification time
+#define GRAPH_FILE_MAGIC    0x47445050  // "PPDG"
+#define GRAPH_FILE_VERSION  1
+
+namespace papyrus {
+
+  namespace {
+    // Modification time of a probed directory that doesn't exist
+    constexpr int64_t missingFileTime = INT64_MIN;
+
+    // Keywords and primitive types, which are never class names
+    const std::set<std::wstring, std::less<>> keywords {
+      L"as", L"auto", L"autoreadonly", L"betaonly", L"bool", L"collapsed", L"collapsedonbase", L"collapsedonref", L"conditional",
+      L"const", L"customevent", L"debugonly", L"else", L"elseif", L"endevent", L"endfunction", L"endgroup", L"endif",
+      L"endproperty", L"endstate", L"endstruct", L"endwhile", L"event", L"extends", L"false", L"float", L"function", L"global",
+      L"group", L"hidden", L"if", L"import", L"int", L"is", L"length", L"mandatory", L"native", L"new", L"none", L"parent",
+      L"property", L"return", L"scriptname", L"self", L"state", L"string", L"struct", L"true", L"var", L"while"
+    };
+
+    inline bool isKeyword(const std::wstring& name) {
+      return keywords.contains(name);
+    }
+
+    inline bool isIdentifierStart(char ch) {
+      return std::isalpha(static_cast<unsigned char>(ch)) || ch == '_';
+    }
+
+    inline bool isIdentifierChar(char ch) {
+      return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_';
+    }
+  }
+
+  bool DependencyGraph::load(const std::filesystem::path& filePath) {
+    std::lock_guard lock(mutex);
+    graphFilePath = filePath;
+    nodes.clear();
+    builds.clear();
+    modified = false;
+
+    utility::BinaryFileReader file(filePath);
+    uint32_t magic {}, version {}, nodeCount {};
+    if (!file.read(magic) || magic != GRAPH_FILE_MAGIC || !file.read(version) || version != GRAPH_FILE_VERSION || !file.read(nodeCount)) {
+      return false;
+    }
+
+    // Each string takes at least its length, which bounds counts of strings
+    constexpr size_t minStringSize = sizeof(uint32_t);
+
+    std::map<std::wstring, ScriptNode> loadedNodes;
+    std::map<std::wstring, BuildEntry> loadedBuilds;
+    try {
+      for (uint32_t i = 0; i < nodeCount; i++) {
+        std::wstring path;
+        ScriptNode node {};
+        uint32_t nameCount {};
+        if (!file.readString(path) || !file.read(node.modificationTime) || !file.read(nameCount) || nameCount > file.bytesLeft() / minStringSize) {
+          return false;
+        }
+
+        node.names.resize(nameCount);
+        for (auto& name : node.names) {
+          if (!file.readString(name)) {
+            return false;
+          }
+        }
+        loadedNodes.emplace(std::move(path), std::move(node));
+      }
+
+      uint32_t buildCount {};
+      if (!file.read(buildCount)) {
+        return false;
+      }
+
+      for (uint32_t i = 0; i < buildCount; i++) {
+        std::wstring path;
+        BuildEntry build {};
+        uint32_t inputCount {};
+        if (!file.readString(path) || !file.readString(build.buildSignature) || !file.readString(build.outputFile)
+          || !file.read(build.outputTime) || !file.read(inputCount) || inputCount > file.bytesLeft() / (minStringSize + sizeof(int64_t))) {
+          return false;
+        }
+
+        build.inputs.resize(inputCount);
+        for (auto& [inputFile, inputTime] : build.inputs) {
+          if (!file.readString(inputFile) || !file.read(inputTime)) {
+            return false;
+          }
+        }
+        loadedBuilds.emplace(std::move(path), std::move(build));
+      }
+    } catch (const std::exception&) {
+      return false;
+    }
+
+    nodes = std::move(loadedNodes);
+    builds = std::move(loadedBuilds);
+    return true;
+  }
+
+  bool DependencyGraph::save() {
+    std::lock_guard lock(mutex);
+    if (!modified || graphFilePath.empty()) {
+      return true;
+    }
+
+    utility::BinaryFileWriter file(graphFilePath);
+    file.write<uint32_t>(GRAPH_FILE_MAGIC);
+    file.write<uint32_t>(GRAPH_FILE_VERSION);
+    file.write<uint32_t>(static_cast<uint32_t>(nodes.size()));
+    for (const auto& [path, node] : nodes) {
+      file.writeString(path);
+      file.write<int64_t>(node.modificationTime);
+      file.write<uint32_t>(static_cast<uint32_t>(node.names.size()));
+      for (const auto& name : node.names) {
+        file.writeString(name);
+      }
+    }
+
+    file.write<uint32_t>(static_cast<uint32_t>(builds.size()));
+    for (const auto& [path, build] : builds) {
+      file.writeString(path);
+      file.writeString(build.buildSignature);
+      file.writeString(build.outputFile);
+      file.write<int64_t>(build.outputTime);
+      file.write<uint32_t>(static_cast<uint32_t>(build.inputs.size()));
+      for (const auto& [inputFile, inputTime] : build.inputs) {
+        file.writeString(inputFile);
+        file.write<int64_t>(inputTime);
+      }
+    }
+    if (!file.commit()) {
+      return false;
+    }
+    modified = false;
+    return true;
+  }
+
+  bool DependencyGraph::isUpToDate(const std::wstring& scriptFile, const std::wstring& outputFile, const std::wstring& buildSignature) const {
+    BuildEntry build;
+    {
+      std::lock_guard lock(mutex);
+      auto iter = builds.find(utility::toUpper(scriptFile));
+      if (iter == builds.end()) {
+        return false;
+      }
+      build = (*iter).second;
+    }
+
+    if (build.buildSignature != buildSignature || !utility::compare(build.outputFile, outputFile) || modificationTime(outputFile) != build.outputTime) {
+      return false;
+    }
+
+    return std::all_of(build.inputs.begin(), build.inputs.end(),
+      [](const std::pair<std::wstring, int64_t>& input) {
+        return modificationTime(input.first) == input.second;
+      }
+    );
+  }
+
+  void DependencyGraph::recordBuild(const std::wstring& scriptFile, const std::wstring& outputFile, const std::wstring& buildSignature, const file_times_t& inputs) {
+    auto outputTime = modificationTime(outputFile);
+    if (!outputTime) {
+      return;
+    }
+
+    // An input that is newer than output file may have been modified after compiler read it, so the output isn't up to date
+    bool isOutputNewer = !inputs.empty() && std::all_of(inputs.begin(), inputs.end(),
+      [&](const std::pair<std::wstring, int64_t>& input) {
+        return input.second <= outputTime.value();
+      }
+    );
+
+    std::lock_guard lock(mutex);
+    if (isOutputNewer) {
+      builds.insert_or_assign(utility::toUpper(scriptFile), BuildEntry {
+        .buildSignature = buildSignature,
+        .outputFile = outputFile,
+        .outputTime = outputTime.value(),
+        .inputs = inputs
+      });
+    } else {
+      builds.erase(utility::toUpper(scriptFile));
+    }
+    modified = true;
+  }
+
+  DependencyGraph::file_times_t DependencyGraph::getInputs(const std::wstring& scriptFile, const std::vector<std::wstring>& importDirectories, const std::wstring& flagFile) {
+    std::map<std::wstring, std::optional<std::wstring>> importedClasses;
+    file_times_t inputs;
+    std::set<std::wstring> visitedScripts {utility::toUpper(scriptFile)};
+    std::deque<std::wstring> pendingScripts {scriptFile};
+    while (!pendingScripts.empty()) {
+      std::wstring file = std::move(pendingScripts.front());
+      pendingScripts.pop_front();
+      auto fileTime = modificationTime(file);
+      if (!fileTime) {
+        continue;
+      }
+
+      inputs.emplace_back(file, fileTime.value());
+      for (auto& classFile : referencedClasses(file, fileTime.value(), importDirectories, importedClasses)) {
+        if (visitedScripts.insert(utility::toUpper(classFile)).second) {
+          pendingScripts.push_back(std::move(classFile));
+        }
+      }
+    }
+
+    if (!flagFile.empty()) {
+      auto flagFilePath = std::filesystem::path(flagFile).is_absolute() ? std::optional<std::wstring>(flagFile) : findFile(flagFile, importDirectories);
+      if (flagFilePath) {
+        auto flagFileTime = modificationTime(flagFilePath.value());
+        if (flagFileTime) {
+          inputs.emplace_back(flagFilePath.value(), flagFileTime.value());
+        }
+      }
+    }
+
+    return inputs;
+  }
+
+  // Private methods
+  //
+
+  std::vector<std::wstring> DependencyGraph::referencedClasses(const std::wstring& scriptFile, int64_t scriptTime, const std::vector<std::wstring>& importDirectories,
+    std::map<std::wstring, std::optional<std::wstring>>& importedClasses) {
+    std::wstring key = utility::toUpper(scriptFile);
+    std::optional<std::vector<std::wstring>> names;
+    std::optional<Resolution> resolution;
+    {
+      std::lock_guard lock(mutex);
+      auto iter = nodes.find(key);
+      if (iter != nodes.end() && (*iter).second.modificationTime == scriptTime) {
+        const ScriptNode& node = (*iter).second;
+        if (node.resolution && node.resolution.value().importDirectories == importDirectories) {
+          resolution = node.resolution;
+        } else {
+          names = node.names;
+        }
+      }
+    }
+
+    if (resolution) {
+      bool isValid = std::all_of(resolution.value().probedDirectories.begin(), resolution.value().probedDirectories.end(),
+        [](const std::pair<std::wstring, int64_t>& directory) {
+          return modificationTime(directory.first).value_or(missingFileTime) == directory.second;
+        }
+      );
+      if (isValid) {
+        return resolution.value().classFiles;
+      }
+
+      std::lock_guard lock(mutex);
+      names = nodes[key].names;
+    }
+
+    bool scanned = !names;
+    if (scanned) {
+      names = scanNames(scriptFile);
+    }
+
+    // Modification times of directories to probe need to be taken before probing, so any change made meanwhile is caught
+    // next time
+    std::filesystem::path scriptDirectory = std::filesystem::path(scriptFile).parent_path();
+    std::vector<std::pair<std::wstring, std::wstring>> classPaths;
+    std::set<std::wstring> probedDirectories;
+    for (const auto& name : names.value()) {
+      if (isKeyword(name)) {
+        continue;
+      }
+
+      std::wstring relativePath;
+      for (wchar_t ch : name) {
+        // FO4 namespace maps to a subfolder
+        relativePath.push_back((ch == L':') ? static_cast<wchar_t>(std::filesystem::path::preferred_separator) : ch);
+      }
+      relativePath += L".psc";
+
+      std::filesystem::path namespacePath = std::filesystem::path(relativePath).parent_path();
+      for (const auto& directory : importDirectories) {
+        probedDirectories.insert((std::filesystem::path(directory) / namespacePath).wstring());
+      }
+      probedDirectories.insert((scriptDirectory / namespacePath).wstring());
+      classPaths.emplace_back(name, std::move(relativePath));
+    }
+
+    Resolution newResolution;
+    newResolution.importDirectories = importDirectories;
+    for (const auto& directory : probedDirectories) {
+      newResolution.probedDirectories.emplace_back(directory, modificationTime(directory).value_or(missingFileTime));
+    }
+
+    // Names are resolved in import directories first, then the referring script's own folder
+    for (const auto& [name, relativePath] : classPaths) {
+      auto iter = importedClasses.find(name);
+      if (iter == importedClasses.end()) {
+        iter = importedClasses.emplace(name, findFile(relativePath, importDirectories)).first;
+      }
+      std::optional<std::wstring> classFile = (*iter).second ? (*iter).second : findFile(relativePath, std::vector<std::wstring> {scriptDirectory.wstring()});
+      if (classFile) {
+        newResolution.classFiles.push_back(std::move(classFile.value()));
+      }
+    }
+
+    std::vector<std::wstring> classFiles = newResolution.classFiles;
+    std::lock_guard lock(mutex);
+    ScriptNode& node = nodes[key];
+    if (scanned) {
+      node.modificationTime = scriptTime;
+      node.names = std::move(names.value());
+      modified = true;
+    }
+    node.resolution = std::move(newResolution);
+    return classFiles;
+  }
+
+  std::vector<std::wstring> DependencyGraph::scanNames(const std::wstring& scriptFile) {
+    std::ifstream file(std::filesystem::path(scriptFile), std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::set<std::wstring> names;
+    size_t length = text.size();
+    size_t pos = 0;
+    while (pos < length) {
+      char ch = text[pos];
+      if (ch == ';') {
+        if (pos + 1 < length && text[pos + 1] == '/') {
+          // Multi-line comment ;/ ... /;
+          size_t end = text.find("/;", pos + 2);
+          pos = (end == std::string::npos) ? length : end + 2;
+        } else {
+          // Line comment
+          size_t end = text.find('\n', pos + 1);
+          pos = (end == std::string::npos) ? length : end + 1;
+        }
+      } else if (ch == '{') {
+        // Documentation comment
+        size_t end = text.find('}', pos + 1);
+        pos = (end == std::string::npos) ? length : end + 1;
+      } else if (ch == '"') {
+        // String literal, which can't span lines
+        pos++;
+        while (pos < length && text[pos] != '"' && text[pos] != '\n') {
+          pos += (text[pos] == '\\') ? 2 : 1;
+        }
+        pos++;
+      } else if (isIdentifierStart(ch)) {
+        // Identifier, which may be a namespaced name like "Namespace:Class"
+        size_t start = pos;
+        while (pos < length && (isIdentifierChar(text[pos]) || (text[pos] == ':' && pos + 1 < length && isIdentifierStart(text[pos + 1])))) {
+          pos++;
+        }
+
+        std::wstring name;
+        name.reserve(pos - start);
+        for (size_t i = start; i < pos; i++) {
+          name.push_back(static_cast<wchar_t>(std::tolower(static_cast<unsigned char>(text[i]))));
+        }
+        names.insert(std::move(name));
+      } else if (std::isdigit(static_cast<unsigned char>(ch))) {
+        // Number, including hex ones like 0x1F
+        while (pos < length && isIdentifierChar(text[pos])) {
+          pos++;
+        }
+      } else {
+        pos++;
+      }
+    }
+
+    return std::vector<std::wstring>(names.begin(), names.end());
+  }
+
+  std::optional<std::wstring> DependencyGraph::findFile(const std::filesystem::path& relativePath, const std::vector<std::wstring>& directories) {
+    for (const auto& directory : directories) {
+      std::error_code ec;
+      std::filesystem::path path = std::filesystem::path(directory) / relativePath;
+      if (std::filesystem::is_regular_file(path, ec)) {
+        return path.wstring();
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<int64_t> DependencyGraph::modificationTime(const std::wstring& file) {
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(std::filesystem::path(file), ec);
+    if (ec) {
+      return std::nullopt;
+    }
+    return static_cast<int64_t>(time.time_since_epoch().count());
+  }
+
+} // namespace
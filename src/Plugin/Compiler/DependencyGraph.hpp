@@ -0,0 +1,121 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace papyrus {
+
+  // Records what each successfully compiled script depended on, so scripts that are up to date can be skipped.
+  //
+  // A script depends on every class it refers to, i.e. the one it extends, imported ones and ones used as types, and so on
+  // transitively. Referenced names are found by scanning the script's identifiers, and resolved to source files in import
+  // directories (FO4 namespaces map to subfolders), then the script's own folder. Language keywords are never probed, and
+  // names that don't resolve to any file are not classes and are ignored. Scanned names of a script are kept along with its
+  // modification time, so a script is only scanned again after being modified. Class files they resolved to are kept as
+  // well, until import directories change or any directory probed for them has a file added, removed or renamed.
+  //
+  // A compiled script is up to date as long as it's compiled with the same build signature (compiler, flags, directories,
+  // etc.), its output file is unchanged, and none of its inputs, i.e. itself, its dependencies and the flag file, has been
+  // modified since it was compiled. A script that is modified therefore makes all its transitive dependents out of date.
+  //
+  // The graph is persisted to a binary file, so it survives sessions. It is used by both UI thread and compilation worker
+  // threads, so access is synchronized. Files are only scanned and probed without holding the lock.
+  //
+  class DependencyGraph {
+    public:
+      // Files along with their modification times
+      using file_times_t = std::vector<std::pair<std::wstring, int64_t>>;
+
+      // Load graph from the given file, which will also be used when saving. Returns false if the file doesn't exist or is invalid,
+      // in which case the graph starts empty.
+      bool load(const std::filesystem::path& filePath);
+
+      // Save graph to the file it was loaded from, but only when it has been updated since then
+      bool save();
+
+      // Check if the script has been compiled to the given output file with the given build signature, and it's still up to date
+      bool isUpToDate(const std::wstring& scriptFile, const std::wstring& outputFile, const std::wstring& buildSignature) const;
+
+      // Record a successful compilation of the script to the given output file, from inputs collected before compiling it
+      void recordBuild(const std::wstring& scriptFile, const std::wstring& outputFile, const std::wstring& buildSignature, const file_times_t& inputs);
+
+      // Get inputs of the script, i.e. the script itself, all scripts it depends on and the flag file, with the script first.
+      // Referenced classes are resolved with the given import directories, which are also used to find the flag file if it's
+      // not an absolute path.
+      file_times_t getInputs(const std::wstring& scriptFile, const std::vector<std::wstring>& importDirectories, const std::wstring& flagFile);
+
+    private:
+      // Class files that names of a script resolved to with given import directories, and modification times of directories
+      // probed for them
+      struct Resolution {
+        std::vector<std::wstring> importDirectories;
+        file_times_t probedDirectories;
+        std::vector<std::wstring> classFiles;
+      };
+
+      // Names referred to by a script as of its given modification time. Resolution is only kept in memory.
+      struct ScriptNode {
+        int64_t modificationTime;
+        std::vector<std::wstring> names;
+        std::optional<Resolution> resolution;
+      };
+
+      // Last successful compilation of a script
+      struct BuildEntry {
+        std::wstring buildSignature;
+        std::wstring outputFile;
+        int64_t outputTime;
+        file_times_t inputs;
+      };
+
+      // Get class files referred to by the given script. The script is only scanned if it's been modified since last scan, and
+      // its names are only resolved again if their last resolution is no longer valid. Results of probing import directories
+      // are shared through the given map, as they are the same for all scripts.
+      std::vector<std::wstring> referencedClasses(const std::wstring& scriptFile, int64_t scriptTime, const std::vector<std::wstring>& importDirectories,
+        std::map<std::wstring, std::optional<std::wstring>>& importedClasses);
+
+      // Scan the given script for identifiers, which are returned in lower case. Comments and strings are skipped.
+      static std::vector<std::wstring> scanNames(const std::wstring& scriptFile);
+
+      // Find a file with the given relative path in given directories. Returns nullopt if not found.
+      static std::optional<std::wstring> findFile(const std::filesystem::path& relativePath, const std::vector<std::wstring>& directories);
+
+      // Modification time of a file, or nullopt if it doesn't exist
+      static std::optional<int64_t> modificationTime(const std::wstring& file);
+
+      // Private members
+      //
+      mutable std::mutex mutex;
+      std::filesystem::path graphFilePath;
+      std::map<std::wstring, ScriptNode> nodes;   // Keyed by upper case file path
+      std::map<std::wstring, BuildEntry> builds;  // Keyed by upper case file path
+      bool modified {false};
+  };
+
+} // namespace
@@ -0,0 +1,331 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "OutputCache.hpp"
+
+#include "../Common/StringUtil.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+#define HASH_BUFFER_SIZE  65536  // Size of buffer used to read input files when hashing them
+
+namespace papyrus {
+
+  namespace {
+    // 128-bit hash made of two 64-bit FNV-1a lanes with different offset bases and primes, each finalized with MurmurHash3's
+    // avalanche step. It's not cryptographic, but it's more than enough to tell files on a local machine apart.
+    class Hasher {
+      public:
+        void update(const void* data, size_t size) {
+          auto bytes = static_cast<const unsigned char*>(data);
+          for (size_t i = 0; i < size; i++) {
+            lanes.first = (lanes.first ^ bytes[i]) * 0x00000100000001B3;
+            lanes.second = (lanes.second ^ bytes[i]) * 0x9E3779B97F4A7C15;
+          }
+        }
+
+        template <typename T>
+        void update(T value) {
+          update(&value, sizeof(T));
+        }
+
+        void update(const std::wstring& str) {
+          update<uint64_t>(str.size());
+          update(str.data(), str.size() * sizeof(wchar_t));
+        }
+
+        std::pair<uint64_t, uint64_t> finish() const {
+          return std::make_pair(mix(lanes.first), mix(lanes.second));
+        }
+
+      private:
+        static uint64_t mix(uint64_t hash) {
+          hash ^= hash >> 33;
+          hash *= 0xFF51AFD7ED558CCD;
+          hash ^= hash >> 33;
+          hash *= 0xC4CEB9FE1A85EC53;
+          hash ^= hash >> 33;
+          return hash;
+        }
+
+        std::pair<uint64_t, uint64_t> lanes {0xCBF29CE484222325, 0x6C62272E07BB0142};
+    };
+
+    inline int64_t now() {
+      return static_cast<int64_t>(std::filesystem::file_time_type::clock::now().time_since_epoch().count());
+    }
+  }
+
+  OutputCache::OutputCache(uint64_t capacity)
+    : capacity(capacity) {
+  }
+
+  void OutputCache::open(const std::filesystem::path& directory) {
+    std::lock_guard lock(mutex);
+    cacheDirectory = directory;
+    entries.clear();
+    totalSize = 0;
+
+    try {
+      std::filesystem::create_directories(directory);
+      for (const auto& file : std::filesystem::directory_iterator(directory)) {
+        if (file.is_regular_file()) {
+          if (file.path().extension() == L".pex") {
+            entries.insert_or_assign(file.path().stem().wstring(), Entry {
+              .size = file.file_size(),
+              .lastUsed = static_cast<int64_t>(file.last_write_time().time_since_epoch().count())
+            });
+            totalSize += file.file_size();
+          } else if (file.path().extension() == L".tmp") {
+            // Left behind by an interrupted store
+            std::error_code ec;
+            std::filesystem::remove(file.path(), ec);
+          }
+        }
+      }
+    } catch (...) {
+      // Only entries found so far are used
+    }
+
+    evict();
+  }
+
+  std::optional<std::wstring> OutputCache::computeKey(const std::vector<std::wstring>& inputFiles, const std::wstring& compilerFile, const std::wstring& buildSignature) {
+    Hasher hasher;
+    hasher.update(buildSignature);
+
+    // Compiler executable only changes when it's updated, so its size and modification time are enough to identify it
+    std::error_code ec;
+    auto compilerSize = std::filesystem::file_size(compilerFile, ec);
+    auto compilerTime = std::filesystem::last_write_time(compilerFile, ec);
+    if (ec) {
+      return std::nullopt;
+    }
+    hasher.update<uint64_t>(compilerSize);
+    hasher.update<int64_t>(compilerTime.time_since_epoch().count());
+
+    for (size_t i = 0; i < inputFiles.size(); i++) {
+      // Source script's path is stored in generated output, so its full path is part of the key. Other inputs only matter
+      // by their names and contents.
+      const std::wstring& inputFile = inputFiles[i];
+      hasher.update(utility::toUpper((i == 0) ? inputFile : std::filesystem::path(inputFile).filename().wstring()));
+
+      auto fileHash = hashFile(inputFile);
+      if (!fileHash) {
+        return std::nullopt;
+      }
+      hasher.update<uint64_t>(fileHash.value().first);
+      hasher.update<uint64_t>(fileHash.value().second);
+    }
+
+    auto [high, low] = hasher.finish();
+    std::wstringstream key;
+    key << std::hex << std::setfill(L'0') << std::setw(16) << high << std::setw(16) << low;
+    return key.str();
+  }
+
+  bool OutputCache::restore(const std::vector<std::pair<std::wstring, std::wstring>>& outputs) {
+    {
+      std::lock_guard lock(mutex);
+      if (cacheDirectory.empty() || outputs.empty()) {
+        return false;
+      }
+
+      for (const auto& [key, outputFile] : outputs) {
+        if (entries.find(key) == entries.end()) {
+          misses += outputs.size();
+          return false;
+        }
+      }
+
+      // Keep entries from being evicted by other threads while their files are copied
+      pin(outputs);
+    }
+
+    bool copied = true;
+    for (const auto& [key, outputFile] : outputs) {
+      // Update cached file's modification time first, which also becomes output file's when it's preserved by copying
+      std::error_code ec;
+      std::filesystem::last_write_time(cachedFile(key), std::filesystem::file_time_type::clock::now(), ec);
+      std::filesystem::create_directories(std::filesystem::path(outputFile).parent_path(), ec);
+      if (!std::filesystem::copy_file(cachedFile(key), outputFile, std::filesystem::copy_options::overwrite_existing, ec)) {
+        // Output file can't be written
+        copied = false;
+        break;
+      }
+    }
+
+    std::lock_guard lock(mutex);
+    unpin(outputs);
+    if (!copied) {
+      misses += outputs.size();
+      return false;
+    }
+
+    int64_t lastUsed = now();
+    for (const auto& [key, outputFile] : outputs) {
+      auto iter = entries.find(key);
+      if (iter != entries.end()) {
+        (*iter).second.lastUsed = lastUsed;
+      }
+    }
+    hits += outputs.size();
+
+    // Eviction may have been held back by pinned entries
+    evict();
+    return true;
+  }
+
+  void OutputCache::store(const std::vector<std::pair<std::wstring, std::wstring>>& outputs) {
+    if (cacheDirectory.empty()) {
+      return;
+    }
+
+    for (const auto& [key, outputFile] : outputs) {
+      // Copy to a temporary file first, so a cached file is never seen partially written. Each thread uses its own temporary
+      // file, in case the same output is stored by several of them at the same time.
+      std::filesystem::path tempFile = cacheDirectory / (key + L"." + std::to_wstring(std::hash<std::thread::id>()(std::this_thread::get_id())) + L".tmp");
+      std::error_code ec;
+      if (!std::filesystem::copy_file(outputFile, tempFile, std::filesystem::copy_options::overwrite_existing, ec)) {
+        continue;
+      }
+
+      uint64_t size = std::filesystem::file_size(tempFile, ec);
+      if (!ec) {
+        std::filesystem::last_write_time(tempFile, std::filesystem::file_time_type::clock::now(), ec);
+        std::filesystem::rename(tempFile, cachedFile(key), ec);
+      }
+      if (ec) {
+        std::filesystem::remove(tempFile, ec);
+        continue;
+      }
+
+      std::lock_guard lock(mutex);
+      auto iter = entries.find(key);
+      if (iter != entries.end()) {
+        totalSize -= (*iter).second.size;
+      }
+      entries.insert_or_assign(key, Entry {
+        .size = size,
+        .lastUsed = now()
+      });
+      totalSize += size;
+      stores++;
+      evict();
+    }
+  }
+
+  OutputCache::Statistics OutputCache::statistics() const {
+    std::lock_guard lock(mutex);
+    return Statistics {
+      .hits = hits,
+      .misses = misses,
+      .stores = stores,
+      .evictions = evictions,
+      .entries = entries.size(),
+      .totalSize = totalSize
+    };
+  }
+
+  // Private methods
+  //
+
+  std::optional<std::pair<uint64_t, uint64_t>> OutputCache::hashFile(const std::wstring& file) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(file, ec);
+    auto modificationTime = std::filesystem::last_write_time(file, ec);
+    if (ec) {
+      return std::nullopt;
+    }
+
+    FileHash fileHash {
+      .modificationTime = static_cast<int64_t>(modificationTime.time_since_epoch().count()),
+      .size = size,
+      .hash = {}
+    };
+    std::wstring key = utility::toUpper(file);
+    {
+      std::lock_guard lock(mutex);
+      auto iter = fileHashes.find(key);
+      if (iter != fileHashes.end() && (*iter).second.modificationTime == fileHash.modificationTime && (*iter).second.size == fileHash.size) {
+        return (*iter).second.hash;
+      }
+    }
+
+    std::ifstream stream(std::filesystem::path(file), std::ios::binary);
+    if (!stream) {
+      return std::nullopt;
+    }
+
+    Hasher hasher;
+    std::vector<char> buffer(HASH_BUFFER_SIZE);
+    while (stream.read(buffer.data(), buffer.size()) || stream.gcount() > 0) {
+      hasher.update(buffer.data(), static_cast<size_t>(stream.gcount()));
+    }
+    fileHash.hash = hasher.finish();
+
+    std::lock_guard lock(mutex);
+    fileHashes.insert_or_assign(key, fileHash);
+    return fileHash.hash;
+  }
+
+  void OutputCache::evict() {
+    while (totalSize > capacity) {
+      auto oldest = entries.end();
+      for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+        if (pinnedEntries.find((*iter).first) == pinnedEntries.end() && (oldest == entries.end() || (*iter).second.lastUsed < (*oldest).second.lastUsed)) {
+          oldest = iter;
+        }
+      }
+      if (oldest == entries.end()) {
+        // Everything left is being restored
+        break;
+      }
+
+      std::error_code ec;
+      std::filesystem::remove(cachedFile((*oldest).first), ec);
+      totalSize -= (*oldest).second.size;
+      entries.erase(oldest);
+      evictions++;
+    }
+  }
+
+  void OutputCache::pin(const std::vector<std::pair<std::wstring, std::wstring>>& outputs) {
+    for (const auto& [key, outputFile] : outputs) {
+      pinnedEntries[key]++;
+    }
+  }
+
+  void OutputCache::unpin(const std::vector<std::pair<std::wstring, std::wstring>>& outputs) {
+    for (const auto& [key, outputFile] : outputs) {
+      auto iter = pinnedEntries.find(key);
+      if (iter != pinnedEntries.end() && --(*iter).second == 0) {
+        pinnedEntries.erase(iter);
+      }
+    }
+  }
+
+} // namespace
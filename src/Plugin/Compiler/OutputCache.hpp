@@ -0,0 +1,116 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace papyrus {
+
+  // Local cache of compiled PEX files, addressed by a hash of everything that affects compiled output: the source script and
+  // every script it depends on (by content), the flag file, the build signature (compiler flags, directories, anonymization)
+  // and the compiler executable. The same scripts compiled again, e.g. after switching branches or reverting changes, can
+  // then be restored from the cache without running the compiler.
+  //
+  // Cached files are copied rather than hard linked, as compiler and anonymization rewrite output files in place, which would
+  // otherwise corrupt cached ones. Once total size of cached files exceeds capacity, least recently used ones are evicted.
+  // Recency is kept as modification time of cached files, so it survives sessions.
+  //
+  // Content hashes of input files are kept along with their modification times and sizes, so unchanged files aren't read
+  // again. Access is synchronized, as the cache is used by compilation worker threads. Files are not copied while holding
+  // the lock, so entries being restored are pinned and never evicted until their files have been copied.
+  //
+  class OutputCache {
+    public:
+      struct Statistics {
+        size_t hits;
+        size_t misses;
+        size_t stores;
+        size_t evictions;
+        size_t entries;
+        uint64_t totalSize; // In bytes
+      };
+
+      // Capacity is total size of cached files in bytes
+      explicit OutputCache(uint64_t capacity);
+
+      // Use the given directory to store cached files. Files cached in last session are kept unless over capacity.
+      void open(const std::filesystem::path& directory);
+
+      // Compute cache key of output compiled from the given input files, with the given compiler and build signature. Returns
+      // nullopt if any of them can't be read.
+      std::optional<std::wstring> computeKey(const std::vector<std::wstring>& inputFiles, const std::wstring& compilerFile, const std::wstring& buildSignature);
+
+      // Copy cached files of the given keys to their output files, but only if all of them are cached. Returns false on miss.
+      bool restore(const std::vector<std::pair<std::wstring, std::wstring>>& outputs);
+
+      // Add copies of the given output files to the cache under their keys
+      void store(const std::vector<std::pair<std::wstring, std::wstring>>& outputs);
+
+      Statistics statistics() const;
+
+    private:
+      struct Entry {
+        uint64_t size;
+        int64_t lastUsed;
+      };
+
+      struct FileHash {
+        int64_t modificationTime;
+        uint64_t size;
+        std::pair<uint64_t, uint64_t> hash;
+      };
+
+      // Get content hash of a file, which is only read if it has been modified since last time
+      std::optional<std::pair<uint64_t, uint64_t>> hashFile(const std::wstring& file);
+
+      // Evict least recently used entries that aren't pinned until total size is within capacity. Must be called with lock held.
+      void evict();
+
+      // Pin or unpin entries of the given keys. Must be called with lock held.
+      void pin(const std::vector<std::pair<std::wstring, std::wstring>>& outputs);
+      void unpin(const std::vector<std::pair<std::wstring, std::wstring>>& outputs);
+
+      inline std::filesystem::path cachedFile(const std::wstring& key) const { return cacheDirectory / (key + L".pex"); }
+
+      // Private members
+      //
+      mutable std::mutex mutex;
+      uint64_t capacity;
+      std::filesystem::path cacheDirectory;
+      std::map<std::wstring, Entry> entries;
+      std::map<std::wstring, FileHash> fileHashes; // Keyed by upper case file path
+      std::map<std::wstring, size_t> pinnedEntries; // Pin count of entries being restored
+      uint64_t totalSize {};
+
+      size_t hits {};
+      size_t misses {};
+      size_t stores {};
+      size_t evictions {};
+  };
+
+} // namespace
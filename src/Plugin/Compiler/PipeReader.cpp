@@ -0,0 +1,92 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "PipeReader.hpp"
+
+#define READ_CHUNK_SIZE  4096  // Size of each read from the pipe
+
+namespace papyrus {
+
+  PipeReader::PipeReader(read_t read, lines_callback_t onLines)
+    : read(read), onLines(onLines), readerThread(&PipeReader::run, this) {
+  }
+
+  PipeReader::~PipeReader() {
+    join();
+  }
+
+  void PipeReader::join() {
+    if (readerThread.joinable()) {
+      readerThread.join();
+    }
+  }
+
+  // Private methods
+  //
+
+  void PipeReader::run() {
+    std::vector<char> buffer(READ_CHUNK_SIZE);
+    std::string pendingText; // Text after last line terminator
+    std::vector<std::string> lines;
+    while (true) {
+      int64_t size = read(buffer.data(), buffer.size());
+      if (size <= 0) {
+        failed = failed || (size < 0);
+        break;
+      }
+
+      totalBytes += static_cast<size_t>(size);
+      pendingText.append(buffer.data(), static_cast<size_t>(size));
+      size_t lineStart = 0;
+      size_t lineEnd {};
+      while ((lineEnd = pendingText.find('\n', lineStart)) != std::string::npos) {
+        size_t lineLength = lineEnd - lineStart;
+        if (lineLength > 0 && pendingText[lineEnd - 1] == '\r') {
+          lineLength--;
+        }
+        lines.emplace_back(pendingText, lineStart, lineLength);
+        lineStart = lineEnd + 1;
+      }
+      pendingText.erase(0, lineStart);
+      handleLines(lines);
+    }
+
+    // Last line may not be terminated
+    if (!pendingText.empty()) {
+      if (pendingText.back() == '\r') {
+        pendingText.pop_back();
+      }
+      lines.push_back(std::move(pendingText));
+      handleLines(lines);
+    }
+  }
+
+  void PipeReader::handleLines(std::vector<std::string>& lines) {
+    if (!lines.empty()) {
+      try {
+        onLines(lines);
+      } catch (...) {
+        failed = true;
+      }
+      lines.clear();
+    }
+  }
+
+} // namespace
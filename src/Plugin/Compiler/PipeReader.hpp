@@ -0,0 +1,78 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace papyrus {
+
+  // Reads output of a child process from a pipe on its own thread, in small chunks as soon as it's written, so the pipe never
+  // fills up and blocks the process no matter how much it writes. Complete lines are passed to the given callback as they
+  // are read, with line terminators removed. Reading the pipe itself is left to the given function, so the reader doesn't
+  // depend on any platform API.
+  //
+  class PipeReader {
+    public:
+      // Read up to the given number of bytes into buffer. Returns number of bytes read, 0 once the pipe is closed, or -1 on error.
+      using read_t = std::function<int64_t(char* buffer, size_t size)>;
+
+      // Handle lines read from the pipe. Invoked on reader thread.
+      using lines_callback_t = std::function<void(const std::vector<std::string>& lines)>;
+
+      PipeReader(read_t read, lines_callback_t onLines);
+      ~PipeReader();
+
+      // Disable all copy/move constructor/assignment operator
+      PipeReader(const PipeReader&) = delete;
+      PipeReader(PipeReader&& other) = delete;
+      PipeReader& operator=(const PipeReader&) = delete;
+      PipeReader& operator=(PipeReader&& other) = delete;
+
+      // Wait until the pipe is closed and all lines are handled
+      void join();
+
+      // Only valid after join
+      inline size_t bytesRead() const { return totalBytes; }
+      inline bool hasFailed() const { return failed; }
+
+    private:
+      // Reader thread function that reads the pipe until it's closed
+      void run();
+
+      // Pass lines to callback, which is not allowed to stop reader from draining the pipe
+      void handleLines(std::vector<std::string>& lines);
+
+      // Private members
+      //
+      read_t read;
+      lines_callback_t onLines;
+      size_t totalBytes {};
+      bool failed {false};
+
+      // Declared last, so reader thread is started after everything it uses is initialized
+      std::thread readerThread;
+  };
+
+} // namespace
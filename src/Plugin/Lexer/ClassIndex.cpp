@@ -0,0 +1,191 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClassIndex.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <system_error>
+
+#define CHECK_INTERVAL  2000  // How often import directories are checked for changes, in milliseconds
+
+namespace papyrus {
+
+  namespace {
+    // Shared by all indexes, so a lexer can tell that content changed by version alone even when game or index is switched
+    std::atomic<unsigned int> lastContentVersion {0};
+
+    // Modification time recorded for import directories that don't exist or are inaccessible
+    constexpr int64_t missingDirectoryTime = (std::numeric_limits<int64_t>::min)();
+
+    bool isScriptSource(const std::filesystem::path& path) {
+      std::wstring extension = path.extension().wstring();
+      return extension.size() == 4 && extension[0] == L'.' && std::towlower(extension[1]) == L'p' && std::towlower(extension[2]) == L's' && std::towlower(extension[3]) == L'c';
+    }
+  }
+
+  ClassIndex::ClassIndex(const std::vector<std::wstring>& importDirectories, class_index_callback_t onUpdated, ClassIndexCache* cache)
+    : importDirectories(importDirectories), onUpdated(std::move(onUpdated)), cache(cache), directoryStates(importDirectories.size()) {
+    // Trust cached names for now, so the index is ready immediately. Worker thread will check whether they are still valid.
+    if (cache) {
+      cache->addUsers(importDirectories);
+      bool allCached = true;
+      for (size_t i = 0; i < importDirectories.size(); i++) {
+        auto entry = cache->find(importDirectories[i]);
+        if (!entry) {
+          allCached = false;
+          break;
+        }
+        directoryStates[i].entry = std::move(*entry);
+      }
+      if (allCached) {
+        update();
+      }
+    }
+
+    try {
+      workerThread = std::thread([this]() { run(); });
+    } catch (const std::system_error&) {
+      // Without the worker thread the index may never become ready, in which case lexer checks import directories by itself
+    }
+  }
+
+  ClassIndex::~ClassIndex() {
+    stop();
+    if (cache) {
+      cache->removeUsers(importDirectories);
+    }
+  }
+
+  void ClassIndex::stop() {
+    {
+      std::lock_guard lock(stopMutex);
+      stopping = true;
+    }
+    stopCondition.notify_all();
+    if (workerThread.joinable()) {
+      workerThread.join();
+    }
+  }
+
+  bool ClassIndex::contains(std::string_view name) const {
+    std::shared_lock lock(mutex);
+    return classNames.find(name) != classNames.end();
+  }
+
+  // Private methods
+  //
+
+  void ClassIndex::run() {
+    std::unique_lock lock(stopMutex);
+    do {
+      lock.unlock();
+      if (refresh()) {
+        update();
+        if (cache) {
+          cache->save();
+        }
+      }
+      lock.lock();
+    } while (!stopCondition.wait_for(lock, std::chrono::milliseconds(CHECK_INTERVAL), [this] { return stopping.load(); }));
+  }
+
+  bool ClassIndex::refresh() {
+    bool changed = false;
+    for (size_t i = 0; i < importDirectories.size() && !stopping; i++) {
+      const auto& directory = importDirectories[i];
+      DirectoryState& state = directoryStates[i];
+
+      // Directory's modification time needs to be taken before scanning, so any change made during the scan is caught next time
+      std::error_code ec;
+      auto modificationTime = std::filesystem::last_write_time(directory, ec);
+      int64_t currentTime = (ec ? missingDirectoryTime : static_cast<int64_t>(modificationTime.time_since_epoch().count()));
+      if (state.scanned && state.entry.modificationTime == currentTime) {
+        continue;
+      }
+
+      state.scanned = true;
+      changed = true;
+      if (currentTime == missingDirectoryTime) {
+        state.entry = ClassIndexCache::DirectoryEntry {
+          .modificationTime = currentTime,
+          .classNames = ClassIndexCache::name_list_t()
+        };
+        continue;
+      }
+
+      // Names cached by constructor may already be valid. Otherwise check if cache has been updated by another index.
+      if (state.entry.modificationTime != currentTime && cache) {
+        auto cachedEntry = cache->find(directory);
+        if (cachedEntry) {
+          state.entry = std::move(*cachedEntry);
+        }
+      }
+      if (state.entry.modificationTime != currentTime) {
+        state.entry.modificationTime = currentTime;
+        state.entry.classNames.clear();
+        scanDirectory(directory, state.entry.classNames);
+        if (cache) {
+          cache->update(directory, ClassIndexCache::DirectoryEntry(state.entry));
+        }
+      }
+    }
+    return changed && !stopping;
+  }
+
+  void ClassIndex::scanDirectory(const std::wstring& directory, ClassIndexCache::name_list_t& classNames) const {
+    std::error_code ec;
+    for (auto iter = std::filesystem::directory_iterator(directory, ec); !ec && iter != std::filesystem::directory_iterator(); iter.increment(ec)) {
+      const auto& path = iter->path();
+      if (isScriptSource(path) && iter->is_regular_file(ec)) {
+        // Identifiers are ASCII only, so a file name with any other character can never match
+        std::wstring stem = path.stem().wstring();
+        if (std::find_if(stem.begin(), stem.end(), [](wchar_t ch) { return ch > 0x7F; }) == stem.end()) {
+          std::string name;
+          std::transform(stem.begin(), stem.end(), std::back_inserter(name), [](wchar_t ch) { return static_cast<char>(std::towlower(ch)); });
+          classNames.push_back(std::move(name));
+        }
+      }
+    }
+  }
+
+  void ClassIndex::update() {
+    name_set_t names;
+    for (const auto& state : directoryStates) {
+      names.insert(state.entry.classNames.begin(), state.entry.classNames.end());
+    }
+
+    {
+      std::unique_lock lock(mutex);
+      if (isReady() && names == classNames) {
+        return;
+      }
+      classNames = std::move(names);
+      contentVersion = ++lastContentVersion;
+    }
+    if (onUpdated) {
+      onUpdated();
+    }
+  }
+
+} // namespace
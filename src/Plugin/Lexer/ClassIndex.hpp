@@ -0,0 +1,118 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "ClassIndexCache.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace papyrus {
+
+  using class_index_callback_t = std::function<void()>;
+
+  // Index of class names defined in import directories, i.e. stems of script source files, stored in lower case.
+  //
+  // The index is built on a worker thread, which then keeps checking modification times of import directories and rescans
+  // any directory that has changed, i.e. had a file added, removed or renamed. Every time the index content changes, the
+  // given callback is invoked on the worker thread, so documents using it can be restyled.
+  //
+  // When a cache is provided and it has entries for all import directories, the index is ready as soon as it is constructed.
+  // The worker thread then only rescans directories modified since they were cached.
+  //
+  class ClassIndex {
+    public:
+      ClassIndex(const std::vector<std::wstring>& importDirectories, class_index_callback_t onUpdated, ClassIndexCache* cache = nullptr);
+      ~ClassIndex();
+
+      // Disable all copy/move constructor/assignment operator
+      ClassIndex(const ClassIndex&) = delete;
+      ClassIndex(ClassIndex&& other) = delete;
+      ClassIndex& operator=(const ClassIndex&) = delete;
+      ClassIndex& operator=(ClassIndex&& other) = delete;
+
+      inline const std::vector<std::wstring>& directories() const { return importDirectories; }
+
+      // Stop worker thread, after which the index no longer updates cache. Content stays available.
+      void stop();
+
+      // Before import directories are scanned for the first time, the index can't tell whether a name is a class
+      inline bool isReady() const { return contentVersion != 0; }
+
+      // Version of index content, unique among all indexes. Changes every time index content changes, and stays 0 until the
+      // index is ready.
+      inline unsigned int version() const { return contentVersion; }
+
+      // Check if the given lower case name is a class
+      bool contains(std::string_view name) const;
+
+    private:
+      // Allow looking up names with string_view without constructing a string
+      struct NameHash {
+        using is_transparent = void;
+        inline size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>()(name); }
+      };
+      using name_set_t = std::unordered_set<std::string, NameHash, std::equal_to<>>;
+
+      // Class names of an import directory as of its modification time. Only accessed by worker thread once it starts.
+      struct DirectoryState {
+        bool scanned {false};
+        ClassIndexCache::DirectoryEntry entry;
+      };
+
+      // Worker thread function that keeps checking import directories until stopped
+      void run();
+
+      // Rescan import directories modified since last check, using cached names when they are still valid. Returns whether
+      // any directory has changed.
+      bool refresh();
+
+      // Scan a directory for script source files
+      void scanDirectory(const std::wstring& directory, ClassIndexCache::name_list_t& classNames) const;
+
+      // Replace index content if it is different from class names of all directories
+      void update();
+
+      // Private members
+      //
+      const std::vector<std::wstring> importDirectories;
+      const class_index_callback_t onUpdated;
+      ClassIndexCache* const cache;
+      std::vector<DirectoryState> directoryStates;
+
+      mutable std::shared_mutex mutex;
+      name_set_t classNames;
+      std::atomic<unsigned int> contentVersion {0};
+
+      std::mutex stopMutex;
+      std::condition_variable stopCondition;
+      std::atomic<bool> stopping {false};
+      std::thread workerThread;
+  };
+
+} // namespace
@@ -0,0 +1,149 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClassIndexCache.hpp"
+
+#include "../Common/BinaryFile.hpp"
+
+#include <algorithm>
+
+// Cache file format, all numbers in native byte order:
+//   uint32 magic, uint32 version, uint32 directory count, then for each directory:
+//     uint32 path length, path in wchar_t units, int64 modification time, uint32 name count, then for each name:
+//       uint16 name length, name in ASCII
+#define CACHE_FILE_MAGIC    0x49435050  // "PPCI"
+#define CACHE_FILE_VERSION  1
+#define MAX_PATH_LENGTH     32767       // Longest path Windows supports, in wchar_t units
+
+namespace papyrus {
+
+  bool ClassIndexCache::load(const std::filesystem::path& filePath) {
+    std::lock_guard lock(mutex);
+    cacheFilePath = filePath;
+    entries.clear();
+    modified = false;
+
+    utility::BinaryFileReader file(filePath);
+    uint32_t magic {}, version {}, directoryCount {};
+    if (!file.read(magic) || magic != CACHE_FILE_MAGIC || !file.read(version) || version != CACHE_FILE_VERSION || !file.read(directoryCount)) {
+      return false;
+    }
+
+    std::map<std::wstring, DirectoryEntry> loadedEntries;
+    try {
+      for (uint32_t i = 0; i < directoryCount; i++) {
+        std::wstring directory;
+        DirectoryEntry entry {};
+        uint32_t nameCount {};
+        if (!file.readString(directory) || directory.size() > MAX_PATH_LENGTH || !file.read(entry.modificationTime) || !file.read(nameCount)
+          || nameCount > file.bytesLeft() / sizeof(uint16_t)) {
+          return false;
+        }
+
+        entry.classNames.reserve(nameCount);
+        for (uint32_t j = 0; j < nameCount; j++) {
+          uint16_t nameLength {};
+          if (!file.read(nameLength) || nameLength > file.bytesLeft()) {
+            return false;
+          }
+          std::string name(nameLength, '\0');
+          if (!file.readBytes(name.data(), nameLength)) {
+            return false;
+          }
+          entry.classNames.push_back(std::move(name));
+        }
+        loadedEntries.emplace(std::move(directory), std::move(entry));
+      }
+    } catch (const std::exception&) {
+      return false;
+    }
+
+    entries = std::move(loadedEntries);
+    return true;
+  }
+
+  bool ClassIndexCache::save() {
+    std::lock_guard lock(mutex);
+    auto isUsed = [&](const std::wstring& directory) { return directoryUsers.contains(directory); };
+    auto usedEntryCount = std::count_if(entries.begin(), entries.end(), [&](const auto& item) { return isUsed(item.first); });
+    bool hasUnusedEntries = (static_cast<size_t>(usedEntryCount) != entries.size());
+    if ((!modified && !hasUnusedEntries) || cacheFilePath.empty()) {
+      return true;
+    }
+
+    utility::BinaryFileWriter file(cacheFilePath);
+    file.write<uint32_t>(CACHE_FILE_MAGIC);
+    file.write<uint32_t>(CACHE_FILE_VERSION);
+    file.write<uint32_t>(static_cast<uint32_t>(usedEntryCount));
+    for (const auto& [directory, entry] : entries) {
+      if (!isUsed(directory)) {
+        continue;
+      }
+      file.writeString(directory);
+      file.write<int64_t>(entry.modificationTime);
+      file.write<uint32_t>(static_cast<uint32_t>(entry.classNames.size()));
+      for (const auto& name : entry.classNames) {
+        file.write<uint16_t>(static_cast<uint16_t>(name.size()));
+        file.writeBytes(name.data(), name.size());
+      }
+    }
+    if (!file.commit()) {
+      return false;
+    }
+    modified = false;
+    return true;
+  }
+
+  std::optional<ClassIndexCache::DirectoryEntry> ClassIndexCache::find(const std::wstring& directory) const {
+    std::lock_guard lock(mutex);
+    auto iter = entries.find(directory);
+    if (iter != entries.end()) {
+      return (*iter).second;
+    }
+    return std::nullopt;
+  }
+
+  void ClassIndexCache::update(const std::wstring& directory, DirectoryEntry&& entry) {
+    std::lock_guard lock(mutex);
+    auto iter = entries.find(directory);
+    if (iter == entries.end() || (*iter).second.modificationTime != entry.modificationTime || (*iter).second.classNames != entry.classNames) {
+      entries.insert_or_assign(directory, std::move(entry));
+      modified = true;
+    }
+  }
+
+  void ClassIndexCache::addUsers(const std::vector<std::wstring>& directories) {
+    std::lock_guard lock(mutex);
+    for (const auto& directory : directories) {
+      directoryUsers[directory]++;
+    }
+  }
+
+  void ClassIndexCache::removeUsers(const std::vector<std::wstring>& directories) {
+    std::lock_guard lock(mutex);
+    for (const auto& directory : directories) {
+      auto iter = directoryUsers.find(directory);
+      if (iter != directoryUsers.end() && --(*iter).second == 0) {
+        directoryUsers.erase(iter);
+        modified = modified || entries.contains(directory);
+      }
+    }
+  }
+
+} // namespace
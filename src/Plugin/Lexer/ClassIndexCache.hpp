@@ -0,0 +1,76 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  // Class names found in each scanned import directory, along with the directory's modification time at the time of scan.
+  // Since adding, removing or renaming a file updates the modification time of the directory it is in, cached names of a
+  // directory remain valid as long as its modification time stays the same.
+  //
+  // The cache is persisted to a binary file so class indexes can be ready right after startup, and only directories
+  // changed since last session need to be scanned again. It is shared by class indexes of all games, so access is synchronized.
+  // Only entries of directories used by a class index are saved, so directories no longer configured are dropped.
+  //
+  class ClassIndexCache {
+    public:
+      using name_list_t = std::vector<std::string>;
+
+      struct DirectoryEntry {
+        int64_t modificationTime;
+        name_list_t classNames;
+      };
+
+      // Load cache from the given file, which will also be used when saving. Returns false if the file doesn't exist or is invalid,
+      // in which case the cache starts empty.
+      bool load(const std::filesystem::path& filePath);
+
+      // Save cache to the file it was loaded from, but only when it has been updated since then
+      bool save();
+
+      // Get cached entry of a directory
+      std::optional<DirectoryEntry> find(const std::wstring& directory) const;
+
+      // Add or replace cached entry of a directory
+      void update(const std::wstring& directory, DirectoryEntry&& entry);
+
+      // Track directories used by a class index, which are the only ones saved
+      void addUsers(const std::vector<std::wstring>& directories);
+      void removeUsers(const std::vector<std::wstring>& directories);
+
+    private:
+      // Private members
+      //
+      mutable std::mutex mutex;
+      std::filesystem::path cacheFilePath;
+      std::map<std::wstring, DirectoryEntry> entries;
+      std::map<std::wstring, size_t> directoryUsers;
+      bool modified {false};
+  };
+
+} // namespace
@@ -0,0 +1,85 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ClassNameCache.hpp"
+
+#define ENTRY_OVERHEAD 64  // Approximate size of list and hash map nodes besides the entry itself
+
+namespace papyrus {
+
+  ClassNameCache::ClassNameCache(size_t capacity)
+    : capacity(capacity) {
+  }
+
+  std::optional<bool> ClassNameCache::find(std::string_view name) {
+    auto iterEntry = entryMap.find(name);
+    if (iterEntry == entryMap.end()) {
+      return std::nullopt;
+    }
+
+    entries.splice(entries.begin(), entries, iterEntry->second);
+    return iterEntry->second->isClass;
+  }
+
+  void ClassNameCache::insert(std::string_view name, bool isClass) {
+    auto iterEntry = entryMap.find(name);
+    if (iterEntry != entryMap.end()) {
+      iterEntry->second->isClass = isClass;
+      entries.splice(entries.begin(), entries, iterEntry->second);
+      return;
+    }
+
+    entries.push_front(Entry {
+      .name = std::string(name),
+      .isClass = isClass
+    });
+    entryMap.emplace(entries.front().name, entries.begin());
+    usage += entryCost(entries.front());
+    evict();
+  }
+
+  void ClassNameCache::setCapacity(size_t newCapacity) {
+    capacity = newCapacity;
+    evict();
+  }
+
+  void ClassNameCache::clear() {
+    entryMap.clear();
+    entries.clear();
+    usage = 0;
+  }
+
+  // Private methods
+  //
+
+  size_t ClassNameCache::entryCost(const Entry& entry) {
+    return sizeof(Entry) + entry.name.capacity() + ENTRY_OVERHEAD;
+  }
+
+  void ClassNameCache::evict() {
+    while (usage > capacity && !entries.empty()) {
+      const Entry& entry = entries.back();
+      entryMap.erase(entry.name);
+      usage -= entryCost(entry);
+      entries.pop_back();
+    }
+  }
+
+} // namespace
@@ -0,0 +1,75 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#define DEFAULT_CLASS_NAME_CACHE_SIZE 256  // In KB
+
+namespace papyrus {
+
+  // Least recently used cache of whether names are classes, i.e. whether there are source files with these names in import
+  // directories. Both class names and names that aren't classes are cached. Memory used by the entries is accounted, and
+  // least recently used names are evicted once it goes over capacity.
+  //
+  class ClassNameCache {
+    public:
+      // Capacity is in bytes
+      explicit ClassNameCache(size_t capacity);
+
+      // Check if a lower case name is a class, if the name is cached. A found name becomes the most recently used one.
+      std::optional<bool> find(std::string_view name);
+
+      // Cache whether a lower case name is a class
+      void insert(std::string_view name, bool isClass);
+
+      void setCapacity(size_t newCapacity);
+      void clear();
+
+      inline size_t size() const { return entries.size(); }
+      inline size_t memoryUsage() const { return usage; }
+
+    private:
+      struct Entry {
+        std::string name;
+        bool isClass;
+      };
+      using entry_list_t = std::list<Entry>;
+
+      // Approximate memory used by an entry, including its nodes in the list and the map
+      static size_t entryCost(const Entry& entry);
+
+      // Evict least recently used entries until memory usage is within capacity
+      void evict();
+
+      // Private members
+      //
+      entry_list_t entries; // Most recently used first
+      std::unordered_map<std::string_view, entry_list_t::iterator> entryMap; // Keys refer to names stored in entries
+      size_t capacity;
+      size_t usage {0};
+  };
+
+} // namespace
@@ -0,0 +1,283 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ClassResolver.hpp"
+
+#include <system_error>
+
+namespace papyrus {
+
+  ClassResolver::ClassResolver(size_t cacheCapacity)
+    : cacheCapacity(cacheCapacity) {
+    try {
+      workerThread = std::thread([this]() { run(); });
+    } catch (const std::system_error&) {
+      // Without the worker thread names are resolved right away when they are looked up
+    }
+  }
+
+  ClassResolver::~ClassResolver() {
+    stop();
+  }
+
+  void ClassResolver::loadIndexCache(const std::filesystem::path& filePath) {
+    classIndexCache.load(filePath);
+  }
+
+  void ClassResolver::shutdown() {
+    stop();
+
+    // Destroying a class index waits for its worker thread, so indexes are only taken out under the lock and destroyed after
+    // it's released, to not block lookups in the meantime. Cache is saved while they still use their directories, but after
+    // their worker threads no longer update it.
+    std::vector<std::unique_ptr<ClassIndex>> classIndexes;
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex);
+      for (auto& [game, state] : games) {
+        classIndexes.push_back(std::move(state.classIndex));
+      }
+    }
+    for (auto& classIndex : classIndexes) {
+      if (classIndex) {
+        classIndex->stop();
+      }
+    }
+    classIndexCache.save();
+    classIndexes.clear();
+  }
+
+  void ClassResolver::setImportDirectories(Game game, const std::vector<std::wstring>& importDirectories, class_index_callback_t onUpdated) {
+    // Declared before the lock, so a replaced class index is destroyed after the lock is released, same as in shutdown()
+    std::unique_ptr<ClassIndex> replacedClassIndex;
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    GameState& state = (*games.try_emplace(game, cacheCapacity).first).second;
+    state.importDirectories = importDirectories;
+    state.onUpdated = onUpdated;
+    if (!state.classIndex || state.classIndex->directories() != importDirectories) {
+      replacedClassIndex = std::move(state.classIndex);
+      {
+        std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+        state.classNameCache.clear();
+        state.resolvedNames.clear();
+      }
+      state.classIndex = std::make_unique<ClassIndex>(importDirectories, onUpdated, &classIndexCache);
+    }
+  }
+
+  std::optional<bool> ClassResolver::resolveClassName(Game game, std::string_view name, bool useCache) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iterState = games.find(game);
+    if (iterState == games.end()) {
+      return false;
+    }
+
+    GameState& state = (*iterState).second;
+    if (state.classIndex && state.classIndex->isReady()) {
+      return state.classIndex->contains(name);
+    }
+
+    // Class index isn't ready yet. Use the result of an earlier probe if there is one.
+    {
+      std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+      if (useCache) {
+        std::optional<bool> cached = state.classNameCache.find(name);
+        if (cached) {
+          return cached;
+        }
+      } else {
+        std::optional<bool> resolved = state.resolvedNames.find(name);
+        if (resolved) {
+          return resolved;
+        }
+      }
+    }
+
+    if (!workerThread.joinable()) {
+      bool found = probeImportDirectories(state.importDirectories, name);
+      if (useCache) {
+        std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+        state.classNameCache.insert(name, found);
+      }
+      return found;
+    }
+
+    Request request {
+      .game = game,
+      .name = std::string(name),
+      .useCache = useCache
+    };
+    {
+      std::lock_guard<std::mutex> queueLock(queueMutex);
+      if (pendingNames.emplace(game, request.name).second) {
+        queue.push_back(std::move(request));
+        queueCondition.notify_one();
+      }
+    }
+    return std::nullopt;
+  }
+
+  unsigned int ClassResolver::classIndexVersion(Game game) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iterState = games.find(game);
+    if (iterState == games.end() || !(*iterState).second.classIndex) {
+      return 0;
+    }
+    return (*iterState).second.classIndex->version();
+  }
+
+  void ClassResolver::setCacheCapacity(size_t newCapacity) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    cacheCapacity = newCapacity;
+    for (auto& [game, state] : games) {
+      std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+      state.classNameCache.setCapacity(newCapacity);
+    }
+  }
+
+  void ClassResolver::clearCaches() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (auto& [game, state] : games) {
+      std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+      state.classNameCache.clear();
+      state.resolvedNames.clear();
+    }
+  }
+
+  ClassResolver::CacheUsage ClassResolver::cacheUsage(Game game) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iterState = games.find(game);
+    if (iterState == games.end()) {
+      return CacheUsage {};
+    }
+
+    const GameState& state = (*iterState).second;
+    std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+    return CacheUsage {
+      .names = state.classNameCache.size(),
+      .memoryUsage = state.classNameCache.memoryUsage()
+    };
+  }
+
+  // Private methods
+  //
+
+  void ClassResolver::run() {
+    std::vector<Request> requests;
+    std::unique_lock<std::mutex> queueLock(queueMutex);
+    while (true) {
+      queueCondition.wait(queueLock, [this] { return stopping || !queue.empty(); });
+      if (stopping) {
+        break;
+      }
+
+      // Take all queued names at once, so a document full of unresolved names only gets restyled once per batch
+      requests.swap(queue);
+      queueLock.unlock();
+      resolve(requests);
+      queueLock.lock();
+
+      for (const auto& request : requests) {
+        pendingNames.erase(std::make_pair(request.game, request.name));
+      }
+      requests.clear();
+    }
+  }
+
+  void ClassResolver::resolve(std::vector<Request>& requests) {
+    // Import directories are copied so no lock is held while probing them, which may take a while on slow or network drives
+    std::map<Game, std::vector<std::wstring>> importDirectories;
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      for (const auto& request : requests) {
+        auto iterState = games.find(request.game);
+        if (iterState != games.end()) {
+          importDirectories.try_emplace(request.game, (*iterState).second.importDirectories);
+        }
+      }
+    }
+
+    std::set<Game> resolvedGames;
+    for (const auto& request : requests) {
+      auto iterDirectories = importDirectories.find(request.game);
+      if (iterDirectories != importDirectories.end()) {
+        bool found = probeImportDirectories((*iterDirectories).second, request.name);
+        if (storeResult(request.game, (*iterDirectories).second, request, found)) {
+          resolvedGames.insert(request.game);
+        }
+      }
+      if (stopping) {
+        return;
+      }
+    }
+
+    std::vector<class_index_callback_t> callbacks;
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      for (Game game : resolvedGames) {
+        auto iterState = games.find(game);
+        if (iterState != games.end() && (*iterState).second.onUpdated) {
+          callbacks.push_back((*iterState).second.onUpdated);
+        }
+      }
+    }
+    for (const auto& callback : callbacks) {
+      callback();
+    }
+  }
+
+  bool ClassResolver::storeResult(Game game, const std::vector<std::wstring>& importDirectories, const Request& request, bool isClass) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto iterState = games.find(game);
+    if (iterState == games.end() || (*iterState).second.importDirectories != importDirectories) {
+      return false;
+    }
+
+    GameState& state = (*iterState).second;
+    std::lock_guard<std::mutex> cacheLock(state.cacheMutex);
+    if (request.useCache) {
+      state.classNameCache.insert(request.name, isClass);
+    } else {
+      state.resolvedNames.insert(request.name, isClass);
+    }
+    return true;
+  }
+
+  bool ClassResolver::probeImportDirectories(const std::vector<std::wstring>& importDirectories, std::string_view name) {
+    for (const auto& path : importDirectories) {
+      std::error_code ec;
+      if (std::filesystem::is_regular_file(std::filesystem::path(path) / (std::string(name) + ".psc"), ec)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void ClassResolver::stop() {
+    {
+      std::lock_guard<std::mutex> queueLock(queueMutex);
+      stopping = true;
+    }
+    queueCondition.notify_all();
+    if (workerThread.joinable()) {
+      workerThread.join();
+    }
+  }
+
+} // namespace
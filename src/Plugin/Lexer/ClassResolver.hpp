@@ -0,0 +1,155 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "ClassIndex.hpp"
+#include "ClassIndexCache.hpp"
+#include "ClassNameCache.hpp"
+#include "../Common/Game.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define RESOLVED_NAMES_CAPACITY (1024 * 1024)  // In bytes. Names resolved while class name cache isn't in use are kept up to this size.
+
+namespace papyrus {
+
+  using Game = game::Game;
+
+  // Process-wide service that resolves whether names are classes for each game, shared by all lexer instances regardless
+  // of which buffer or view they are lexing.
+  //
+  // Names are looked up in the game's class index once it is ready. Before that, lookups never wait on disk I/O. A name that
+  // hasn't been resolved yet is queued to a worker thread, which probes import directories for a source file with the name.
+  // Results are kept in the game's class name cache when caching is in use. Otherwise they are kept until import directories
+  // change, with least recently used ones dropped beyond RESOLVED_NAMES_CAPACITY.
+  // Once a batch of names is resolved, the callback given along with the game's import directories is invoked on the worker
+  // thread, so lines styled while the names were pending can be restyled.
+  //
+  // Access is read-mostly: lookups only take a shared lock, so they can run concurrently, while changing import directories
+  // takes an exclusive one. Class name caches reorder entries on lookup, so each of them is guarded by its own mutex that is
+  // only held while the cache is accessed. Neither is held while probing import directories.
+  //
+  class ClassResolver {
+    public:
+      struct CacheUsage {
+        size_t names;
+        size_t memoryUsage; // In bytes
+      };
+
+      // Capacity of class name caches is in bytes
+      explicit ClassResolver(size_t cacheCapacity);
+      ~ClassResolver();
+
+      // Disable all copy/move constructor/assignment operator
+      ClassResolver(const ClassResolver&) = delete;
+      ClassResolver(ClassResolver&& other) = delete;
+      ClassResolver& operator=(const ClassResolver&) = delete;
+      ClassResolver& operator=(ClassResolver&& other) = delete;
+
+      // Load class names cached in last session, which should be done before any import directories are set
+      void loadIndexCache(const std::filesystem::path& filePath);
+
+      // Stop all worker threads and save class names cached by class indexes
+      void shutdown();
+
+      // Set import directories of a game. Class index of the game is rebuilt, and its cached class names are dropped, only when
+      // import directories are changed. The given callback is invoked on a worker thread whenever class index is updated or
+      // queued names are resolved.
+      void setImportDirectories(Game game, const std::vector<std::wstring>& importDirectories, class_index_callback_t onUpdated);
+
+      // Check if the given lower case name is a class in the given game. Returns nullopt if the name is yet to be resolved, in
+      // which case it is queued to be resolved in background.
+      std::optional<bool> resolveClassName(Game game, std::string_view name, bool useCache);
+
+      // Version of the game's class index, or 0 if there is none or it isn't ready yet
+      unsigned int classIndexVersion(Game game) const;
+
+      void setCacheCapacity(size_t newCapacity);
+      void clearCaches();
+      CacheUsage cacheUsage(Game game) const;
+
+    private:
+      struct GameState {
+        explicit GameState(size_t cacheCapacity) : classNameCache(cacheCapacity), resolvedNames(RESOLVED_NAMES_CAPACITY) {}
+
+        std::vector<std::wstring> importDirectories;
+        std::unique_ptr<ClassIndex> classIndex;
+        class_index_callback_t onUpdated;
+
+        mutable std::mutex cacheMutex;
+        ClassNameCache classNameCache;
+        ClassNameCache resolvedNames; // Names resolved in background while class name cache isn't in use
+      };
+
+      // A name queued to be resolved in background
+      struct Request {
+        Game game;
+        std::string name;
+        bool useCache;
+      };
+
+      // Worker thread function that resolves queued names until stopped
+      void run();
+
+      // Probe import directories for a batch of queued names, then store results and notify games that got any
+      void resolve(std::vector<Request>& requests);
+
+      // Store whether a name is a class in the game's cache, unless import directories have changed since it was probed
+      bool storeResult(Game game, const std::vector<std::wstring>& importDirectories, const Request& request, bool isClass);
+
+      // Check all import directories for a source file with the given name
+      static bool probeImportDirectories(const std::vector<std::wstring>& importDirectories, std::string_view name);
+
+      // Stop worker thread, if it's running
+      void stop();
+
+      // Private members
+      //
+      mutable std::shared_mutex mutex;
+      std::map<Game, GameState> games;
+      size_t cacheCapacity;
+
+      ClassIndexCache classIndexCache;
+
+      // Queued names, and pending ones that are either queued or being resolved so they are only queued once
+      std::mutex queueMutex;
+      std::condition_variable queueCondition;
+      std::vector<Request> queue;
+      std::set<std::pair<Game, std::string>> pendingNames;
+      std::atomic<bool> stopping {false};
+      std::thread workerThread;
+  };
+
+} // namespace
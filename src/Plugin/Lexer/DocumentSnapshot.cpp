@@ -0,0 +1,237 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DocumentSnapshot.hpp"
+
+#include "../../external/scintilla/Scintilla.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace papyrus {
+
+  namespace {
+    // Number of bytes of a UTF-8 character by its lead byte, or 1 if it's not a valid lead byte
+    inline int utf8BytesOfLead(unsigned char leadByte) {
+      return (leadByte >= 0xC2 && leadByte <= 0xDF) ? 2 : (leadByte >= 0xE0 && leadByte <= 0xEF) ? 3 : (leadByte >= 0xF0 && leadByte <= 0xF4) ? 4 : 1;
+    }
+
+    inline bool isUtf8TrailByte(unsigned char byte) {
+      return (byte & 0xC0) == 0x80;
+    }
+
+    // Same rules as Scintilla's UTF8Classify: overlong forms, surrogates, non-characters and values beyond U+10FFFF are invalid
+    bool isValidUtf8(const unsigned char* bytes, int byteCount) {
+      if (byteCount == 1 || !isUtf8TrailByte(bytes[1])) {
+        return false;
+      }
+      if (byteCount == 3) {
+        return isUtf8TrailByte(bytes[2])
+          && !(bytes[0] == 0xE0 && (bytes[1] & 0xE0) == 0x80)  // Overlong
+          && !(bytes[0] == 0xED && (bytes[1] & 0xE0) == 0xA0)  // Surrogate
+          && !(bytes[0] == 0xEF && bytes[1] == 0xBF && (bytes[2] == 0xBE || bytes[2] == 0xBF))  // U+FFFE and U+FFFF
+          && !(bytes[0] == 0xEF && bytes[1] == 0xB7 && ((bytes[2] & 0xF0) == 0x90 || (bytes[2] & 0xF0) == 0xA0)); // U+FDD0 - U+FDEF
+      }
+      if (byteCount == 4) {
+        return isUtf8TrailByte(bytes[2]) && isUtf8TrailByte(bytes[3])
+          && !((bytes[1] & 0x0F) == 0x0F && bytes[2] == 0xBF && (bytes[3] == 0xBE || bytes[3] == 0xBF)) // *FFFE and *FFFF
+          && !(bytes[0] == 0xF4 && bytes[1] > 0x8F)            // Beyond U+10FFFF
+          && !(bytes[0] == 0xF0 && (bytes[1] & 0xF0) == 0x80); // Overlong
+      }
+      return true;
+    }
+  }
+
+  DocumentSnapshot::DocumentSnapshot(Scintilla::IDocument* document, Sci_Position firstLine, Sci_Position lastLine)
+    : firstLine(firstLine),
+      textStart(document->LineStart(firstLine)),
+      documentLength(document->Length()),
+      codePage(document->CodePage()) {
+    for (auto line = firstLine; line <= lastLine + 1; line++) {
+      lineStarts.push_back(document->LineStart(line));
+    }
+    for (auto line = firstLine; line <= lastLine; line++) {
+      lineEnds.push_back(document->LineEnd(line));
+    }
+    text.resize(lineStarts.back() - textStart);
+    document->GetCharRange(text.data(), textStart, static_cast<Sci_Position>(text.size()));
+  }
+
+  // IDocument interface
+  //
+
+  int SCI_METHOD DocumentSnapshot::Version() const {
+    return Scintilla::dvRelease4;
+  }
+
+  void SCI_METHOD DocumentSnapshot::SetErrorStatus(int status) {
+  }
+
+  Sci_Position SCI_METHOD DocumentSnapshot::Length() const {
+    return documentLength;
+  }
+
+  void SCI_METHOD DocumentSnapshot::GetCharRange(char* buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+    std::memset(buffer, 0, static_cast<size_t>(lengthRetrieve));
+    Sci_Position copyStart = (std::max)(position, textStart);
+    Sci_Position copyEnd = (std::min)(position + lengthRetrieve, textStart + static_cast<Sci_Position>(text.size()));
+    if (copyStart < copyEnd) {
+      std::memcpy(buffer + (copyStart - position), text.data() + (copyStart - textStart), static_cast<size_t>(copyEnd - copyStart));
+    }
+  }
+
+  char SCI_METHOD DocumentSnapshot::StyleAt(Sci_Position position) const {
+    return 0;
+  }
+
+  Sci_Position SCI_METHOD DocumentSnapshot::LineFromPosition(Sci_Position position) const {
+    auto iterLine = std::upper_bound(lineStarts.begin(), lineStarts.end(), position);
+    if (iterLine == lineStarts.begin()) {
+      return firstLine;
+    }
+    return firstLine + static_cast<Sci_Position>(iterLine - lineStarts.begin()) - 1;
+  }
+
+  Sci_Position SCI_METHOD DocumentSnapshot::LineStart(Sci_Position line) const {
+    Sci_Position index = std::clamp(line - firstLine, Sci_Position(0), static_cast<Sci_Position>(lineStarts.size()) - 1);
+    return lineStarts[static_cast<size_t>(index)];
+  }
+
+  int SCI_METHOD DocumentSnapshot::GetLevel(Sci_Position line) const {
+    return SC_FOLDLEVELBASE;
+  }
+
+  int SCI_METHOD DocumentSnapshot::SetLevel(Sci_Position line, int level) {
+    return SC_FOLDLEVELBASE;
+  }
+
+  int SCI_METHOD DocumentSnapshot::GetLineState(Sci_Position line) const {
+    return 0;
+  }
+
+  int SCI_METHOD DocumentSnapshot::SetLineState(Sci_Position line, int state) {
+    return 0;
+  }
+
+  void SCI_METHOD DocumentSnapshot::StartStyling(Sci_Position position) {
+  }
+
+  bool SCI_METHOD DocumentSnapshot::SetStyleFor(Sci_Position length, char style) {
+    return false;
+  }
+
+  bool SCI_METHOD DocumentSnapshot::SetStyles(Sci_Position length, const char* styles) {
+    return false;
+  }
+
+  void SCI_METHOD DocumentSnapshot::DecorationSetCurrentIndicator(int indicator) {
+  }
+
+  void SCI_METHOD DocumentSnapshot::DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) {
+  }
+
+  void SCI_METHOD DocumentSnapshot::ChangeLexerState(Sci_Position start, Sci_Position end) {
+  }
+
+  int SCI_METHOD DocumentSnapshot::CodePage() const {
+    return codePage;
+  }
+
+  bool SCI_METHOD DocumentSnapshot::IsDBCSLeadByte(char ch) const {
+    return false;
+  }
+
+  const char* SCI_METHOD DocumentSnapshot::BufferPointer() {
+    // Only the copied range is available, which doesn't start at document start
+    return nullptr;
+  }
+
+  int SCI_METHOD DocumentSnapshot::GetLineIndentation(Sci_Position line) {
+    int indentation = 0;
+    for (Sci_Position position = LineStart(line); position < LineEnd(line); position++) {
+      unsigned char ch = byteAt(position);
+      if (ch == ' ') {
+        indentation++;
+      } else if (ch == '\t') {
+        indentation = (indentation / 4 + 1) * 4;
+      } else {
+        break;
+      }
+    }
+    return indentation;
+  }
+
+  Sci_Position SCI_METHOD DocumentSnapshot::LineEnd(Sci_Position line) const {
+    if (line < firstLine) {
+      return textStart;
+    }
+    size_t index = static_cast<size_t>(line - firstLine);
+    return (index < lineEnds.size()) ? lineEnds[index] : lineStarts.back();
+  }
+
+  Sci_Position SCI_METHOD DocumentSnapshot::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+    Sci_Position position = positionStart;
+    for (; characterOffset > 0 && position < documentLength; characterOffset--) {
+      Sci_Position width = 1;
+      GetCharacterAndWidth(position, &width);
+      position += width;
+    }
+    for (; characterOffset < 0 && position > 0; characterOffset++) {
+      position--;
+      while (codePage == SC_CP_UTF8 && position > 0 && isUtf8TrailByte(byteAt(position))) {
+        position--;
+      }
+    }
+    return (characterOffset == 0) ? position : -1;
+  }
+
+  int SCI_METHOD DocumentSnapshot::GetCharacterAndWidth(Sci_Position position, Sci_Position* pWidth) const {
+    Sci_Position width = 1;
+    int ch = byteAt(position);
+    if (codePage == SC_CP_UTF8 && ch >= 0x80) {
+      // Same as Scintilla, an invalid byte is reported as a character in the low surrogate range
+      unsigned char bytes[4] {};
+      int byteCount = utf8BytesOfLead(static_cast<unsigned char>(ch));
+      for (int i = 0; i < byteCount; i++) {
+        bytes[i] = byteAt(position + i);
+      }
+      if (isValidUtf8(bytes, byteCount)) {
+        ch = (byteCount == 2) ? ((bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F)
+          : (byteCount == 3) ? ((bytes[0] & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F)
+          : ((bytes[0] & 0x07) << 18) | ((bytes[1] & 0x3F) << 12) | ((bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
+        width = byteCount;
+      } else {
+        ch = 0xDC80 + ch;
+      }
+    }
+    if (pWidth) {
+      *pWidth = width;
+    }
+    return ch;
+  }
+
+  // Private methods
+  //
+
+  unsigned char DocumentSnapshot::byteAt(Sci_Position position) const {
+    Sci_Position offset = position - textStart;
+    return (offset >= 0 && offset < static_cast<Sci_Position>(text.size())) ? static_cast<unsigned char>(text[static_cast<size_t>(offset)]) : 0;
+  }
+
+} // namespace
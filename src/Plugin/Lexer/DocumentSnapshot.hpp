@@ -0,0 +1,81 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "../../external/scintilla/ILexer.h"
+
+#include <string>
+#include <vector>
+
+namespace papyrus {
+
+  // Read-only copy of a range of lines of a document, taken on the thread that owns the document, so the range can be
+  // read on worker threads without calling into the document. Positions and line numbers are the same as in the
+  // document. Text outside of the range reads as zeros, and writes are ignored.
+  //
+  // Multi-byte characters are decoded the same way Scintilla decodes UTF-8. DBCS code pages need the document to tell
+  // lead bytes, so they are not supported.
+  //
+  class DocumentSnapshot : public Scintilla::IDocument {
+    public:
+      DocumentSnapshot(Scintilla::IDocument* document, Sci_Position firstLine, Sci_Position lastLine);
+
+      // IDocument interface
+      int SCI_METHOD Version() const override;
+      void SCI_METHOD SetErrorStatus(int status) override;
+      Sci_Position SCI_METHOD Length() const override;
+      void SCI_METHOD GetCharRange(char* buffer, Sci_Position position, Sci_Position lengthRetrieve) const override;
+      char SCI_METHOD StyleAt(Sci_Position position) const override;
+      Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const override;
+      Sci_Position SCI_METHOD LineStart(Sci_Position line) const override;
+      int SCI_METHOD GetLevel(Sci_Position line) const override;
+      int SCI_METHOD SetLevel(Sci_Position line, int level) override;
+      int SCI_METHOD GetLineState(Sci_Position line) const override;
+      int SCI_METHOD SetLineState(Sci_Position line, int state) override;
+      void SCI_METHOD StartStyling(Sci_Position position) override;
+      bool SCI_METHOD SetStyleFor(Sci_Position length, char style) override;
+      bool SCI_METHOD SetStyles(Sci_Position length, const char* styles) override;
+      void SCI_METHOD DecorationSetCurrentIndicator(int indicator) override;
+      void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+      void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end) override;
+      int SCI_METHOD CodePage() const override;
+      bool SCI_METHOD IsDBCSLeadByte(char ch) const override;
+      const char* SCI_METHOD BufferPointer() override;
+      int SCI_METHOD GetLineIndentation(Sci_Position line) override;
+      Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override;
+      Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const override;
+      int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position* pWidth) const override;
+
+    private:
+      // Byte of copied text at a document position, or 0 if it's outside of the range
+      unsigned char byteAt(Sci_Position position) const;
+
+      // Private members
+      //
+      std::string text;
+      Sci_Position firstLine;
+      Sci_Position textStart;
+      std::vector<Sci_Position> lineStarts; // Starts of lines in range and of the line after it
+      std::vector<Sci_Position> lineEnds;
+      Sci_Position documentLength;
+      int codePage;
+  };
+
+} // namespace
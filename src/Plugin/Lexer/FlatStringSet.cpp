@@ -0,0 +1,99 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "FlatStringSet.hpp"
+
+#include <utility>
+
+#define INITIAL_SLOT_COUNT 16  // Must be a power of 2
+
+namespace papyrus {
+
+  void FlatStringSet::insert(std::string_view str) {
+    // Keep load factor at or below 1/2, so probe sequences stay short
+    if ((used + 1) * 2 > slots.size()) {
+      grow();
+    }
+
+    uint32_t strHash = hash(str);
+    Slot& slot = slots[findSlot(str, strHash)];
+    if (slot.count == 0) {
+      slot.str = str;
+      slot.hash = strHash;
+      used++;
+    }
+    slot.count++;
+  }
+
+  void FlatStringSet::erase(std::string_view str) {
+    if (slots.empty()) {
+      return;
+    }
+
+    size_t index = findSlot(str, hash(str));
+    if (slots[index].count == 0 || --slots[index].count > 0) {
+      return;
+    }
+
+    // Shift following slots in the probe sequence back, so lookups never run into a gap before reaching their strings
+    size_t next = index;
+    while (true) {
+      next = (next + 1) & slotMask;
+      if (slots[next].count == 0) {
+        break;
+      }
+
+      // A slot can't move back beyond its ideal position, i.e. when that is cyclically within (index, next]
+      size_t ideal = slots[next].hash & slotMask;
+      bool stays = (index <= next) ? (ideal > index && ideal <= next) : (ideal > index || ideal <= next);
+      if (!stays) {
+        slots[index] = std::move(slots[next]);
+        index = next;
+      }
+    }
+    slots[index].str.clear();
+    slots[index].count = 0;
+    used--;
+  }
+
+  void FlatStringSet::clear() {
+    slots.clear();
+    slotMask = 0;
+    used = 0;
+  }
+
+  // Private methods
+  //
+
+  void FlatStringSet::grow() {
+    std::vector<Slot> oldSlots = std::exchange(slots, std::vector<Slot>(slots.empty() ? INITIAL_SLOT_COUNT : slots.size() * 2));
+    slotMask = slots.size() - 1;
+    for (Slot& slot : oldSlots) {
+      if (slot.count > 0) {
+        size_t index = slot.hash & slotMask;
+        while (slots[index].count > 0) {
+          index = (index + 1) & slotMask;
+        }
+        slots[index] = std::move(slot);
+      }
+    }
+  }
+
+} // namespace
@@ -0,0 +1,85 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // Open addressing hash set of strings with linear probing. Lookups take string_view, so probing with a token doesn't
+  // construct a temporary string. Slots keep the hash of their strings, so probing only compares strings when hashes
+  // match, and growing the table doesn't hash them again.
+  //
+  // Each string has a count of how many times it has been inserted, and is only removed once it has been erased as many
+  // times, so the set can also track names defined by multiple lines.
+  //
+  class FlatStringSet {
+    public:
+      inline bool contains(std::string_view str) const { return !slots.empty() && slots[findSlot(str, hash(str))].count > 0; }
+      inline size_t size() const { return used; }
+
+      void insert(std::string_view str);
+
+      // Remove one occurrence of the string
+      void erase(std::string_view str);
+
+      void clear();
+
+    private:
+      struct Slot {
+        std::string str;
+        uint32_t hash {0};
+        uint32_t count {0};
+      };
+
+      // FNV-1a
+      static inline uint32_t hash(std::string_view str) {
+        uint32_t value = 2166136261u;
+        for (char ch : str) {
+          value ^= static_cast<unsigned char>(ch);
+          value *= 16777619u;
+        }
+        return value ^ (value >> 15);
+      }
+
+      // Get the slot holding the string, or the empty slot where it would be inserted
+      inline size_t findSlot(std::string_view str, uint32_t strHash) const {
+        size_t index = strHash & slotMask;
+        while (slots[index].count > 0 && (slots[index].hash != strHash || slots[index].str != str)) {
+          index = (index + 1) & slotMask;
+        }
+        return index;
+      }
+
+      // Double table size, or allocate the initial table
+      void grow();
+
+      // Private members
+      //
+      std::vector<Slot> slots;
+      size_t slotMask {0};
+      size_t used {0};
+  };
+
+} // namespace
@@ -0,0 +1,82 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "KeywordTable.hpp"
+
+#include <map>
+
+#define MAX_SEED_ATTEMPTS 256  // Seeds to try for each table size before doubling it
+
+namespace papyrus {
+
+  void KeywordTable::build(const std::vector<WordList*>& lists) {
+    // Merge all word lists, so each word only takes one slot
+    std::map<std::string, uint32_t> words;
+    for (size_t i = 0; i < lists.size(); i++) {
+      if (lists[i] != nullptr) {
+        for (int j = 0; j < lists[i]->Length(); j++) {
+          words[lists[i]->WordAt(j)] |= (1u << i);
+        }
+      }
+    }
+
+    slots.clear();
+    slotMask = 0;
+    seed = 0;
+    if (words.empty()) {
+      return;
+    }
+
+    // Start with a table at least twice the number of words, where a collision free seed is quick to find
+    size_t tableSize = 16;
+    while (tableSize < words.size() * 2) {
+      tableSize *= 2;
+    }
+
+    std::vector<bool> occupied;
+    while (true) {
+      for (uint32_t trySeed = 0; trySeed < MAX_SEED_ATTEMPTS; trySeed++) {
+        occupied.assign(tableSize, false);
+        bool collided = false;
+        for (const auto& [word, mask] : words) {
+          size_t index = hash(word, trySeed) & (tableSize - 1);
+          if (occupied[index]) {
+            collided = true;
+            break;
+          }
+          occupied[index] = true;
+        }
+
+        if (!collided) {
+          slots.resize(tableSize);
+          slotMask = static_cast<uint32_t>(tableSize - 1);
+          seed = trySeed;
+          for (auto& [word, mask] : words) {
+            Slot& slot = slots[hash(word, seed) & slotMask];
+            slot.word = word;
+            slot.mask = mask;
+          }
+          return;
+        }
+      }
+      tableSize *= 2;
+    }
+  }
+
+} // namespace
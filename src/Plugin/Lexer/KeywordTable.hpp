@@ -0,0 +1,76 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "../../external/scintilla/WordList.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  using namespace Scintilla;
+
+  // Combined lookup table of multiple word lists. A lookup returns a mask of all word lists a word is in, with bit i set
+  // for lists[i] given to build(), so classifying a word takes a single probe instead of one InList call per word list.
+  //
+  // Since the vocabulary only changes when word lists are set, the table uses a perfect hash: hash seed and table size
+  // are chosen when it is built so no two words share a slot. A lookup then only needs to compare the word in one slot.
+  //
+  class KeywordTable {
+    public:
+      // Rebuild the table from the given word lists. nullptr entries are skipped, but still take their bit position.
+      void build(const std::vector<WordList*>& lists);
+
+      // Get mask of word lists the given word is in. 0 if it isn't in any of them
+      inline uint32_t find(std::string_view word) const {
+        if (slots.empty()) {
+          return 0;
+        }
+        const Slot& slot = slots[hash(word, seed) & slotMask];
+        return (slot.word == word) ? slot.mask : 0;
+      }
+
+    private:
+      struct Slot {
+        std::string word;
+        uint32_t mask {0};
+      };
+
+      // FNV-1a with a seed mixed into the offset basis
+      static inline uint32_t hash(std::string_view word, uint32_t seed) {
+        uint32_t value = 2166136261u ^ seed;
+        for (char ch : word) {
+          value ^= static_cast<unsigned char>(ch);
+          value *= 16777619u;
+        }
+        return value ^ (value >> 15);
+      }
+
+      // Private members
+      //
+      std::vector<Slot> slots;
+      uint32_t slotMask {0};
+      uint32_t seed {0};
+  };
+
+} // namespace
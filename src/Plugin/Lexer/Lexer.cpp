@@ -20,258 +20,386 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Lexer.hpp"
 
+#include "DocumentSnapshot.hpp"
 #include "LexerData.hpp"
 #include "LexerIDs.hpp"
-#include "..\Common\EnumUtil.hpp"
-#include "..\Common\Utility.hpp"
+#include "../Common/EnumUtil.hpp"
 
-#include "..\..\external\npp\Common.h"
-#include "..\..\external\scintilla\LexerModule.h"
-#include "..\..\external\scintilla\Scintilla.h"
+#include "../../external/scintilla/LexerModule.h"
+#include "../../external/scintilla/Scintilla.h"
 
-#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <locale>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#define RESTYLE_RANGE_GAP         4     // Restyle ranges separated by this many lines or fewer are merged
+#define PARALLEL_LEX_MIN_LINES    8192  // Lex ranges with at least this many lines are prepared on worker threads
+#define PARALLEL_LEX_CHUNK_LINES  2048  // Minimum number of lines prepared by each worker thread
+
 namespace papyrus {
 
+  namespace {
+    // Character classification only recognizes ASCII characters, since ctype functions are undefined for values out of
+    // unsigned char's range and would be locale dependent otherwise
+    inline bool isBlank(int ch) { return ch == ' ' || ch == '\t'; }
+    inline bool isDigit(int ch) { return ch >= '0' && ch <= '9'; }
+    inline bool isHexDigit(int ch) { return isDigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F'); }
+    inline bool isAlpha(int ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+    inline bool isAlphaNumeric(int ch) { return isAlpha(ch) || isDigit(ch); }
+    inline char toLower(int ch) { return static_cast<char>((ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch); }
+
+    // Keywords that start or end blocks in outline
+    struct BlockKeyword {
+      std::string_view keyword;
+      Lexer::OutlineKind kind;
+      bool isEnd;
+    };
+
+    constexpr BlockKeyword blockKeywords[] {
+      {"function", Lexer::OutlineKind::Function, false},
+      {"endfunction", Lexer::OutlineKind::Function, true},
+      {"event", Lexer::OutlineKind::Event, false},
+      {"endevent", Lexer::OutlineKind::Event, true},
+      {"state", Lexer::OutlineKind::State, false},
+      {"endstate", Lexer::OutlineKind::State, true},
+      {"property", Lexer::OutlineKind::Property, false},
+      {"endproperty", Lexer::OutlineKind::Property, true}
+    };
+
+    // Check if text is pure ASCII, 8 bytes at a time
+    bool isAscii(std::string_view text) {
+      constexpr uint64_t highBits = 0x8080808080808080ULL;
+      const char* data = text.data();
+      size_t size = text.size();
+      size_t offset = 0;
+      for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(uint64_t));
+        if (word & highBits) {
+          return false;
+        }
+      }
+      for (; offset < size; offset++) {
+        if (static_cast<unsigned char>(data[offset]) & 0x80) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // FNV-1a, 64 bits so that different texts of a line practically never collide
+    uint64_t hashText(std::string_view text) {
+      uint64_t hash = 0xCBF29CE484222325ULL;
+      for (char ch : text) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001B3ULL;
+      }
+      return hash;
+    }
+  }
+
   Lexer::Lexer()
     : SimpleLexerBase(LEXER_NAME, SCLEX_PAPYRUS_SCRIPT),
       instreWordLists{&wordListOperators, &wordListFlowControl},
       typeWordLists{&wordListTypes, &wordListKeywords, &wordListKeywords2, &wordListFoldOpen, &wordListFoldMiddle, &wordListFoldClose} {
-    // Setup settings change listeners
-    if (isUsable()) {
-      lexerData->settings.enableFoldMiddle.addWatcher([&](bool oldValue, bool newValue) { restyleDocument(); });
-      lexerData->settings.enableClassNameCache.addWatcher([&](bool oldValue, bool newValue) { 
-        if (!newValue) {
-          classNames.clear();
-          nonClassNames.clear();
-        }
-        restyleDocument();
-      });
-    }
   }
 
   void SCI_METHOD Lexer::Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument* pAccess) {
     if (isUsable()) {
+      auto startTime = std::chrono::steady_clock::now();
       Accessor accessor(pAccess, nullptr);
-      StyleContext styleContext(startPos, lengthDoc, accessor.StyleAt(startPos - 1), accessor);
-
-      // Check if the properties still exist and update the content
-      for (auto iterProperties = propertyLines.begin(); iterProperties != propertyLines.end();) {
-        auto tokens = tokenize(accessor, (*iterProperties).line);
-        bool found = false;
-        for (auto iterToken = tokens.begin(); iterToken != tokens.end(); iterToken++) {
-          if ((*iterToken).content == "property" && std::next(iterToken) != tokens.end() && !isComment(accessor.StyleAt((*iterToken).startPos)) && !isComment(accessor.StyleAt((*std::next(iterToken)).startPos))) {
-            std::string currentName = (*std::next(iterToken)).content;
-            if ((*iterProperties).name != currentName) {
-              propertyNames.erase((*iterProperties).name);
-              (*iterProperties).name = currentName;
-              propertyNames.insert(currentName);
-            }
-            found = true;
-            break;
-          }
-        }
-        if (found) {
-          iterProperties++;
-        } else {
-          iterProperties = propertyLines.erase(iterProperties);
-        }
+      StyleWriter styleWriter(accessor, startPos, lengthDoc, accessor.StyleAt(startPos - 1));
+
+      // If line count doesn't match what has been tracked, some modifications were missed so nothing tracked can be trusted
+      document = pAccess;
+      Sci_Position lineCount = accessor.GetLine(accessor.Length()) + 1;
+      bool trackingLost = (lineCount != documentLineCount);
+      if (trackingLost) {
+        // Block markers still pending are detected before their tokens are dropped, and revalidated below along with others
+        detectPendingBlockMarkers();
+        resetIncrementalState();
+        lineTokenCache.clear();
+        documentLineCount = lineCount;
+        foldDirtyLineEnd = documentLineCount - 1;
+      }
+      lineTokenCache.resize(documentLineCount);
+
+      // When class index is switched or updated, lines styled before can no longer be trusted
+      unsigned int currentClassIndexVersion = lexerData->classResolver.classIndexVersion(lexerData->currentGame);
+      if (currentClassIndexVersion != classIndexVersion) {
+        resetIncrementalState();
+        classIndexVersion = currentClassIndexVersion;
       }
 
+      // Any change to properties affects styling of lines beyond modified ones, in which case lexing can't stop early
+      bool propertiesChanged = propertiesRemoved;
+      propertiesRemoved = false;
+      if (trackingLost) {
+        propertiesChanged = revalidateProperties(accessor) || propertiesChanged;
+        revalidateBlockMarkers(accessor);
+      }
+
+      // Comments and strings are scanned in line text for their terminators, which can't be done byte-wise in DBCS documents
+      bool scanSpans = (accessor.Encoding() != EncodingType::dbcs);
+      lineReader.reset();
+
       // This state is saved in the line feed character. It can be used to initialize the state of the next line
       State messageStateLast = static_cast<State>(accessor.StyleAt(startPos - 1));
-      for (auto line = accessor.GetLine(startPos); line <= accessor.GetLine(startPos + lengthDoc - 1); line++) {
-        auto tokens = tokenize(accessor, line);
-        State messageState = messageStateLast;
+      Sci_Position firstLine = accessor.GetLine(startPos);
+      Sci_Position lastLine = accessor.GetLine(startPos + lengthDoc - 1);
+
+      // Lexing can't stop early when the range goes beyond styled lines, so lines of a large range can be prepared ahead on
+      // worker threads. Styles are still written here.
+      std::vector<LineStyling> preparedLines;
+      if (lastLine >= styledLineEnd) {
+        prepareLinesInParallel(pAccess, firstLine, lastLine, messageStateLast, scanSpans, preparedLines);
+      }
+
+      bool stoppedEarly = false;
+      Sci_Position styledLines = lastLine - firstLine + 1;
+      for (auto line = firstLine; line <= lastLine; line++) {
+        // Line end state from previous styling, which needs to be read before current line is styled
+        Sci_Position lineFeedPos = accessor.LineStart(line + 1) - 1;
+        State previousMessageState = static_cast<State>(accessor.StyleAt(lineFeedPos));
+
+        size_t preparedIndex = static_cast<size_t>(line - firstLine);
+        bool isPrepared = (preparedIndex < preparedLines.size() && preparedLines[preparedIndex].entryState == messageStateLast);
+        const TokenList& lineTokens = isPrepared ? lineTokenCache[line].tokenList : getLineTokens(accessor, line);
+        const auto& tokens = lineTokens.tokens;
+        if (!isPrepared) {
+          prepareLineStyling(accessor, lineReader, lineTokens, line, messageStateLast, scanSpans, unpreparedLineStyling);
+        }
+        LineStyling& currentStyling = isPrepared ? preparedLines[preparedIndex] : unpreparedLineStyling;
+        State messageState = currentStyling.endState;
+
+        // Property this line defined when it was last lexed, which gets updated if the line no longer defines the same one
+        auto iterProperty = findProperty(line);
+        bool isPropertyLine = (iterProperty != propertyLines.end() && (*iterProperty).line == line);
+        bool propertyFound = false;
+        bool unresolvedNamesFound = false;
+        bool classNamesLookedUp = false;
 
         // Styling
-        for (auto iterTokens = tokens.begin(); iterTokens != tokens.end(); iterTokens++) {
-          std::string tokenString = (*iterTokens).content;
-          
-          // Check if a new property needs to be added
-          if (tokenString == "property" && std::next(iterTokens) != tokens.end() && !isComment(accessor.StyleAt((*iterTokens).startPos)) && !isComment(accessor.StyleAt((*std::next(iterTokens)).startPos))) {
-            bool found = false;
-            for (auto iterProperties = propertyLines.begin(); iterProperties != propertyLines.end(); iterProperties++) {
-              if ((*iterProperties).line == line) {
-                found = true;
-                break;
-              }
-            }
+        auto iterNameTokens = currentStyling.nameTokens.begin();
+        for (size_t index = 0; index < tokens.size(); index++) {
+          State state = currentStyling.tokenStates[index];
 
-            if (!found) {
+          // Check if this line defines a property
+          if (currentStyling.propertyToken == index) {
+            std::string_view propertyName = lineTokens.content(tokens[index + 1]);
+            if (!isPropertyLine) {
               Property property {
-                .name = (*std::next(iterTokens)).content,
+                .name = std::string(propertyName),
                 .line = line
               };
-              propertyLines.push_back(property);
+              iterProperty = propertyLines.insert(iterProperty, property);
               propertyNames.insert(property.name);
-
-              // Always style "property" keyword as KEYWORD
-              colorToken(styleContext, *iterTokens, State::Keyword);
-              continue;
-            }
-          }
-
-          if (messageState == State::CommentDoc) {
-            colorToken(styleContext, *iterTokens, State::CommentDoc);
-            if (tokenString == "}") {
-              messageState = State::Default;
-            }
-          } else if(messageState == State::CommentMultiLine) {
-            colorToken(styleContext, *iterTokens, State::CommentMultiLine);
-            if (tokenString == ";" && iterTokens != tokens.begin() && (*std::prev(iterTokens)).content == "/") {
-              messageState = State::Default;
+              isPropertyLine = true;
+              propertiesChanged = true;
+            } else if ((*iterProperty).name != propertyName) {
+              propertyNames.erase((*iterProperty).name);
+              (*iterProperty).name = propertyName;
+              propertyNames.insert(propertyName);
+              propertiesChanged = true;
             }
-          } else if(messageState == State::Comment) {
-            colorToken(styleContext, *iterTokens, State::Comment);
-          } else if(messageState == State::String) {
-            colorToken(styleContext, *iterTokens, State::String);
-            if (tokenString == "\"") {
-              // This may be an escape for double quote. Check previous tokens
-              int numBackslash = 0;
-              auto iterCheck = iterTokens;
-              while (iterCheck != tokens.begin()) {
-                if ((*(--iterCheck)).content == "\\") {
-                  numBackslash++;
-                } else {
-                  break;
-                }
-              }
-              if (numBackslash % 2 == 0) {
-                messageState = State::Default;
-              }
-            }
-          } else {
-            // Determine the type of the token and color it
-            if (tokenString == "{") {
-              colorToken(styleContext, *iterTokens, State::CommentDoc);
-              messageState = State::CommentDoc;
-            } else if (tokenString == ";") {
-              if (std::next(iterTokens) != tokens.end() && (*std::next(iterTokens)).content == "/") {
-                colorToken(styleContext, *iterTokens, State::CommentMultiLine);
-                messageState = State::CommentMultiLine;
-              } else {
-                colorToken(styleContext, *iterTokens, State::Comment);
-                messageState = State::Comment;
-              }
-            } else if (tokenString == "\"") {
-              colorToken(styleContext, *iterTokens, State::String);
-              messageState = State::String;
-            } else if ((*iterTokens).tokenType == TokenType::Numeric) {
-              colorToken(styleContext, *iterTokens, State::Number);
-            } else if ((*iterTokens).tokenType == TokenType::Identifier) {
-              if (!wordListFlowControl.InList(tokenString.c_str()) && isalnum(tokenString.back()) && std::next(iterTokens) != tokens.end() && (*std::next(iterTokens)).content == "(") {
-                // If next token is ( and current token is an identifier but not if/elseif/while, it is a function name.
-                colorToken(styleContext, *iterTokens, State::Function);
-              } else if (wordListTypes.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Type);
-              } else if (wordListFlowControl.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::FlowControl);
-              } else if (wordListKeywords.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Keyword);
-              } else if (wordListKeywords2.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Keyword2);
-              } else if (wordListOperators.InList(tokenString.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Operator);
-              } else {
-                bool found = (propertyNames.find(tokenString) != propertyNames.end());
-                if (found) {
-                  colorToken(styleContext, *iterTokens, State::Property);
-                } else {
-                  if (classNames.find(tokenString) != classNames.end()) {
-                    colorToken(styleContext, *iterTokens, State::Class);
-                    found = true;
-                  } else if (nonClassNames.find(tokenString) == nonClassNames.end()) {
-                    // Check all import directories for a source file with given name
-                    if (lexerData->currentGame != game::Game::Auto) {
-                      for (const auto& path : lexerData->importDirectories[lexerData->currentGame]) {
-                        if (utility::fileExists(std::filesystem::path(path) / (tokenString + ".psc"))) {
-                          colorToken(styleContext, *iterTokens, State::Class);
-                          if (lexerData->settings.enableClassNameCache) {
-                            classNames.insert(tokenString);
-                          }
-                          found = true;
-                          break;
-                        }
-                      }
-                    }
-
-                    if (!found && lexerData->settings.enableClassNameCache) {
-                      nonClassNames.insert(tokenString);
-                    }
-                  }
-
-                  if (!found) {
-                    colorToken(styleContext, *iterTokens, State::Default);
-                  }
-                }
-              }
-            } else if ((*iterTokens).tokenType == TokenType::Special) {
-              if (wordListOperators.InList((*iterTokens).content.c_str())) {
-                colorToken(styleContext, *iterTokens, State::Operator);
-              } else {
-                colorToken(styleContext, *iterTokens, State::Default);
-              }
+            propertyFound = true;
+          } else if (iterNameTokens != currentStyling.nameTokens.end() && *iterNameTokens == index) {
+            std::string_view tokenString = lineTokens.content(tokens[index]);
+            if (propertyNames.contains(tokenString)) {
+              state = State::Property;
+            } else {
+              // A name still being resolved is styled as default for now, and its line gets restyled once it's resolved
+              std::optional<bool> isClass = isClassName(tokenString);
+              unresolvedNamesFound = unresolvedNamesFound || !isClass;
+              classNamesLookedUp = true;
+              state = isClass.value_or(false) ? State::Class : State::Default;
             }
+            iterNameTokens++;
           }
+          colorToken(styleWriter, tokens[index], state);
         }
-        if (messageState == State::Comment || messageState == State::String) {
-          messageState = State::Default;
+        if (static_cast<size_t>(line) < lineTokenCache.size()) {
+          if (lineTokenCache[line].foldDelta != currentStyling.foldDelta) {
+            lineTokenCache[line].foldDelta = currentStyling.foldDelta;
+            foldDirtyLineEnd = (std::max)(foldDirtyLineEnd, line);
+          }
+          lineTokenCache[line].hasUnresolvedNames = unresolvedNamesFound;
+          lineTokenCache[line].hasUnindexedNames = classNamesLookedUp && classIndexVersion == 0;
+          lineTokenCache[line].restylePending = false;
+          lineTokenCache[line].blockMarkerPending = true;
+          blockMarkersPending = true;
+        }
+
+        if (isPropertyLine && !propertyFound) {
+          propertyNames.erase((*iterProperty).name);
+          propertyLines.erase(iterProperty);
+          propertiesChanged = true;
         }
-        if (styleContext.ch == '\r') {
-          styleContext.Forward();
+        if (styleWriter.currentChar() == '\r') {
+          styleWriter.forwardTo(styleWriter.position() + 1);
         }
-        if (styleContext.ch == '\n') {
-          styleContext.SetState(utility::underlying(messageState));
-          styleContext.Forward();
+        if (styleWriter.currentChar() == '\n') {
+          styleWriter.setState(utility::underlying(messageState));
+          styleWriter.forwardTo(styleWriter.position() + 1);
+
+          // When all lines after this one are unmodified since they were last styled, and they start with the same state as
+          // before, they would be styled exactly the same. Stop here and leave their styles as they are, unless next line is
+          // pending restyle.
+          if (line < lastLine && line >= dirtyLineEnd && lastLine < styledLineEnd && !propertiesChanged && messageState == previousMessageState && !isRestylePending(line + 1)) {
+            stoppedEarly = true;
+            styledLines = line - firstLine + 1;
+            break;
+          }
         }
         messageStateLast = messageState;
       }
-      styleContext.Complete();
+      styleWriter.complete();
+      styleRuns += styleWriter.runCount();
+
+      if (stoppedEarly) {
+        // Let Scintilla know the whole range is styled
+        accessor.StartAt(startPos + lengthDoc);
+      }
+
+      // Update tracked lines, now that all lines in the range are up to date
+      if (firstLine <= styledLineEnd && lastLine >= styledLineEnd) {
+        styledLineEnd = lastLine + 1;
+      }
+      if (accessor.LineStart(styledLineEnd) >= accessor.Length()) {
+        restyledClassIndexVersion = classIndexVersion;
+      }
+      if (firstLine <= dirtyLineStart && lastLine >= dirtyLineStart) {
+        dirtyLineStart = lastLine + 1;
+        if (dirtyLineStart > dirtyLineEnd) {
+          dirtyLineStart = 0;
+          dirtyLineEnd = -1;
+        }
+      }
+
+      recordTiming(lexTiming, styledLines, startTime);
     }
   }
 
   void SCI_METHOD Lexer::Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument* pAccess) {
     if (isUsable()) {
+      auto startTime = std::chrono::steady_clock::now();
       Accessor accessor(pAccess, nullptr);
 
-      int levelPrev = accessor.LevelAt(accessor.GetLine(startPos)) & SC_FOLDLEVELNUMBERMASK;
-      // Lines
-      for (auto line = accessor.GetLine(startPos); line <= accessor.GetLine(startPos + lengthDoc); line++) {
-        int numFoldOpen = 0;
-        int numFoldClose = 0;
-        bool hasFoldMiddle = false;
-        // Chars
-        auto tokens = tokenize(accessor, line);
-        for (const Token& token : tokens) {
-          if (!isComment(accessor.StyleAt(token.startPos)) && accessor.StyleAt(token.startPos) != utility::underlying(State::String)) {
-            if (wordListFoldOpen.InList(token.content.c_str())) {
-              numFoldOpen++;
-            } else if (wordListFoldClose.InList(token.content.c_str())) {
-              numFoldClose++;
-            } else if (lexerData->settings.enableFoldMiddle && wordListFoldMiddle.InList(token.content.c_str())) {
-              hasFoldMiddle = true;
-            }
-          }
+      // Existing fold levels can't be trusted when fold middle setting has changed since they were calculated
+      bool canStopEarly = (foldMiddleEnabled == lexerData->settings.enableFoldMiddle);
+      bool foldMiddleWasEnabled = foldMiddleEnabled;
+      foldMiddleEnabled = lexerData->settings.enableFoldMiddle;
+
+      // Folding may start from any line, e.g. when only some lines are restyled. Level of a fold middle line is lowered by
+      // one, so the starting level is derived from previous line instead, which hasn't changed since it was last folded.
+      Sci_Position firstLine = accessor.GetLine(startPos);
+      Sci_Position lastLine = accessor.GetLine(startPos + lengthDoc);
+      int levelPrev = SC_FOLDLEVELBASE;
+      if (firstLine > 0) {
+        FoldDelta foldDeltaPrev = getFoldDelta(accessor, firstLine - 1);
+        levelPrev = (accessor.LevelAt(firstLine - 1) & SC_FOLDLEVELNUMBERMASK) + foldDeltaPrev.numFoldOpen - foldDeltaPrev.numFoldClose;
+        if (foldMiddleWasEnabled && foldDeltaPrev.hasFoldMiddle && foldDeltaPrev.numFoldOpen == 0 && foldDeltaPrev.numFoldClose == 0) {
+          levelPrev++;
         }
+      }
+      Sci_Position line = firstLine;
+      for (; line <= lastLine; line++) {
+        FoldDelta foldDelta = getFoldDelta(accessor, line);
+        bool hasFoldMiddle = foldMiddleEnabled && foldDelta.hasFoldMiddle;
 
         // Skip the lines that have matching start and end keywords
         int level = levelPrev;
-        int levelDelta = numFoldOpen - numFoldClose;
+        int levelDelta = foldDelta.numFoldOpen - foldDelta.numFoldClose;
         if (levelDelta > 0) {
           level |= SC_FOLDLEVELHEADERFLAG;
         }
-        if (hasFoldMiddle && numFoldOpen == 0 && numFoldClose == 0) {
+        if (hasFoldMiddle && foldDelta.numFoldOpen == 0 && foldDelta.numFoldClose == 0) {
           level--;
           level |= SC_FOLDLEVELHEADERFLAG;
         }
+
+        // When fold deltas of all lines after this one are unchanged, and this line has the same level as before, they would
+        // get the same levels as well.
+        if (canStopEarly && line > foldDirtyLineEnd && accessor.LevelAt(line) == level) {
+          break;
+        }
         accessor.SetLevel(line, level);
         levelPrev += levelDelta;
       }
+      if (line > foldDirtyLineEnd) {
+        foldDirtyLineEnd = -1;
+      }
+
+      recordTiming(foldTiming, line - firstLine, startTime);
+    }
+  }
+
+  void* SCI_METHOD Lexer::PrivateCall(int operation, void* pointer) {
+    switch (operation) {
+      case PAPYRUS_LEXER_CALL_DOCUMENT_MODIFIED: {
+        onDocumentModified(*static_cast<SCNotification*>(pointer));
+        break;
+      }
+
+      case PAPYRUS_LEXER_CALL_GET_STATISTICS: {
+        Statistics* statistics = static_cast<Statistics*>(pointer);
+        statistics->tokenCacheHits = tokenCacheHits;
+        statistics->tokenCacheMisses = tokenCacheMisses;
+        statistics->tokensScanned = tokensScanned;
+        statistics->lexTiming = lexTiming;
+        statistics->foldTiming = foldTiming;
+        statistics->styleRuns = styleRuns;
+        statistics->parallelLexCalls = parallelLexCalls;
+        break;
+      }
+
+      case PAPYRUS_LEXER_CALL_SET_LEX_WORKERS: {
+        lexWorkerCount = *static_cast<size_t*>(pointer);
+        break;
+      }
+
+      case PAPYRUS_LEXER_CALL_GET_OUTLINE: {
+        *static_cast<std::vector<OutlineEntry>*>(pointer) = getOutline();
+        break;
+      }
+
+      case PAPYRUS_LEXER_CALL_FIND_BLOCK: {
+        // The innermost block containing a line is either the last block starting on or before it, or one of its enclosing blocks
+        BlockQuery* query = static_cast<BlockQuery*>(pointer);
+        const std::vector<OutlineEntry>& entries = getOutline();
+        auto iterEntry = std::upper_bound(entries.begin(), entries.end(), query->line, [](Sci_Position line, const OutlineEntry& entry) { return line < entry.startLine; });
+        int index = static_cast<int>(iterEntry - entries.begin()) - 1;
+        while (index >= 0 && entries[index].endLine < query->line) {
+          index = entries[index].parent;
+        }
+        if (index >= 0) {
+          query->entry = entries[index];
+          return this;
+        }
+        break;
+      }
+
+      case PAPYRUS_LEXER_CALL_GET_RESTYLE_RANGES: {
+        RestyleQuery* query = static_cast<RestyleQuery*>(pointer);
+        query->ranges = getRestyleRanges(query->reasons);
+        break;
+      }
+
+      case PAPYRUS_LEXER_CALL_IS_OUTDATED: {
+        if (isUsable() && document != nullptr && lexerData->classResolver.classIndexVersion(lexerData->currentGame) != restyledClassIndexVersion) {
+          return this;
+        }
+        break;
+      }
     }
+    return nullptr;
   }
 
   // Protected methods
@@ -292,71 +420,687 @@ namespace papyrus {
   // Private methods
   //
 
-  std::vector<Lexer::Token> Lexer::tokenize(Accessor& accessor, Sci_Position line) const {
-    std::vector<Token> tokens;
-    auto index = accessor.LineStart(line);
-    auto indexNext = index;
-    int ch = getNextChar(accessor, index, indexNext);
-    while (index < accessor.LineEnd(line)) {
-      if (ch == '\r' || ch == '\n') {
+  std::optional<bool> Lexer::isClassName(std::string_view name) {
+    return lexerData->classResolver.resolveClassName(lexerData->currentGame, name, lexerData->settings.enableClassNameCache);
+  }
+
+  bool Lexer::isRestylePending(Sci_Position line) const {
+    return static_cast<size_t>(line) < lineTokenCache.size() && lineTokenCache[line].restylePending;
+  }
+
+  std::vector<Lexer::TextRange> Lexer::getRestyleRanges(uint32_t reasons) {
+    auto needsRestyle = [reasons](const CachedLine& cachedLine) {
+      return ((reasons & UnresolvedNames) && cachedLine.hasUnresolvedNames)
+        || ((reasons & FoldMiddle) && cachedLine.foldDelta.valid && cachedLine.foldDelta.hasFoldMiddle)
+        || ((reasons & ClassNameCache) && cachedLine.hasUnindexedNames);
+    };
+
+    // Lines are collected as line ranges first. A range that starts shortly after the previous one ends is merged into it,
+    // as restyling a few more lines costs less than another restyle request.
+    std::vector<std::pair<Sci_Position, Sci_Position>> lineRanges;
+    Sci_Position lineCount = static_cast<Sci_Position>(lineTokenCache.size());
+    for (Sci_Position line = 0; line < lineCount; line++) {
+      if (needsRestyle(lineTokenCache[line])) {
+        Sci_Position endLine = line + 1;
+        while (endLine < lineCount && needsRestyle(lineTokenCache[endLine])) {
+          endLine++;
+        }
+        if (!lineRanges.empty() && line - lineRanges.back().second <= RESTYLE_RANGE_GAP) {
+          lineRanges.back().second = endLine;
+        } else {
+          lineRanges.emplace_back(line, endLine);
+        }
+        line = endLine;
+      }
+    }
+
+    std::vector<TextRange> ranges;
+    if (document != nullptr) {
+      for (const auto& [startLine, endLine] : lineRanges) {
+        for (Sci_Position line = startLine; line < endLine; line++) {
+          lineTokenCache[line].restylePending = true;
+        }
+        ranges.push_back(TextRange {
+          .startPos = document->LineStart(startLine),
+          .endPos = document->LineStart(endLine)
+        });
+      }
+
+      // Each range is folded by its own request. Fold can't stop early before reaching the last line of the last range, or
+      // it stops at the first line between fold middle lines in a range that kept its level.
+      if ((reasons & FoldMiddle) && !lineRanges.empty()) {
+        foldDirtyLineEnd = (std::max)(foldDirtyLineEnd, lineRanges.back().second - 1);
+      }
+    }
+    return ranges;
+  }
+
+  std::vector<Lexer::Property>::iterator Lexer::findProperty(Sci_Position line) {
+    return std::lower_bound(propertyLines.begin(), propertyLines.end(), line, [](const Property& property, Sci_Position line) { return property.line < line; });
+  }
+
+  bool Lexer::revalidateProperties(Accessor& accessor) {
+    bool changed = false;
+    for (auto iterProperties = propertyLines.begin(); iterProperties != propertyLines.end();) {
+      const TokenList& lineTokens = getLineTokens(accessor, (*iterProperties).line);
+      const auto& tokens = lineTokens.tokens;
+      bool found = false;
+      for (auto iterToken = tokens.begin(); iterToken != tokens.end(); iterToken++) {
+        if (lineTokens.content(*iterToken) == "property" && std::next(iterToken) != tokens.end() && !isComment(accessor.StyleAt((*iterToken).startPos)) && !isComment(accessor.StyleAt((*std::next(iterToken)).startPos))) {
+          std::string_view currentName = lineTokens.content(*std::next(iterToken));
+          if ((*iterProperties).name != currentName) {
+            propertyNames.erase((*iterProperties).name);
+            (*iterProperties).name = currentName;
+            propertyNames.insert(currentName);
+            changed = true;
+          }
+          found = true;
+          break;
+        }
+      }
+      if (found) {
+        iterProperties++;
+      } else {
+        propertyNames.erase((*iterProperties).name);
+        iterProperties = propertyLines.erase(iterProperties);
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  std::vector<Lexer::BlockMarker>::iterator Lexer::findBlockMarker(Sci_Position line) {
+    return std::lower_bound(blockMarkers.begin(), blockMarkers.end(), line, [](const BlockMarker& blockMarker, Sci_Position line) { return blockMarker.line < line; });
+  }
+
+  std::optional<Lexer::BlockMarker> Lexer::detectBlockMarker(const TokenList& lineTokens, Sci_Position line) const {
+    const auto& tokens = lineTokens.tokens;
+    std::optional<BlockMarker> blockMarker;
+    for (auto iterTokens = tokens.begin(); iterTokens != tokens.end(); iterTokens++) {
+      std::string_view tokenString = lineTokens.content(*iterTokens);
+      if (tokenString == "{" || tokenString == ";" || tokenString == "\"") {
         break;
       }
+      if ((*iterTokens).tokenType != TokenType::Identifier) {
+        continue;
+      }
 
-      if (isblank(ch)) {
-        ch = getNextChar(accessor, index, indexNext);
-      } else if (isalpha(ch) || ch == '_') {
-        Token token {
-          .tokenType = TokenType::Identifier,
-          .startPos = index
-        };
-        while (isalnum(ch) || ch == '_') {
-          token.content.push_back(tolower(ch));
-          ch = getNextChar(accessor, index, indexNext);
+      if (!blockMarker) {
+        auto iterKeyword = std::find_if(std::begin(blockKeywords), std::end(blockKeywords), [&](const BlockKeyword& blockKeyword) { return blockKeyword.keyword == tokenString; });
+        if (iterKeyword != std::end(blockKeywords)) {
+          if ((*iterKeyword).isEnd) {
+            return BlockMarker {
+              .line = line,
+              .kind = (*iterKeyword).kind,
+              .isEnd = true,
+              .hasBody = false,
+              .name = std::string()
+            };
+          }
+
+          // A block needs a name
+          if (std::next(iterTokens) == tokens.end() || (*std::next(iterTokens)).tokenType != TokenType::Identifier) {
+            return std::nullopt;
+          }
+          blockMarker = BlockMarker {
+            .line = line,
+            .kind = (*iterKeyword).kind,
+            .isEnd = false,
+            .hasBody = true,
+            .name = std::string(lineTokens.content(*std::next(iterTokens)))
+          };
+          iterTokens++;
         }
-        tokens.push_back(token);
-      } else if (isdigit(ch) || ch == '-') {
-        Token token {
-          .tokenType = TokenType::Numeric,
-          .startPos = index
-        };
-        bool hasDigit = false;
-        while (isdigit(ch)
-          || (ch == '-' && index == token.startPos) // leading -
-          || (ch == '.' && hasDigit) // decimal point after at least a digit
-          || (tolower(ch) == 'x' && index == token.startPos + 1 && token.content.at(0) == '0') // 0x
-          || (isxdigit(ch) && token.content.size() > 1 && tolower(token.content.at(1)) == 'x')) { // hex value after 0x
-          token.content.push_back(tolower(ch));
-          if (isdigit(ch)) {
-            hasDigit = true;
+      } else if ((*blockMarker).kind == OutlineKind::Function || (*blockMarker).kind == OutlineKind::Event) {
+        // Native functions and events don't have body
+        if (tokenString == "native") {
+          (*blockMarker).hasBody = false;
+        }
+      } else if ((*blockMarker).kind == OutlineKind::Property) {
+        // Neither do auto properties
+        if (tokenString == "auto" || tokenString == "autoreadonly") {
+          (*blockMarker).hasBody = false;
+        }
+      }
+    }
+    return blockMarker;
+  }
+
+  bool Lexer::updateBlockMarker(Sci_Position line, std::optional<BlockMarker>&& blockMarker) {
+    auto iterBlockMarker = findBlockMarker(line);
+    bool exists = (iterBlockMarker != blockMarkers.end() && (*iterBlockMarker).line == line);
+    if (blockMarker) {
+      if (!exists) {
+        blockMarkers.insert(iterBlockMarker, std::move(*blockMarker));
+      } else if (*iterBlockMarker != *blockMarker) {
+        *iterBlockMarker = std::move(*blockMarker);
+      } else {
+        return false;
+      }
+    } else if (exists) {
+      blockMarkers.erase(iterBlockMarker);
+    } else {
+      return false;
+    }
+    outlineValid = false;
+    return true;
+  }
+
+  void Lexer::revalidateBlockMarkers(Accessor& accessor) {
+    std::vector<BlockMarker> markedLines;
+    markedLines.swap(blockMarkers);
+    for (const BlockMarker& markedLine : markedLines) {
+      std::optional<BlockMarker> blockMarker = detectBlockMarker(getLineTokens(accessor, markedLine.line), markedLine.line);
+      if (blockMarker) {
+        blockMarkers.push_back(std::move(*blockMarker));
+      }
+    }
+    outlineValid = false;
+  }
+
+  void Lexer::detectPendingBlockMarkers() {
+    if (!blockMarkersPending || document == nullptr) {
+      return;
+    }
+
+    blockMarkersPending = false;
+    for (Sci_Position line = 0; static_cast<size_t>(line) < lineTokenCache.size(); line++) {
+      CachedLine& cachedLine = lineTokenCache[line];
+      if (!cachedLine.blockMarkerPending) {
+        continue;
+      }
+      if (!cachedLine.valid) {
+        blockMarkersPending = true;
+        continue;
+      }
+
+      // A line doesn't start or end a block if it starts inside a multi-line comment, whose state is kept in previous line end
+      cachedLine.blockMarkerPending = false;
+      State entryState = (line > 0) ? static_cast<State>(document->StyleAt(document->LineStart(line) - 1)) : State::Default;
+      std::optional<BlockMarker> blockMarker;
+      if (entryState != State::CommentDoc && entryState != State::CommentMultiLine) {
+        blockMarker = detectBlockMarker(cachedLine.tokenList, line);
+      }
+      updateBlockMarker(line, std::move(blockMarker));
+    }
+  }
+
+  const std::vector<Lexer::OutlineEntry>& Lexer::getOutline() {
+    detectPendingBlockMarkers();
+    if (!outlineValid) {
+      outline.clear();
+
+      // Indexes of outline entries whose blocks are not closed yet. A state can enclose any block except another state, and
+      // a property can enclose functions. When a new block starts, open blocks that can't enclose it are missing their ends.
+      std::vector<int> openBlocks;
+      auto closeBlocks = [this, &openBlocks](size_t count, Sci_Position endLine) {
+        for (; count > 0; count--) {
+          outline[openBlocks.back()].endLine = endLine;
+          openBlocks.pop_back();
+        }
+      };
+
+      for (const BlockMarker& blockMarker : blockMarkers) {
+        if (blockMarker.isEnd) {
+          // Close the innermost open block of the same kind, along with unclosed blocks inside it
+          auto iterOpenBlock = std::find_if(openBlocks.rbegin(), openBlocks.rend(), [&](int index) { return outline[index].kind == blockMarker.kind; });
+          if (iterOpenBlock != openBlocks.rend()) {
+            size_t unclosedCount = iterOpenBlock - openBlocks.rbegin();
+            closeBlocks(unclosedCount, blockMarker.line - 1);
+            closeBlocks(1, blockMarker.line);
+          }
+        } else {
+          auto canEnclose = [&blockMarker](OutlineKind kind) {
+            return (kind == OutlineKind::State && blockMarker.kind != OutlineKind::State) || (kind == OutlineKind::Property && blockMarker.kind == OutlineKind::Function);
+          };
+          while (!openBlocks.empty() && !canEnclose(outline[openBlocks.back()].kind)) {
+            closeBlocks(1, blockMarker.line - 1);
+          }
+          outline.push_back(OutlineEntry {
+            .kind = blockMarker.kind,
+            .name = blockMarker.name,
+            .startLine = blockMarker.line,
+            .endLine = blockMarker.line,
+            .parent = openBlocks.empty() ? -1 : openBlocks.back()
+          });
+          if (blockMarker.hasBody) {
+            openBlocks.push_back(static_cast<int>(outline.size()) - 1);
           }
-          ch = getNextChar(accessor, index, indexNext);
         }
+      }
+      closeBlocks(openBlocks.size(), documentLineCount - 1);
+      outlineValid = true;
+    }
+    return outline;
+  }
 
-        // In the case when the token is a single '-', it's not numeric
-        if (token.content.at(0) == '-' && token.content.size() == 1) {
-          token.tokenType = TokenType::Special;
+  Lexer::FoldDelta Lexer::getFoldDelta(Accessor& accessor, Sci_Position line) {
+    if (static_cast<size_t>(line) < lineTokenCache.size() && lineTokenCache[line].foldDelta.valid) {
+      return lineTokenCache[line].foldDelta;
+    }
+
+    FoldDelta foldDelta {.valid = true};
+    const TokenList& lineTokens = getLineTokens(accessor, line);
+    for (const Token& token : lineTokens.tokens) {
+      int style = accessor.StyleAt(token.startPos);
+      if (!isComment(style) && style != utility::underlying(State::String)) {
+        countFoldToken(foldDelta, keywordClasses(lineTokens.content(token)));
+      }
+    }
+    if (static_cast<size_t>(line) < lineTokenCache.size()) {
+      lineTokenCache[line].foldDelta = foldDelta;
+    }
+    return foldDelta;
+  }
+
+  void Lexer::countFoldToken(FoldDelta& foldDelta, uint32_t classes) const {
+    if (classes & InFoldOpen) {
+      foldDelta.numFoldOpen++;
+    } else if (classes & InFoldClose) {
+      foldDelta.numFoldClose++;
+    } else if (classes & InFoldMiddle) {
+      foldDelta.hasFoldMiddle = true;
+    }
+  }
+
+  const Lexer::TokenList& Lexer::getLineTokens(Accessor& accessor, Sci_Position line) {
+    if (line < 0 || static_cast<size_t>(line) >= lineTokenCache.size()) {
+      tokenize(accessor, line, uncachedLineTokens, lineReader);
+      tokensScanned += uncachedLineTokens.tokens.size();
+      return uncachedLineTokens;
+    }
+
+    CachedLine& cachedLine = lineTokenCache[line];
+    bool wasValid = cachedLine.valid;
+    if (updateCachedLine(accessor, lineReader, line, cachedLine)) {
+      tokenCacheHits++;
+    } else {
+      tokenCacheMisses++;
+      tokensScanned += cachedLine.tokenList.tokens.size();
+      if (wasValid && !isDirtyLine(line)) {
+        onModificationMissed(line);
+      }
+    }
+    return cachedLine.tokenList;
+  }
+
+  bool Lexer::updateCachedLine(Accessor& accessor, LineReader& lineReader, Sci_Position line, CachedLine& cachedLine) const {
+    Sci_Position lineStart = accessor.LineStart(line);
+    Sci_Position lineLength = accessor.LineStart(line + 1) - lineStart;
+    uint64_t textHash = hashText(lineReader.text(accessor, line));
+    if (cachedLine.valid && cachedLine.lineLength == lineLength && cachedLine.textHash == textHash) {
+      // Line may have been moved by modifications on previous lines
+      if (cachedLine.lineStart != lineStart) {
+        for (Token& token : cachedLine.tokenList.tokens) {
+          token.startPos += lineStart - cachedLine.lineStart;
+          token.endPos += lineStart - cachedLine.lineStart;
         }
-        tokens.push_back(token);
+        cachedLine.lineStart = lineStart;
+      }
+      return true;
+    }
+
+    tokenize(accessor, line, cachedLine.tokenList, lineReader);
+    cachedLine.foldDelta.valid = false;
+    cachedLine.lineStart = lineStart;
+    cachedLine.lineLength = lineLength;
+    cachedLine.textHash = textHash;
+    cachedLine.valid = true;
+    return false;
+  }
+
+  void Lexer::tokenize(Accessor& accessor, Sci_Position line, TokenList& tokenList, LineReader& lineReader) const {
+    tokenList.clear();
+    std::string& arena = tokenList.arena;
+    auto lineStart = accessor.LineStart(line);
+    auto lineEnd = accessor.LineEnd(line);
+
+    // Read the whole line at once. Multi-byte decoding is only needed for non-ASCII characters in a line of a multi-byte document.
+    lineReader.reset();
+    std::string_view lineText = lineReader.text(accessor, line);
+    bool singleByte = (accessor.Encoding() == EncodingType::eightBit || isAscii(lineText));
+
+    auto index = lineStart;
+    auto indexNext = index;
+    int ch = getNextChar(accessor, lineText, lineStart, singleByte, index, indexNext);
+    while (index < lineEnd) {
+      if (ch == '\r' || ch == '\n') {
+        break;
+      }
+
+      if (isBlank(ch)) {
+        ch = getNextChar(accessor, lineText, lineStart, singleByte, index, indexNext);
       } else {
         Token token {
           .tokenType = TokenType::Special,
-          .startPos = index
+          .startPos = index,
+          .endPos = index,
+          .contentOffset = arena.size(),
+          .contentLength = 0
         };
-        token.content.push_back(tolower(ch));
-        tokens.push_back(token);
-        ch = getNextChar(accessor, index, indexNext);
+        if (isAlpha(ch) || ch == '_') {
+          token.tokenType = TokenType::Identifier;
+          while (isAlphaNumeric(ch) || ch == '_') {
+            arena.push_back(toLower(ch));
+            ch = getNextChar(accessor, lineText, lineStart, singleByte, index, indexNext);
+          }
+        } else if (isDigit(ch) || ch == '-') {
+          token.tokenType = TokenType::Numeric;
+          bool hasDigit = false;
+          while (isDigit(ch)
+            || (ch == '-' && index == token.startPos) // leading -
+            || (ch == '.' && hasDigit) // decimal point after at least a digit
+            || (toLower(ch) == 'x' && index == token.startPos + 1 && arena[token.contentOffset] == '0') // 0x
+            || (isHexDigit(ch) && arena.size() - token.contentOffset > 1 && arena[token.contentOffset + 1] == 'x')) { // hex value after 0x
+            arena.push_back(toLower(ch));
+            if (isDigit(ch)) {
+              hasDigit = true;
+            }
+            ch = getNextChar(accessor, lineText, lineStart, singleByte, index, indexNext);
+          }
+
+          // In the case when the token is a single '-', it's not numeric
+          if (arena[token.contentOffset] == '-' && arena.size() - token.contentOffset == 1) {
+            token.tokenType = TokenType::Special;
+          }
+        } else {
+          // Characters beyond 8-bit range are kept as a placeholder, so truncation won't turn them into ASCII symbols
+          token.tokenType = TokenType::Special;
+          arena.push_back(ch <= 0xFF ? toLower(ch) : '\x80');
+          ch = getNextChar(accessor, lineText, lineStart, singleByte, index, indexNext);
+        }
+        token.endPos = index;
+        token.contentLength = arena.size() - token.contentOffset;
+        tokenList.tokens.push_back(token);
+      }
+    }
+  }
+
+  void Lexer::prepareLineStyling(Accessor& accessor, LineReader& lineReader, const TokenList& lineTokens, Sci_Position line, State entryState, bool scanSpans, LineStyling& lineStyling) const {
+    const auto& tokens = lineTokens.tokens;
+    lineStyling.entryState = entryState;
+    lineStyling.tokenStates.resize(tokens.size());
+    lineStyling.nameTokens.clear();
+    lineStyling.propertyToken.reset();
+    lineStyling.foldDelta = FoldDelta {.valid = true};
+    State messageState = entryState;
+
+    for (auto iterTokens = tokens.begin(); iterTokens != tokens.end(); iterTokens++) {
+      std::string_view tokenString = lineTokens.content(*iterTokens);
+      size_t index = static_cast<size_t>(iterTokens - tokens.begin());
+      State& tokenState = lineStyling.tokenStates[index];
+
+      // Check if this line defines a property
+      if (!lineStyling.propertyToken && messageState == State::Default && tokenString == "property" && std::next(iterTokens) != tokens.end() && (*std::next(iterTokens)).tokenType == TokenType::Identifier) {
+        lineStyling.propertyToken = index;
+
+        // Always style "property" keyword as KEYWORD
+        tokenState = State::Keyword;
+        countFoldToken(lineStyling.foldDelta, keywordClasses(tokenString));
+        continue;
+      }
+
+      // Style the rest of a comment or string at once, up to and including its terminator if there is one in this line
+      if (scanSpans && (messageState == State::CommentDoc || messageState == State::CommentMultiLine || messageState == State::Comment || messageState == State::String)) {
+        Sci_Position lineStart = accessor.LineStart(line);
+        size_t spanEnd = findSpanEnd(lineReader.text(accessor, line), static_cast<size_t>((*iterTokens).startPos - lineStart), messageState);
+        auto iterSpanEnd = tokens.end();
+        if (spanEnd != std::string_view::npos) {
+          iterSpanEnd = std::lower_bound(iterTokens, tokens.end(), lineStart + static_cast<Sci_Position>(spanEnd), [](const Token& token, Sci_Position position) {
+            return token.startPos < position;
+          });
+        }
+        std::fill(lineStyling.tokenStates.begin() + index, lineStyling.tokenStates.begin() + (iterSpanEnd - tokens.begin()), messageState);
+        if (spanEnd != std::string_view::npos) {
+          messageState = State::Default;
+        }
+        iterTokens = std::prev(iterSpanEnd);
+        continue;
+      }
+
+      if (messageState == State::CommentDoc) {
+        tokenState = State::CommentDoc;
+        if (tokenString == "}") {
+          messageState = State::Default;
+        }
+      } else if(messageState == State::CommentMultiLine) {
+        tokenState = State::CommentMultiLine;
+        if (tokenString == ";" && iterTokens != tokens.begin() && lineTokens.content(*std::prev(iterTokens)) == "/") {
+          messageState = State::Default;
+        }
+      } else if(messageState == State::Comment) {
+        tokenState = State::Comment;
+      } else if(messageState == State::String) {
+        tokenState = State::String;
+        if (tokenString == "\"") {
+          // This may be an escape for double quote. Check previous tokens
+          int numBackslash = 0;
+          auto iterCheck = iterTokens;
+          while (iterCheck != tokens.begin()) {
+            if (lineTokens.content(*(--iterCheck)) == "\\") {
+              numBackslash++;
+            } else {
+              break;
+            }
+          }
+          if (numBackslash % 2 == 0) {
+            messageState = State::Default;
+          }
+        }
+      } else {
+        // Determine the type of the token and color it
+        if (tokenString == "{") {
+          tokenState = State::CommentDoc;
+          messageState = State::CommentDoc;
+        } else if (tokenString == ";") {
+          if (std::next(iterTokens) != tokens.end() && lineTokens.content(*std::next(iterTokens)) == "/") {
+            tokenState = State::CommentMultiLine;
+            messageState = State::CommentMultiLine;
+          } else {
+            tokenState = State::Comment;
+            messageState = State::Comment;
+          }
+        } else if (tokenString == "\"") {
+          tokenState = State::String;
+          messageState = State::String;
+        } else if ((*iterTokens).tokenType == TokenType::Numeric) {
+          tokenState = State::Number;
+          countFoldToken(lineStyling.foldDelta, keywordClasses(tokenString));
+        } else if ((*iterTokens).tokenType == TokenType::Identifier) {
+          uint32_t classes = keywordClasses(tokenString);
+          countFoldToken(lineStyling.foldDelta, classes);
+          if (!(classes & InFlowControl) && isAlphaNumeric(tokenString.back()) && std::next(iterTokens) != tokens.end() && lineTokens.content(*std::next(iterTokens)) == "(") {
+            // If next token is ( and current token is an identifier but not if/elseif/while, it is a function name.
+            tokenState = State::Function;
+          } else if (classes & InTypes) {
+            tokenState = State::Type;
+          } else if (classes & InFlowControl) {
+            tokenState = State::FlowControl;
+          } else if (classes & InKeywords) {
+            tokenState = State::Keyword;
+          } else if (classes & InKeywords2) {
+            tokenState = State::Keyword2;
+          } else if (classes & InOperators) {
+            tokenState = State::Operator;
+          } else {
+            // Either a property or a class, which is resolved when the line is styled
+            tokenState = State::Default;
+            lineStyling.nameTokens.push_back(index);
+          }
+        } else if ((*iterTokens).tokenType == TokenType::Special) {
+          uint32_t classes = keywordClasses(tokenString);
+          countFoldToken(lineStyling.foldDelta, classes);
+          if (classes & InOperators) {
+            tokenState = State::Operator;
+          } else {
+            tokenState = State::Default;
+          }
+        }
       }
     }
-    return tokens;
+    if (messageState == State::Comment || messageState == State::String) {
+      messageState = State::Default;
+    }
+    lineStyling.endState = messageState;
   }
 
-  void Lexer::colorToken(StyleContext & styleContext, Token token, State state) const {
-    if (styleContext.currentPos < (Sci_PositionU)token.startPos) {
-      styleContext.Forward(token.startPos - styleContext.currentPos);
+  bool Lexer::prepareLinesInParallel(IDocument* pAccess, Sci_Position firstLine, Sci_Position lastLine, State entryState, bool scanSpans, std::vector<LineStyling>& preparedLines) {
+    Sci_Position lineCount = lastLine - firstLine + 1;
+    size_t workerCount = (lexWorkerCount > 0) ? lexWorkerCount : static_cast<size_t>(std::thread::hardware_concurrency());
+    size_t chunkCount = (std::min)(workerCount, static_cast<size_t>(lineCount / PARALLEL_LEX_CHUNK_LINES));
+    if (lineCount < PARALLEL_LEX_MIN_LINES || chunkCount < 2 || firstLine < 0 || static_cast<size_t>(lastLine) >= lineTokenCache.size()) {
+      return false;
+    }
+
+    // Workers read a copy of the range taken here, since a document may only be accessed from the thread that owns it.
+    // Decoding DBCS characters needs the document, so such documents are always prepared on the calling thread.
+    if (pAccess->CodePage() != 0 && pAccess->CodePage() != SC_CP_UTF8) {
+      return false;
+    }
+    DocumentSnapshot snapshot(pAccess, firstLine, lastLine);
+
+    // A line can only start in Default state or inside a multi-line comment. Speculative styling from a comment state stops
+    // once it reaches the same line end state as styling from Default state, since lines after that are styled the same.
+    constexpr State speculativeStates[] {State::CommentDoc, State::CommentMultiLine};
+    struct Chunk {
+      Sci_Position firstLine;
+      Sci_Position endLine;
+      std::vector<LineStyling> speculativeLines[std::size(speculativeStates)];
+      size_t tokenCacheHits {0};
+      size_t tokenCacheMisses {0};
+      size_t tokensScanned {0};
+      Sci_Position firstMissedModificationLine {-1};
+    };
+    std::vector<Chunk> chunks(chunkCount);
+    for (size_t index = 0; index < chunkCount; index++) {
+      chunks[index].firstLine = firstLine + static_cast<Sci_Position>(lineCount * index / chunkCount);
+      chunks[index].endLine = firstLine + static_cast<Sci_Position>(lineCount * (index + 1) / chunkCount);
     }
+    preparedLines.resize(static_cast<size_t>(lineCount));
 
-    styleContext.SetState(utility::underlying(state));
-    styleContext.Forward(token.content.size());
+    // Each chunk only touches its own lines in token cache and prepared lines, and reads the snapshot through its own accessor
+    auto prepareChunk = [&](Chunk& chunk, State chunkEntryState, bool speculate) {
+      Accessor accessor(&snapshot, nullptr);
+      LineReader chunkLineReader;
+      State state = chunkEntryState;
+      for (auto line = chunk.firstLine; line < chunk.endLine; line++) {
+        bool wasValid = lineTokenCache[line].valid;
+        if (updateCachedLine(accessor, chunkLineReader, line, lineTokenCache[line])) {
+          chunk.tokenCacheHits++;
+        } else {
+          chunk.tokenCacheMisses++;
+          chunk.tokensScanned += lineTokenCache[line].tokenList.tokens.size();
+          if (wasValid && !isDirtyLine(line) && chunk.firstMissedModificationLine == -1) {
+            chunk.firstMissedModificationLine = line;
+          }
+        }
+        LineStyling& lineStyling = preparedLines[line - firstLine];
+        prepareLineStyling(accessor, chunkLineReader, lineTokenCache[line].tokenList, line, state, scanSpans, lineStyling);
+        state = lineStyling.endState;
+      }
+
+      if (speculate) {
+        for (size_t index = 0; index < std::size(speculativeStates); index++) {
+          State speculativeState = speculativeStates[index];
+          for (auto line = chunk.firstLine; line < chunk.endLine; line++) {
+            LineStyling& lineStyling = chunk.speculativeLines[index].emplace_back();
+            prepareLineStyling(accessor, chunkLineReader, lineTokenCache[line].tokenList, line, speculativeState, scanSpans, lineStyling);
+            speculativeState = lineStyling.endState;
+            if (speculativeState == preparedLines[line - firstLine].endState) {
+              break;
+            }
+          }
+        }
+      }
+    };
+
+    // First chunk is prepared on the calling thread from the actual state. Any chunk whose worker can't be started is
+    // prepared here as well.
+    std::vector<std::thread> workers;
+    size_t startedChunkEnd = 1;
+    try {
+      for (; startedChunkEnd < chunkCount; startedChunkEnd++) {
+        workers.emplace_back(prepareChunk, std::ref(chunks[startedChunkEnd]), State::Default, true);
+      }
+    } catch (const std::system_error&) {
+    }
+    prepareChunk(chunks[0], entryState, false);
+    for (size_t index = startedChunkEnd; index < chunkCount; index++) {
+      prepareChunk(chunks[index], State::Default, true);
+    }
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+
+    // Stitch chunks together by the state each of them actually starts with, which is where previous chunk ends
+    State state = entryState;
+    for (size_t index = 0; index < chunkCount; index++) {
+      Chunk& chunk = chunks[index];
+      if (index > 0) {
+        auto iterState = std::find(std::begin(speculativeStates), std::end(speculativeStates), state);
+        if (iterState != std::end(speculativeStates)) {
+          auto& speculativeLines = chunk.speculativeLines[iterState - std::begin(speculativeStates)];
+          std::move(speculativeLines.begin(), speculativeLines.end(), preparedLines.begin() + (chunk.firstLine - firstLine));
+        }
+      }
+      state = preparedLines[chunk.endLine - 1 - firstLine].endState;
+      tokenCacheHits += chunk.tokenCacheHits;
+      tokenCacheMisses += chunk.tokenCacheMisses;
+      tokensScanned += chunk.tokensScanned;
+      if (chunk.firstMissedModificationLine != -1) {
+        onModificationMissed(chunk.firstMissedModificationLine);
+      }
+    }
+    parallelLexCalls++;
+    return true;
+  }
+
+  void Lexer::colorToken(StyleWriter& styleWriter, const Token& token, State state) const {
+    styleWriter.forwardTo(token.startPos);
+    styleWriter.setState(utility::underlying(state));
+    styleWriter.forwardTo(token.endPos);
+  }
+
+  size_t Lexer::findSpanEnd(std::string_view lineText, size_t offset, State state) const {
+    // Blanks are skipped when checking previous characters, same as checking previous tokens
+    auto findPrevious = [&lineText](size_t pos) {
+      return (pos > 0) ? lineText.find_last_not_of(" \t", pos - 1) : std::string_view::npos;
+    };
+
+    switch (state) {
+      case State::CommentDoc: {
+        size_t pos = lineText.find('}', offset);
+        return (pos != std::string_view::npos) ? pos + 1 : std::string_view::npos;
+      }
+
+      case State::CommentMultiLine: {
+        for (size_t pos = lineText.find(';', offset); pos != std::string_view::npos; pos = lineText.find(';', pos + 1)) {
+          size_t previous = findPrevious(pos);
+          if (previous != std::string_view::npos && lineText[previous] == '/') {
+            return pos + 1;
+          }
+        }
+        return std::string_view::npos;
+      }
+
+      case State::String: {
+        for (size_t pos = lineText.find('"', offset); pos != std::string_view::npos; pos = lineText.find('"', pos + 1)) {
+          // This may be an escape for double quote. Check previous characters
+          int numBackslash = 0;
+          for (size_t previous = findPrevious(pos); previous != std::string_view::npos && lineText[previous] == '\\'; previous = findPrevious(previous)) {
+            numBackslash++;
+          }
+          if (numBackslash % 2 == 0) {
+            return pos + 1;
+          }
+        }
+        return std::string_view::npos;
+      }
+
+      default:
+        // Single line comment doesn't end until line end
+        return std::string_view::npos;
+    }
   }
 
   bool Lexer::isComment(int style) const {
@@ -364,38 +1108,167 @@ namespace papyrus {
     return styleState == State::Comment || styleState == State::CommentMultiLine || styleState == State::CommentDoc;
   }
 
-  int Lexer::getNextChar(Accessor& accessor, Sci_Position& index, Sci_Position& indexNext) const {
+  void Lexer::onDocumentModified(const SCNotification& notification) {
+    if (document != nullptr && (notification.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))) {
+      Sci_Position line = document->LineFromPosition(notification.position);
+      Sci_Position linesAdded = notification.linesAdded;
+      documentLineCount += linesAdded;
+
+      // Modified line needs to be tokenized again. Lines added or removed along with it are inserted to or removed from cache.
+      if (static_cast<size_t>(line) < lineTokenCache.size()) {
+        lineTokenCache[line].valid = false;
+        lineTokenCache[line].foldDelta.valid = false;
+        auto iterNextLine = lineTokenCache.begin() + line + 1;
+        if (linesAdded > 0) {
+          lineTokenCache.insert(iterNextLine, linesAdded, CachedLine());
+        } else if (linesAdded < 0) {
+          lineTokenCache.erase(iterNextLine, iterNextLine + (std::min)(-linesAdded, lineTokenCache.end() - iterNextLine));
+        }
+      }
+
+      // Shift properties after modified line. Properties on removed lines are dropped, and will be added back when modified
+      // line is lexed if it still defines them.
+      auto iterProperty = findProperty(line + 1);
+      if (linesAdded < 0) {
+        auto iterRemovedEnd = findProperty(line - linesAdded + 1);
+        for (auto iterRemoved = iterProperty; iterRemoved != iterRemovedEnd; iterRemoved++) {
+          propertyNames.erase((*iterRemoved).name);
+          propertiesRemoved = true;
+        }
+        iterProperty = propertyLines.erase(iterProperty, iterRemovedEnd);
+      }
+      for (; iterProperty != propertyLines.end(); iterProperty++) {
+        (*iterProperty).line += linesAdded;
+      }
+
+      // Same for block markers
+      if (linesAdded != 0) {
+        auto iterBlockMarker = findBlockMarker(line + 1);
+        if (linesAdded < 0) {
+          iterBlockMarker = blockMarkers.erase(iterBlockMarker, findBlockMarker(line - linesAdded + 1));
+        }
+        for (; iterBlockMarker != blockMarkers.end(); iterBlockMarker++) {
+          (*iterBlockMarker).line += linesAdded;
+        }
+        outlineValid = false;
+      }
+
+      // Shift tracked lines after modified line
+      if (foldDirtyLineEnd > line) {
+        foldDirtyLineEnd = (std::max)(line, foldDirtyLineEnd + linesAdded);
+      }
+      if (styledLineEnd > line) {
+        styledLineEnd = (std::max)(line, styledLineEnd + linesAdded);
+      }
+      if (dirtyLineEnd > line) {
+        dirtyLineEnd = (std::max)(line, dirtyLineEnd + linesAdded);
+        if (dirtyLineStart > line) {
+          dirtyLineStart = (std::max)(line, dirtyLineStart + linesAdded);
+        }
+      }
+
+      // Add modified lines to dirty range
+      Sci_Position lastModifiedLine = line + (std::max)(linesAdded, Sci_Position{0});
+      if (dirtyLineEnd < dirtyLineStart) {
+        dirtyLineStart = line;
+        dirtyLineEnd = lastModifiedLine;
+      } else {
+        dirtyLineStart = (std::min)(dirtyLineStart, line);
+        dirtyLineEnd = (std::max)(dirtyLineEnd, lastModifiedLine);
+      }
+    }
+  }
+
+  void Lexer::onModificationMissed(Sci_Position line) {
+    // Lines before it are known to be unmodified, since Lex starts from the first line Scintilla found modified
+    Sci_Position lastLine = documentLineCount - 1;
+    dirtyLineStart = (dirtyLineEnd < dirtyLineStart) ? line : (std::min)(dirtyLineStart, line);
+    dirtyLineEnd = lastLine;
+    foldDirtyLineEnd = lastLine;
+  }
+
+  bool Lexer::isDirtyLine(Sci_Position line) const {
+    return (line >= dirtyLineStart && line <= dirtyLineEnd);
+  }
+
+  void Lexer::recordTiming(Timing& timing, Sci_Position lines, std::chrono::steady_clock::time_point startTime) {
+    int64_t elapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    timing.calls++;
+    timing.lines += static_cast<size_t>(lines);
+    timing.totalTime += elapsedTime;
+    timing.maxTime = (std::max)(timing.maxTime, elapsedTime);
+  }
+
+  void Lexer::resetIncrementalState() {
+    styledLineEnd = 0;
+    dirtyLineStart = 0;
+    dirtyLineEnd = -1;
+  }
+
+  int Lexer::getNextChar(Accessor& accessor, std::string_view lineText, Sci_Position lineStart, bool singleByte, Sci_Position& index, Sci_Position& indexNext) const {
     index = indexNext;
-    if (accessor.Encoding() != EncodingType::eightBit) {
+    size_t offset = static_cast<size_t>(index - lineStart);
+    if (offset >= lineText.size()) {
+      // Past the end of line content
+      indexNext = index + 1;
+      return '\n';
+    }
+
+    unsigned char byte = static_cast<unsigned char>(lineText[offset]);
+    if (singleByte || byte < 0x80) {
+      indexNext = index + 1;
+      return byte;
+    } else {
       Sci_Position length {};
       int ch = accessor.MultiByteAccess()->GetCharacterAndWidth(index, &length);
-      indexNext = index + length;
+      indexNext = index + (std::max)(length, Sci_Position(1));
       return ch;
-    } else {
-      indexNext = index + 1;
-      return accessor.SafeGetCharAt(index);
     }
   }
 
-  void Lexer::restyleDocument() const {
-    if (isUsable()) {
-      restyleDocument(MAIN_VIEW);
-      restyleDocument(SUB_VIEW);
+  Lexer::StyleWriter::StyleWriter(Accessor& accessor, Sci_PositionU startPos, Sci_Position length, int initState)
+    : accessor(accessor),
+      currentPos(startPos),
+      endPos(startPos + length),
+      lengthDocument(accessor.Length()),
+      state(initState & 0xFF) {
+    // Same as StyleContext, the range is extended by one when it reaches document end
+    if (endPos == lengthDocument) {
+      endPos++;
     }
+    accessor.StartAt(startPos);
+    accessor.StartSegment(startPos);
   }
 
-  void Lexer::restyleDocument(npp_view_t view) const {
-    // Ask Scintilla to restyle urrent document on the given view, but only when it is using this lexer
-    HWND handle = (view == MAIN_VIEW ? lexerData->nppData._scintillaMainHandle : lexerData->nppData._scintillaSecondHandle);
-    npp_index_t viewDocIndex = static_cast<npp_index_t>(::SendMessage(lexerData->nppData._nppHandle, NPPM_GETCURRENTDOCINDEX, 0, static_cast<LPARAM>(view)));
-    if (viewDocIndex != -1) {
-      npp_buffer_t viewBufferID = static_cast<npp_buffer_t>(::SendMessage(lexerData->nppData._nppHandle, NPPM_GETBUFFERIDFROMPOS, static_cast<WPARAM>(viewDocIndex), static_cast<LPARAM>(view)));
-      if (viewBufferID != 0) {
-        if (lexerData->scriptLangID == static_cast<npp_buffer_t>(::SendMessage(lexerData->nppData._nppHandle, NPPM_GETBUFFERLANGTYPE, static_cast<WPARAM>(viewBufferID), 0))) {
-          ::SendMessage(handle, SCI_COLOURISE, 0, -1);
-        }
-      }
+  void Lexer::StyleWriter::setState(int newState) {
+    if (newState != state) {
+      colourRun();
+      state = newState;
+    }
+  }
+
+  void Lexer::StyleWriter::complete() {
+    colourRun();
+    accessor.Flush();
+  }
+
+  void Lexer::StyleWriter::colourRun() {
+    Sci_Position runEnd = (std::min)(currentPos, lengthDocument);
+    if (runEnd > static_cast<Sci_Position>(accessor.GetStartSegment())) {
+      accessor.ColourTo(runEnd - 1, state);
+      runs++;
+    }
+  }
+
+  std::string_view Lexer::LineReader::text(Accessor& accessor, Sci_Position line) {
+    if (line != bufferLine) {
+      Sci_Position lineStart = accessor.LineStart(line);
+      Sci_Position lineEnd = accessor.LineEnd(line);
+      buffer.resize(lineEnd - lineStart);
+      accessor.MultiByteAccess()->GetCharRange(buffer.data(), lineStart, lineEnd - lineStart);
+      bufferLine = line;
     }
+    return buffer;
   }
 
 } // namespace
@@ -20,22 +20,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "FlatStringSet.hpp"
 #include "SimpleLexerBase.hpp"
 
-#include "..\Common\NotepadPlusPlus.hpp"
+#include "../../external/scintilla/Accessor.h"
+#include "../../external/scintilla/ILexer.h"
+#include "../../external/scintilla/WordList.h"
 
-#include "..\..\external\scintilla\Accessor.h"
-#include "..\..\external\scintilla\ILexer.h"
-#include "..\..\external\scintilla\StyleContext.h"
-#include "..\..\external\scintilla\WordList.h"
-
-#include <list>
-#include <set>
+#include <chrono>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
-#include <windows.h>
-
 #define LEXER_NAME "Papyrus Script"
 #define LEXER_STATUS_TEXT L"Papyrus Script"
 
@@ -45,16 +43,80 @@ namespace papyrus {
 
   class Lexer : public SimpleLexerBase {
     public:
+      // Time spent in Lex or Fold calls. Times are in microseconds.
+      struct Timing {
+        size_t calls;
+        size_t lines;
+        int64_t totalTime;
+        int64_t maxTime;
+      };
+
+      // Kinds of blocks in outline
+      enum class OutlineKind {
+        Function,
+        Event,
+        State,
+        Property
+      };
+
+      // A block in outline, reported through PAPYRUS_LEXER_CALL_GET_OUTLINE. Functions, events and properties without body,
+      // e.g. native functions and auto properties, end on the same line they start. Blocks that are not closed end on last line.
+      struct OutlineEntry {
+        OutlineKind kind;
+        std::string name;
+        Sci_Position startLine;
+        Sci_Position endLine;
+        int parent; // Index of enclosing block in outline, or -1 if there isn't one
+      };
+
+      // Query of innermost block containing a line through PAPYRUS_LEXER_CALL_FIND_BLOCK
+      struct BlockQuery {
+        Sci_Position line;
+        OutlineEntry entry;
+      };
+
+      // Why lines may need to be restyled without being modified
+      enum RestyleReason : uint32_t {
+        UnresolvedNames = 1 << 0, // Lines styled while some of their names were still being resolved
+        FoldMiddle      = 1 << 1, // Lines with fold middle keywords, whose fold levels depend on fold middle setting
+        ClassNameCache  = 1 << 2  // Lines with names resolved without class index, which may depend on class name cache
+      };
+
+      // Range of text from start of the first line to end of the last line
+      struct TextRange {
+        Sci_Position startPos;
+        Sci_Position endPos;
+      };
+
+      // Query of lines to restyle for any of the given reasons through PAPYRUS_LEXER_CALL_GET_RESTYLE_RANGES. Consecutive lines
+      // are merged into one range. Lexing doesn't stop early before any of these lines until they are restyled.
+      struct RestyleQuery {
+        uint32_t reasons;
+        std::vector<TextRange> ranges;
+      };
+
+      // Counters reported through PAPYRUS_LEXER_CALL_GET_STATISTICS
+      struct Statistics {
+        size_t tokenCacheHits;
+        size_t tokenCacheMisses;
+        size_t tokensScanned; // Tokens found in lines tokenized on token cache misses
+        Timing lexTiming;
+        Timing foldTiming;
+        size_t styleRuns;
+        size_t parallelLexCalls; // Lex calls with lines prepared on worker threads
+      };
+
       Lexer();
 
       // Interface functions with Notepad++
       inline static char* name() { return const_cast<char*>(LEXER_NAME); }
-      inline static TCHAR* statusText() { return const_cast<TCHAR*>(LEXER_STATUS_TEXT); }
+      inline static wchar_t* statusText() { return const_cast<wchar_t*>(LEXER_STATUS_TEXT); }
       inline static ILexer* factory() { return new Lexer(); }
 
       // Lexer functions
       void SCI_METHOD Lex(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument* pAccess) override;
       void SCI_METHOD Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, IDocument* pAccess) override;
+      void* SCI_METHOD PrivateCall(int operation, void* pointer) override;
 
     protected:
       // Only when configuration file exists under Notepad++'s plugin config folder can this lexer be used
@@ -86,38 +148,240 @@ namespace papyrus {
         Function
       };
 
+      // Masks of word lists returned by keywordClasses()
+      enum KeywordClass : uint32_t {
+        InOperators   = 1 << 0, // instre1
+        InFlowControl = 1 << 1, // instre2
+        InTypes       = 1 << 2, // type1
+        InKeywords    = 1 << 3, // type2
+        InKeywords2   = 1 << 4, // type3
+        InFoldOpen    = 1 << 5, // type4
+        InFoldMiddle  = 1 << 6, // type5
+        InFoldClose   = 1 << 7  // type6
+      };
+
       // Defined properties in current Papyrus script
       struct Property {
         std::string name;
         Sci_Position line;
       };
 
+      // A line that starts or ends a block. Only one is recorded per line.
+      struct BlockMarker {
+        Sci_Position line;
+        OutlineKind kind;
+        bool isEnd;
+        bool hasBody;
+        std::string name;
+
+        bool operator==(const BlockMarker& other) const = default;
+      };
+
       enum class TokenType {
         Identifier,
         Numeric,
         Special
       };
+
+      // A token doesn't own its content. Instead, it refers to a case folded copy stored in the arena of the token list it belongs to.
       struct Token {
-        std::string content;
         TokenType tokenType;
         Sci_Position startPos;
+        Sci_Position endPos;
+        size_t contentOffset;
+        size_t contentLength;
       };
 
-      // Parse a text line and tokenize each word/symbol, etc.
-      std::vector<Token> tokenize(Accessor& accessor, Sci_Position line) const;
+      // Tokens of a text line. Token contents are stored back to back in the arena. Since clear() keeps allocated capacity,
+      // reusing a list means no heap allocation per token.
+      struct TokenList {
+        std::vector<Token> tokens;
+        std::string arena;
 
-      // Colorize a word/symbol in StyleContext to a provided state based on the given token.
-      void colorToken(StyleContext& styleContext, Token token, State state) const;
+        inline std::string_view content(const Token& token) const { return std::string_view(arena.data() + token.contentOffset, token.contentLength); }
+        inline void clear() { tokens.clear(); arena.clear(); }
+      };
 
-      // Get next character (wide char supported)
-      int getNextChar(Accessor& accessor, Sci_Position& index, Sci_Position& indexNext) const;
+      // Fold keywords found in a text line, outside of comments and strings. Collected when the line is lexed.
+      struct FoldDelta {
+        int numFoldOpen {0};
+        int numFoldClose {0};
+        bool hasFoldMiddle {false};
+        bool valid {false};
 
-      // If a style (from StyleContext) is a comment style defined by this lexer
+        bool operator==(const FoldDelta& other) const = default;
+      };
+
+      // Token cache entry of a text line. Line start, length and text hash are recorded when the line is tokenized, so a line
+      // that only moved due to modifications on previous lines can be reused by shifting its tokens. Text hash catches lines
+      // modified without a notification reaching this lexer, e.g. through Replace All in all opened documents.
+      struct CachedLine {
+        TokenList tokenList;
+        Sci_Position lineStart {0};
+        Sci_Position lineLength {0};
+        uint64_t textHash {0};
+        bool valid {false};
+        FoldDelta foldDelta;
+        bool hasUnresolvedNames {false}; // Styled while some of its names were still being resolved
+        bool hasUnindexedNames {false};  // Styled with names resolved without class index
+        bool restylePending {false};     // Reported to be restyled, but not restyled yet
+        bool blockMarkerPending {false}; // Lexed since its block marker was last detected
+      };
+
+      // Styling of a text line worked out from its tokens and the state it starts with. Names that may be properties or
+      // classes are resolved when the line is styled, since properties defined in previous lines affect them.
+      struct LineStyling {
+        State entryState {State::Default};
+        State endState {State::Default};     // State carried to next line, i.e. Default unless in a multi-line comment
+        std::vector<State> tokenStates;      // State of each token, which is Default for names to be resolved
+        std::vector<size_t> nameTokens;      // Indexes of names to be resolved, in order
+        std::optional<size_t> propertyToken; // Index of "property" keyword that defines a property named by next token
+        FoldDelta foldDelta {.valid = true};
+      };
+
+      // Read text lines through an accessor, keeping the line last read. Each thread reading lines needs its own reader.
+      class LineReader {
+        public:
+          // Get text of a line without line end, which stays valid until another line is read
+          std::string_view text(Accessor& accessor, Sci_Position line);
+
+          // Forget the line last read, so it is read from document again
+          inline void reset() { bufferLine = -1; }
+
+        private:
+          // Private members
+          //
+          std::string buffer;
+          Sci_Position bufferLine {-1};
+      };
+
+      // Write styles through accessor as runs of the same state. Unlike StyleContext, which moves character by character and
+      // writes a segment on every state change call, it jumps to positions directly and only writes when the state differs.
+      class StyleWriter {
+        public:
+          StyleWriter(Accessor& accessor, Sci_PositionU startPos, Sci_Position length, int initState);
+
+          inline Sci_Position position() const { return currentPos; }
+
+          // Character at current position, or the default when out of document
+          inline char currentChar() { return accessor.SafeGetCharAt(currentPos); }
+
+          // Move forward to given position, which is limited to the end of styling range
+          inline void forwardTo(Sci_Position position) { currentPos = (std::min)((std::max)(currentPos, position), endPos); }
+
+          // Text from current position onwards has given state
+          void setState(int newState);
+
+          // Write the last run and flush styles to document
+          void complete();
+
+          inline size_t runCount() const { return runs; }
+
+        private:
+          // Write the run that ends before current position
+          void colourRun();
+
+          // Private members
+          //
+          Accessor& accessor;
+          Sci_Position currentPos;
+          Sci_Position endPos;
+          Sci_Position lengthDocument;
+          int state;
+          size_t runs {0};
+      };
+
+      // Check if a lower case name is a class in current game, i.e. there is a source file with this name in import directories.
+      // Resolved by the class resolver shared by all lexer instances. Returns nullopt if the name is being resolved in background.
+      std::optional<bool> isClassName(std::string_view name);
+
+      // Whether a line has been reported to be restyled but it hasn't been restyled yet
+      bool isRestylePending(Sci_Position line) const;
+
+      // Get ranges of consecutive lines that need to be restyled for any of the given reasons, and mark them as pending restyle
+      std::vector<TextRange> getRestyleRanges(uint32_t reasons);
+
+      // Get the first property defined on or after given line
+      std::vector<Property>::iterator findProperty(Sci_Position line);
+
+      // Check all property lines again and update their names, or remove them if they no longer define a property.
+      // Only needed when modifications are missed, since otherwise property lines are checked when they are lexed.
+      bool revalidateProperties(Accessor& accessor);
+
+      // Get the first block marker on or after given line
+      std::vector<BlockMarker>::iterator findBlockMarker(Sci_Position line);
+
+      // Detect the block keyword in a line's tokens, ignoring anything after a comment or string starts
+      std::optional<BlockMarker> detectBlockMarker(const TokenList& lineTokens, Sci_Position line) const;
+
+      // Set or remove the block marker of a line. Returns true if it's changed.
+      bool updateBlockMarker(Sci_Position line, std::optional<BlockMarker>&& blockMarker);
+
+      // Detect block markers on their lines again. Only needed when modifications are missed.
+      void revalidateBlockMarkers(Accessor& accessor);
+
+      // Detect block markers of lines lexed since last query from their cached tokens. Lines modified since they were lexed
+      // stay pending until they are lexed again.
+      void detectPendingBlockMarkers();
+
+      // Pair block markers into outline entries, if they have changed since outline was last built. Pending block markers are
+      // detected first.
+      const std::vector<OutlineEntry>& getOutline();
+
+      // Get fold delta of a text line, which is collected by Lex. If it's not available, it is counted from tokens and styles.
+      FoldDelta getFoldDelta(Accessor& accessor, Sci_Position line);
+
+      // Count a token that is not in comment or string towards fold delta
+      void countFoldToken(FoldDelta& foldDelta, uint32_t classes) const;
+
+      // Get tokens of a text line, from token cache if the line hasn't been modified since it was tokenized
+      const TokenList& getLineTokens(Accessor& accessor, Sci_Position line);
+
+      // Tokenize a cached line again, unless it hasn't been modified since it was tokenized. Returns true if it's reused.
+      bool updateCachedLine(Accessor& accessor, LineReader& lineReader, Sci_Position line, CachedLine& cachedLine) const;
+
+      // Parse a text line read by given line reader and tokenize each word/symbol, etc. into the given token list
+      void tokenize(Accessor& accessor, Sci_Position line, TokenList& tokenList, LineReader& lineReader) const;
+
+      // Work out styling of a text line from its tokens and the state it starts with. Only reads document and keyword table,
+      // so lines can be prepared on worker threads, each with its own accessor and line reader.
+      void prepareLineStyling(Accessor& accessor, LineReader& lineReader, const TokenList& lineTokens, Sci_Position line, State entryState, bool scanSpans, LineStyling& lineStyling) const;
+
+      // Tokenize and prepare styling of lines in given range on worker threads, if more than one is set and the range is large
+      // enough. Workers read a snapshot of the range taken on the calling thread, never the document itself. The range is
+      // split into chunks, and the state each chunk starts with is only known after previous chunks are done, so a chunk is
+      // prepared from Default state and speculatively from other states a line can start with, which are then stitched
+      // together by actual states. Returns false if lines are not prepared.
+      bool prepareLinesInParallel(IDocument* pAccess, Sci_Position firstLine, Sci_Position lastLine, State entryState, bool scanSpans, std::vector<LineStyling>& preparedLines);
+
+      // Colorize a word/symbol to a provided state based on the given token.
+      void colorToken(StyleWriter& styleWriter, const Token& token, State state) const;
+
+      // Find the end of a comment or string span in line text that starts at given offset, i.e. the offset right after the
+      // terminator. Returns npos if the span doesn't end in this line.
+      size_t findSpanEnd(std::string_view lineText, size_t offset, State state) const;
+
+      // Get next character of given line text. Multi-byte characters are decoded unless the line is single byte.
+      int getNextChar(Accessor& accessor, std::string_view lineText, Sci_Position lineStart, bool singleByte, Sci_Position& index, Sci_Position& indexNext) const;
+
+      // If a style is a comment style defined by this lexer
       bool isComment(int style) const;
 
-      // Restyle current document, which includes Lex and Fold
-      void restyleDocument() const;
-      void restyleDocument(npp_view_t view) const;
+      // Track modified lines reported by Notepad++, so Lex knows which lines can be skipped
+      void onDocumentModified(const SCNotification& notification);
+
+      // Track a line found modified outside of tracked modifications, e.g. through another view. Other lines after it may
+      // have been modified unnoticed as well, so all of them are marked dirty for Lex and Fold to go through.
+      void onModificationMissed(Sci_Position line);
+
+      // If a line is in the range of tracked modifications
+      bool isDirtyLine(Sci_Position line) const;
+
+      // Add time elapsed since given start time of a Lex or Fold call that went through given number of lines
+      void recordTiming(Timing& timing, Sci_Position lines, std::chrono::steady_clock::time_point startTime);
+
+      // Forget all tracked modifications, so next Lex call restyles the whole range it is given
+      void resetIncrementalState();
 
       // Private members
       //
@@ -136,16 +400,69 @@ namespace papyrus {
       const std::vector<WordList*> instreWordLists;
       const std::vector<WordList*> typeWordLists;
 
-      // Cache list of lines that define properties
-      std::list<Property> propertyLines;
-
-      // Cache property names defined in current file, for better performance
-      std::set<std::string> propertyNames;
-
-       // Cache names that are classes (i.e. files in import directories) used in current file, and names that aren't, for better performance
-       // Caveat: when a new class is saved to the import directory it won't be reflected, so current file needs to be reloaded
-      std::set<std::string> classNames;
-      std::set<std::string> nonClassNames;
+      // Token cache indexed by line number. Entries are invalidated, inserted or removed along with document modifications.
+      std::vector<CachedLine> lineTokenCache;
+      size_t tokenCacheHits {0};
+      size_t tokenCacheMisses {0};
+      size_t tokensScanned {0};
+
+      // Time spent in Lex and Fold calls
+      Timing lexTiming {};
+      Timing foldTiming {};
+      size_t styleRuns {0};
+      size_t parallelLexCalls {0};
+
+      // Number of threads preparing lines of a large Lex range, or 0 for one per processor core. Lines are prepared on the
+      // calling thread by default, until preparing them on worker threads is measured to be faster.
+      size_t lexWorkerCount {1};
+
+      // Text of the line last read
+      LineReader lineReader;
+
+      // Styling of the line being lexed, when it's not prepared ahead
+      LineStyling unpreparedLineStyling;
+
+      // Token list for lines outside of token cache
+      TokenList uncachedLineTokens;
+
+      // Cache list of lines that define properties, sorted by line. Line numbers are shifted along with document modifications.
+      std::vector<Property> propertyLines;
+
+      // Cache property names defined in current file, for better performance. A name is kept as long as any line defines it.
+      FlatStringSet propertyNames;
+
+      // Whether properties were dropped along with removed lines since last Lex call
+      bool propertiesRemoved {false};
+
+      // Lines that start or end blocks, sorted by line. Line numbers are shifted along with document modifications. Lex only
+      // marks lines whose block markers need to be detected again, which is deferred until outline is queried.
+      std::vector<BlockMarker> blockMarkers;
+      bool blockMarkersPending {false};
+
+      // Outline built from block markers, sorted by start line. Rebuilt on query once block markers have changed.
+      std::vector<OutlineEntry> outline;
+      bool outlineValid {false};
+
+      // Document being lexed. Only available after the first Lex call
+      IDocument* document {nullptr};
+
+      // Incremental lexing state. Lines before styledLineEnd have been styled, and lines in [dirtyLineStart, dirtyLineEnd] have
+      // been modified since then. documentLineCount is updated along with modifications to detect any missed notification.
+      Sci_Position documentLineCount {0};
+      Sci_Position styledLineEnd {0};
+      Sci_Position dirtyLineStart {0};
+      Sci_Position dirtyLineEnd {-1};
+
+      // Fold levels are calculated from fold deltas. Lines after foldDirtyLineEnd have the same fold deltas as when they were
+      // last folded and aren't waiting to be refolded for fold middle setting, so Fold can stop once a calculated level matches
+      // the existing one, unless fold middle setting changed.
+      Sci_Position foldDirtyLineEnd {-1};
+      bool foldMiddleEnabled {false};
+
+      // Version of class index used when lines were styled. Everything needs to be restyled when it changes, so the document
+      // is only up to date with a version once all of its lines have been styled with it.
+      unsigned int classIndexVersion {0};
+      unsigned int restyledClassIndexVersion {0};
   };
 
 } // namespace
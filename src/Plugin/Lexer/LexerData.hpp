@@ -19,31 +19,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
+#include "ClassResolver.hpp"
 #include "LexerSettings.hpp"
-#include "..\Common\Game.hpp"
+#include "../Common/Game.hpp"
 
-#include "..\..\external\npp\PluginInterface.h"
-
-#include <map>
 #include <memory>
-#include <string>
-#include <vector>
 
 namespace papyrus {
 
   using Game = game::Game;
-  using game_import_dirs_t = std::map<Game, std::vector<std::wstring>>;
 
   struct LexerData {
-    LexerData(const NppData& nppData, LexerSettings& settings, Game currentGame = Game::Auto, game_import_dirs_t importDirectories = game_import_dirs_t(), bool usable = true)
-      : nppData(nppData), settings(settings), currentGame(currentGame), importDirectories(importDirectories), scriptLangID(0), usable(usable) {
+    LexerData(LexerSettings& settings, Game currentGame = Game::Auto, bool usable = true)
+      : settings(settings), currentGame(currentGame), classResolver(static_cast<size_t>(settings.classNameCacheSize) * 1024), usable(usable) {
     }
 
-    const NppData& nppData;
     LexerSettings& settings;
     Game currentGame;
-    game_import_dirs_t importDirectories;
-    npp_lang_type_t scriptLangID;
+    ClassResolver classResolver; // Shared by all lexer instances
     bool usable;
   };
 
@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "..\..\external\scintilla\LexerModule.h"
 
+#include <windows.h>
+
 namespace papyrus {
 
   int SCI_METHOD GetLexerCount() {
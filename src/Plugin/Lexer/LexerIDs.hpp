@@ -21,3 +21,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 // Start at a big number to avoid potential conflict with other lexers
 #define SCLEX_PAPYRUS_SCRIPT  18000
+
+// Operations supported by the lexer through SCI_PRIVATELEXERCALL
+#define PAPYRUS_LEXER_CALL_DOCUMENT_MODIFIED  1  // pointer: SCNotification* of SCN_MODIFIED
+#define PAPYRUS_LEXER_CALL_GET_STATISTICS     2  // pointer: Lexer::Statistics* to be filled
+#define PAPYRUS_LEXER_CALL_IS_OUTDATED        3  // returns non-null if class index has changed since the whole document was last styled
+#define PAPYRUS_LEXER_CALL_GET_OUTLINE        4  // pointer: std::vector<Lexer::OutlineEntry>* to be filled
+#define PAPYRUS_LEXER_CALL_FIND_BLOCK         5  // pointer: Lexer::BlockQuery* with line set. Returns non-null if a block contains the line
+#define PAPYRUS_LEXER_CALL_GET_RESTYLE_RANGES 6  // pointer: Lexer::RestyleQuery* with reasons set. Ranges of lines to restyle are filled
+#define PAPYRUS_LEXER_CALL_SET_LEX_WORKERS    7  // pointer: size_t* with number of threads preparing large Lex ranges, 1 by default, 0 for one per processor core
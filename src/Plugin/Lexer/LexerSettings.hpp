@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
-#include "..\Common\PrimitiveTypeValueMonitor.hpp"
+#include "../Common/PrimitiveTypeValueMonitor.hpp"
 
 #include <string>
 
@@ -28,6 +28,7 @@ namespace papyrus {
   struct LexerSettings {
     utility::PrimitiveTypeValueMonitor<bool> enableFoldMiddle;
     utility::PrimitiveTypeValueMonitor<bool> enableClassNameCache;
+    utility::PrimitiveTypeValueMonitor<int>  classNameCacheSize; // In KB
   };
 
 } // namespace
@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "SimpleLexerBase.hpp"
 
-#include "..\..\external\scintilla\LexerModule.h"
+#include "../../external/scintilla/LexerModule.h"
 
 #include <string>
 
@@ -53,6 +53,7 @@ namespace papyrus {
         newList.Set(wl);
         if (newList != *wordList) {
           wordList->Set(wl);
+          buildKeywordTable();
           return 0;
         }
       }
@@ -64,4 +65,15 @@ namespace papyrus {
     return subStyleBases;
   }
 
+  // Private methods
+  //
+
+  void SimpleLexerBase::buildKeywordTable() {
+    std::vector<WordList*> lists(getInstreWordLists());
+    lists.resize(2, nullptr);
+    const auto& typeWordLists = getTypeWordLists();
+    lists.insert(lists.end(), typeWordLists.begin(), typeWordLists.end());
+    keywordTable.build(lists);
+  }
+
 } // namespace
@@ -19,14 +19,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 
-#include "..\..\external\scintilla\Accessor.h"
-#include "..\..\external\scintilla\ILexer.h"
-#include "..\..\external\scintilla\Scintilla.h"
-#include "..\..\external\scintilla\WordList.h"
+#include "KeywordTable.hpp"
 
-#include <vector>
+#include "../../external/scintilla/Accessor.h"
+#include "../../external/scintilla/ILexer.h"
+#include "../../external/scintilla/Scintilla.h"
+#include "../../external/scintilla/WordList.h"
 
-#include <windows.h>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
 namespace papyrus {
 
@@ -83,9 +85,17 @@ namespace papyrus {
       // A list of WordList pointers for type1 - 7. If not all instre word lists are supported, just return a partial list (e.g. type1 - 4). If a list is skipped, use nullptr.
       virtual const std::vector<WordList*>& getTypeWordLists() const = 0;
 
+      // Get mask of all word lists containing the given word in a single lookup. Bit positions follow word list set indices,
+      // i.e. bit 0 & 1 for instre1 & 2, and bit 2 - 8 for type1 - 7.
+      inline uint32_t keywordClasses(std::string_view word) const { return keywordTable.find(word); }
+
     private:
+      // Rebuild keyword table after any word list changes
+      void buildKeywordTable();
+
       const char* name;
       int id;
+      KeywordTable keywordTable;
   };
 
 } // namespace
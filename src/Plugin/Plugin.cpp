@@ -33,33 +33,40 @@ https://community.notepad-plus-plus.org/category/5/plugin-development
 #include "Compiler\CompilationRequest.hpp"
 #include "Lexer\Lexer.hpp"
 #include "Lexer\LexerData.hpp"
+#include "Lexer\LexerIDs.hpp"
 
 #include "..\external\tinyxml2\tinyxml2.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <set>
 #include <sstream>
 #include <string>
+#include <tuple>
+
+#include <shlobj.h>
 
 papyrus::Plugin papyrusPlugin;
 
 namespace papyrus {
 
-  // Static variables shared with Lexer
-  std::unique_ptr<LexerData> lexerData;
-
   // Internal static variables
   namespace {
     std::vector<LPCWSTR> advancedMenuItems {
       L"Show langID",
       L"Add auto completion support",
-      L"Add function list support"
+      L"Add function list support",
+      L"Show lexer statistics",
+      L"Show compilation cache statistics"
     };
   }
 
   Plugin::Plugin()
     : funcs{
       FuncItem{ L"Compile", compileMenuFunc, 0, false, new ShortcutKey{true, false, true, 0x43} },
+      FuncItem{ L"Compile all open scripts", compileOpenScriptsMenuFunc, 0, false, nullptr },
+      FuncItem{ L"Compile folder...", compileFolderMenuFunc, 0, false, nullptr },
       FuncItem{ L"Settings...", settingsMenuFunc, 0, false, nullptr },
       FuncItem{}, // Separator1
       FuncItem{ L"Advanced", advancedMenuFunc, 0, false, nullptr },
@@ -93,7 +100,14 @@ namespace papyrus {
       switch (notification->nmhdr.code) {
         case SCN_MODIFIED: {
           if (notification->modificationType & SC_MOD_INSERTTEXT || notification->modificationType & SC_MOD_DELETETEXT) {
-            // TODO
+            // Let the lexer know which lines are modified so it can skip unaffected lines when restyling.
+            // When a document is cloned to both views, each view sends a notification for the same modification, so only handle it once.
+            HWND handle = static_cast<HWND>(notification->nmhdr.hwndFrom);
+            if (handle == nppData._scintillaMainHandle || ::SendMessage(handle, SCI_GETDOCPOINTER, 0, 0) != ::SendMessage(nppData._scintillaMainHandle, SCI_GETDOCPOINTER, 0, 0)) {
+              if (::SendMessage(handle, SCI_GETLEXER, 0, 0) == SCLEX_PAPYRUS_SCRIPT) {
+                ::SendMessage(handle, SCI_PRIVATELEXERCALL, PAPYRUS_LEXER_CALL_DOCUMENT_MODIFIED, reinterpret_cast<LPARAM>(notification));
+              }
+            }
           }
         }
         break;
@@ -114,6 +128,19 @@ namespace papyrus {
           break;
         }
 
+        case NPPN_SHUTDOWN: {
+          // Stop class index worker threads while Notepad++ is still running
+          if (lexerData) {
+            lexerData->classResolver.shutdown();
+          }
+
+          // Queued compilations are dropped
+          if (compiler) {
+            compiler->shutdown();
+          }
+          break;
+        }
+
         default: {
           break;
         }
@@ -139,6 +166,14 @@ namespace papyrus {
             case AdvancedMenu::AddFunctionList:
               addFunctionList();
               break;
+
+            case AdvancedMenu::ShowLexerStatistics:
+              showLexerStatistics();
+              break;
+
+            case AdvancedMenu::ShowCompilationCacheStatistics:
+              showCompilationCacheStatistics();
+              break;
           }
         }
         break;
@@ -150,7 +185,16 @@ namespace papyrus {
   //
 
   void Plugin::initializeComponents() {
-    lexerData = std::make_unique<LexerData>(nppData, settings.lexerSettings);
+    lexerData = std::make_unique<LexerData>(settings.lexerSettings);
+    settings.lexerSettings.enableFoldMiddle.addWatcher([&](bool oldValue, bool newValue) { requestRestyle(Lexer::FoldMiddle); });
+    settings.lexerSettings.enableClassNameCache.addWatcher([&](bool oldValue, bool newValue) {
+      // Names cached before may be outdated by the time caching is turned on again
+      lexerData->classResolver.clearCaches();
+      requestRestyle(Lexer::ClassNameCache);
+    });
+    settings.lexerSettings.classNameCacheSize.addWatcher([&](int oldValue, int newValue) {
+      lexerData->classResolver.setCacheCapacity(static_cast<size_t>(newValue) * 1024);
+    });
     errorsWindow = std::make_unique<ErrorsWindow>(instance, nppData._nppHandle, messageWindow);
     errorAnnotator = std::make_unique<ErrorAnnotator>(nppData, settings.errorAnnotatorSettings);
     settingsDialog.init(instance, nppData._nppHandle);
@@ -166,6 +210,13 @@ namespace papyrus {
 
       checkLexerConfigFile(configPath);
 
+      // Load class names cached in last session before class indexes get created along with settings
+      try {
+        lexerData->classResolver.loadIndexCache(std::filesystem::path(configPath) / PLUGIN_NAME L".classindex");
+      } catch (...) {
+        // Files kept from last session only save work, so start without them if they can't be read
+      }
+
       // Load settings
       settingsStorage.init(std::filesystem::path(configPath) / PLUGIN_NAME L".ini");
       if (!settings.loadSettings(settingsStorage, utility::Version(PLUGIN_VERSION))) {
@@ -180,13 +231,26 @@ namespace papyrus {
       CompilerMessages compilerMessages {
         .compilationDoneMessage = PPM_COMPILATION_DONE,
         .compilationFailureMessage = PPM_COMPILATION_FAILED,
+        .compilationProgressMessage = PPM_COMPILATION_PROGRESS,
         .anonymizationFailureMessage = PPM_ANONYMIZATION_FAILED,
         .compilerNotFoundMessage = PPM_COMPILER_NOT_FOUND,
         .otherErrordMessage = PPM_OTHER_ERROR,
         .withAnonymization = PARAM_COMPILATION_WITH_ANONYMIZATION,
-        .compilationOnly = PARAM_COMPILATION_ONLY
+        .compilationOnly = PARAM_COMPILATION_ONLY,
+        .restoredFromCache = PARAM_COMPILATION_FROM_CACHE,
+        .upToDate = PARAM_COMPILATION_UP_TO_DATE
       };
       compiler = std::make_unique<Compiler>(messageWindow, compilerMessages, settings.compilerSettings);
+      try {
+        compiler->loadDependencyGraph(std::filesystem::path(configPath) / PLUGIN_NAME L".dependencies");
+      } catch (...) {
+        // Same as class index cache
+      }
+      try {
+        compiler->openOutputCache(std::filesystem::path(configPath) / PLUGIN_NAME L".pexcache");
+      } catch (...) {
+        // Same as class index cache
+      }
     }
   }
 
@@ -233,12 +297,10 @@ namespace papyrus {
         auto [detectedGame, useAutoModeOutputDirectory] = detectGameType(filePath, settings.compilerSettings);
         lexerData->currentGame = detectedGame;
 
-        // Check if active compilation file is still the current one on either view
-        if (activeCompilationRequest.bufferID != 0) {
-          isComplingCurrentFile = utility::compare(activeCompilationRequest.filePath, filePath);
-          if (isComplingCurrentFile) {
-            ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Compiling..."));
-          }
+        // Check if activated file is being compiled
+        bool isCompilingCurrentFile = isCompiling(filePath);
+        if (isCompilingCurrentFile) {
+          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Compiling..."));
         }
 
         // Check if we are waiting for a file to open as a result of user selecting an error from list
@@ -269,6 +331,9 @@ namespace papyrus {
           }
         }
 
+        // Class index may have been updated, or class names resolved, while this document was hidden
+        restyleDocument((currentView == MAIN_VIEW) ? nppData._scintillaMainHandle : nppData._scintillaSecondHandle, Lexer::UnresolvedNames);
+
         npp_lang_type_t currentFileLangID;
         ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTLANGTYPE, 0, reinterpret_cast<LPARAM>(&currentFileLangID));
         if (utility::endsWith(filePath, L".psc")) {
@@ -278,7 +343,7 @@ namespace papyrus {
             updateAnnotation = true;
 
             // If not compiling current file, check its game type (if applicable)
-            if (!isComplingCurrentFile && detectedGame != Game::Auto) {
+            if (!isCompilingCurrentFile && detectedGame != Game::Auto) {
               std::wstring gameSpecificStatus(L"[" + game::gameNames[utility::underlying(detectedGame)].second + L"] " + Lexer::statusText());
               ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(gameSpecificStatus.c_str()));
             }
@@ -303,11 +368,47 @@ namespace papyrus {
 
   void Plugin::updateLexerDataGameSettings(Game game, const CompilerSettings::GameSettings& gameSettings) {
     if (lexerData) {
-      lexerData->importDirectories[game].clear();
+      std::vector<std::wstring> importDirectories;
       std::wstringstream stream(gameSettings.importDirectories);
       std::wstring path;
       while (std::getline(stream, path, L';')) {
-        lexerData->importDirectories[game].push_back(path);
+        importDirectories.push_back(path);
+      }
+
+      // Index gets updated and names get resolved on worker threads, so let plugin's message window handle the update on UI thread
+      HWND window = messageWindow;
+      lexerData->classResolver.setImportDirectories(game, importDirectories, [window]() { ::PostMessage(window, PPM_CLASS_NAMES_UPDATED, 0, 0); });
+    }
+  }
+
+  void Plugin::requestRestyle(uint32_t reasons) {
+    // Requests made within one UI tick are handled together once plugin's message window gets to the posted message
+    if (pendingRestyleReasons == 0) {
+      ::PostMessage(messageWindow, PPM_RESTYLE_DOCUMENTS, 0, 0);
+    }
+    pendingRestyleReasons |= reasons;
+  }
+
+  void Plugin::restyleDocuments() {
+    uint32_t reasons = pendingRestyleReasons;
+    pendingRestyleReasons = 0;
+    restyleDocument(nppData._scintillaMainHandle, reasons);
+    restyleDocument(nppData._scintillaSecondHandle, reasons);
+  }
+
+  void Plugin::restyleDocument(HWND handle, uint32_t reasons) {
+    // Only restyle the document shown in the given view when it is using this plugin's lexer
+    if (::SendMessage(handle, SCI_GETLEXER, 0, 0) == SCLEX_PAPYRUS_SCRIPT) {
+      if (::SendMessage(handle, SCI_PRIVATELEXERCALL, PAPYRUS_LEXER_CALL_IS_OUTDATED, 0) != 0) {
+        ::SendMessage(handle, SCI_COLOURISE, 0, -1);
+      } else {
+        Lexer::RestyleQuery query {
+          .reasons = reasons
+        };
+        ::SendMessage(handle, SCI_PRIVATELEXERCALL, PAPYRUS_LEXER_CALL_GET_RESTYLE_RANGES, reinterpret_cast<LPARAM>(&query));
+        for (const auto& range : query.ranges) {
+          ::SendMessage(handle, SCI_COLOURISE, range.startPos, range.endPos);
+        }
       }
     }
   }
@@ -326,11 +427,6 @@ namespace papyrus {
 
           if (langName == lexerName) {
             scriptLangID = i;
-
-            // Update lexer's data as it needs to know if current file is lexed by it
-            if (lexerData) {
-              lexerData->scriptLangID = scriptLangID;
-            }
             break;
           }
         }
@@ -361,12 +457,286 @@ namespace papyrus {
     return std::pair<Game, bool>(detectedGameType, useAutoModeOutputDirectory);
   }
 
-  void Plugin::clearActiveCompilation() {
-    activeCompilationRequest = {
-      .game = Game::Auto,
-      .bufferID = 0 
+  bool Plugin::isCompiling(const std::wstring& filePath) const {
+    // A folder compilation compiles every script directly in the folder
+    std::wstring folder = (std::filesystem::path(utility::toUpper(filePath)).parent_path() / L"").wstring();
+    return std::any_of(activeCompilations.begin(), activeCompilations.end(),
+      [&](const CompilationRequest& request) {
+        return utility::compare(request.filePath, filePath)
+          || (request.compileFolder && (std::filesystem::path(utility::toUpper(request.filePath)) / L"").wstring() == folder);
+      }
+    );
+  }
+
+  void Plugin::finishCompilation(const CompilationRequest& request) {
+    auto iter = std::find_if(activeCompilations.begin(), activeCompilations.end(),
+      [&](const CompilationRequest& activeCompilation) {
+        return utility::compare(activeCompilation.filePath, request.filePath);
+      }
+    );
+    if (iter != activeCompilations.end()) {
+      activeCompilations.erase(iter);
+    }
+  }
+
+  void Plugin::recordJobErrors(const CompilationRequest& request, const std::vector<Error>& errors) {
+    if (request.compileFolder) {
+      std::wstring folder = (std::filesystem::path(utility::toUpper(request.filePath)) / L"").wstring();
+      std::erase_if(jobErrors,
+        [&](const std::pair<const std::wstring, std::vector<Error>>& entry) {
+          return (std::filesystem::path(entry.first).parent_path() / L"").wstring() == folder;
+        }
+      );
+    }
+
+    std::wstring key = utility::toUpper(request.filePath);
+    if (errors.empty()) {
+      jobErrors.erase(key);
+    } else {
+      jobErrors.insert_or_assign(key, errors);
+    }
+  }
+
+  void Plugin::showJobErrors() {
+    // Errors of a referenced script may be reported by many jobs
+    std::vector<Error> errors;
+    std::set<std::tuple<std::wstring, int, int, std::wstring>> reportedErrors;
+    for (const auto& [job, errorList] : jobErrors) {
+      for (const auto& error : errorList) {
+        if (reportedErrors.emplace(utility::toUpper(error.file), error.line, error.column, error.message).second) {
+          errors.push_back(error);
+        }
+      }
+    }
+
+    if (errorsWindow) {
+      errorsWindow->clear();
+      if (errors.empty()) {
+        errorsWindow->hide();
+      } else {
+        errorsWindow->show(errors);
+      }
+    }
+
+    if (errorAnnotator) {
+      errorAnnotator->clear();
+      if (!errors.empty()) {
+        errorAnnotator->annotate(errors);
+      }
+    }
+  }
+
+  bool Plugin::isCurrentFile(const std::wstring& filePath) const {
+    wchar_t currentFilePath[MAX_PATH];
+    return ::SendMessage(nppData._nppHandle, NPPM_GETFULLCURRENTPATH, MAX_PATH, reinterpret_cast<LPARAM>(currentFilePath)) && utility::compare(filePath, currentFilePath);
+  }
+
+  std::vector<std::pair<npp_buffer_t, std::wstring>> Plugin::getOpenScripts() {
+    if (scriptLangID == 0) {
+      detectLangID();
+    }
+
+    std::vector<std::pair<npp_buffer_t, std::wstring>> scripts;
+    for (npp_view_t view : {MAIN_VIEW, SUB_VIEW}) {
+      npp_index_t fileCount = static_cast<npp_index_t>(::SendMessage(nppData._nppHandle, NPPM_GETNBOPENFILES, 0, (view == MAIN_VIEW) ? PRIMARY_VIEW : SECOND_VIEW));
+      for (npp_index_t docIndex = 0; docIndex < fileCount; docIndex++) {
+        npp_buffer_t bufferID = static_cast<npp_buffer_t>(::SendMessage(nppData._nppHandle, NPPM_GETBUFFERIDFROMPOS, static_cast<WPARAM>(docIndex), static_cast<LPARAM>(view)));
+        wchar_t filePathArray[MAX_PATH];
+        if (bufferID != 0 && ::SendMessage(nppData._nppHandle, NPPM_GETFULLPATHFROMBUFFERID, static_cast<WPARAM>(bufferID), reinterpret_cast<LPARAM>(filePathArray)) != -1) {
+          std::wstring filePath(filePathArray);
+          npp_lang_type_t langID = static_cast<npp_lang_type_t>(::SendMessage(nppData._nppHandle, NPPM_GETBUFFERLANGTYPE, static_cast<WPARAM>(bufferID), 0));
+          if (utility::endsWith(filePath, L".psc") && (langID == scriptLangID || settings.compilerSettings.allowUnmanagedSource)) {
+            // A document cloned to both views is only listed once
+            bool isListed = std::any_of(scripts.begin(), scripts.end(),
+              [&](const std::pair<npp_buffer_t, std::wstring>& script) {
+                return utility::compare(script.second, filePath);
+              }
+            );
+            if (!isListed) {
+              scripts.push_back(std::make_pair(bufferID, filePath));
+            }
+          }
+        }
+      }
+    }
+
+    return scripts;
+  }
+
+  std::wstring Plugin::selectFolder() const {
+    std::wstring initialFolder;
+    wchar_t currentDirectory[MAX_PATH];
+    if (::SendMessage(nppData._nppHandle, NPPM_GETCURRENTDIRECTORY, MAX_PATH, reinterpret_cast<LPARAM>(currentDirectory))) {
+      initialFolder = currentDirectory;
+    }
+
+    BROWSEINFO browseInfo {
+      .hwndOwner = nppData._nppHandle,
+      .lpszTitle = L"Select the folder of Papyrus scripts to compile. Scripts in its subfolders are compiled as well.",
+      .ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE | BIF_NONEWFOLDERBUTTON,
+      .lpfn = [](HWND window, UINT message, LPARAM lParam, LPARAM data) -> int {
+        if (message == BFFM_INITIALIZED && data != 0) {
+          ::SendMessage(window, BFFM_SETSELECTION, TRUE, data);
+        }
+        return 0;
+      },
+      .lParam = initialFolder.empty() ? 0 : reinterpret_cast<LPARAM>(initialFolder.c_str())
     };
-    isComplingCurrentFile = false;
+
+    std::wstring folder;
+    PIDLIST_ABSOLUTE idList = ::SHBrowseForFolder(&browseInfo);
+    if (idList != nullptr) {
+      auto autoCleanupIdList = utility::finally([&] { ::CoTaskMemFree(idList); });
+      wchar_t folderPath[MAX_PATH];
+      if (::SHGetPathFromIDList(idList, folderPath)) {
+        folder = folderPath;
+      }
+    }
+
+    return folder;
+  }
+
+  void Plugin::addFolderRequests(const std::wstring& folder, std::vector<CompilationRequest>& requests) {
+    std::vector<std::wstring> scripts;
+    for (const auto& entry : std::filesystem::directory_iterator(folder)) {
+      if (entry.is_regular_file() && utility::endsWith(entry.path().filename(), L".psc")) {
+        scripts.push_back(entry.path());
+      }
+    }
+
+    if (!scripts.empty()) {
+      auto [detectedGame, useAutoModeOutputDirectory] = detectGameType(folder, settings.compilerSettings);
+      if (detectedGame != Game::Auto) {
+        // Let compiler compile the whole folder in one run with its "-all" flag. Fall back to compiling scripts one by one
+        // if some are being compiled already, so the same output file is not written by two compilations. Whether scripts are
+        // up to date is checked by compilation jobs, as it needs to scan them and their dependencies.
+        bool isCompilingAnyScript = std::any_of(scripts.begin(), scripts.end(), [&](const std::wstring& script) { return isCompiling(script); });
+        if (scripts.size() > 1 && !isCompilingAnyScript) {
+          requests.push_back(CompilationRequest {
+            .game = detectedGame,
+            .bufferID = 0,
+            .filePath { folder },
+            .useAutoModeOutputDirectory = useAutoModeOutputDirectory,
+            .compileFolder = true,
+            .isBatchJob = true,
+            .skipIfUpToDate = settings.compilerSettings.skipUpToDateScripts
+          });
+        } else {
+          for (const auto& script : scripts) {
+            if (!isCompiling(script)) {
+              requests.push_back(CompilationRequest {
+                .game = detectedGame,
+                .bufferID = 0,
+                .filePath { script },
+                .useAutoModeOutputDirectory = useAutoModeOutputDirectory,
+                .isBatchJob = true,
+                .skipIfUpToDate = settings.compilerSettings.skipUpToDateScripts
+              });
+            }
+          }
+        }
+      }
+    }
+  }
+
+  bool Plugin::canStartBatchCompilation() {
+    if (!compiler) {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Waiting for completing Papyrus settings..."));
+      return false;
+    }
+
+    if (batchCompilation) {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Batch compilation is in progress!"));
+      return false;
+    }
+
+    return true;
+  }
+
+  void Plugin::startBatchCompilation(std::vector<CompilationRequest> requests) {
+    if (requests.empty()) {
+      ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"No Papyrus script to compile!"));
+      return;
+    }
+
+    batchCompilation = std::make_unique<BatchCompilation>();
+    batchCompilation->waitingJobs.assign(std::make_move_iterator(requests.begin()), std::make_move_iterator(requests.end()));
+    batchCompilation->totalJobs = requests.size();
+    std::wstring msg(L"Batch compiling (" + std::to_wstring(requests.size()) + L" jobs)...");
+    ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+    submitBatchJobs();
+  }
+
+  void Plugin::submitBatchJobs() {
+    // Compiler's queue may not take all jobs at once. The rest are submitted when running ones are done.
+    auto& waitingJobs = batchCompilation->waitingJobs;
+    while (!waitingJobs.empty() && compiler->start(waitingJobs.front())) {
+      activeCompilations.push_back(waitingJobs.front());
+      waitingJobs.pop_front();
+      batchCompilation->runningJobs++;
+    }
+
+    if (!waitingJobs.empty() && batchCompilation->runningJobs == 0) {
+      // Compiler doesn't accept any job even though none of this batch is running
+      batchCompilation->failedJobs += waitingJobs.size();
+      batchCompilation->failureMessages.push_back(L"Can't start compilation of " + std::to_wstring(waitingJobs.size()) + L" jobs because too many scripts are being compiled!");
+      waitingJobs.clear();
+      showBatchResults();
+    }
+  }
+
+  void Plugin::finishBatchJob(const CompilationRequest& request, const CompilationErrors* compilationErrors, const std::wstring& failureMessage) {
+    finishCompilation(request);
+    if (!batchCompilation) {
+      return;
+    }
+
+    // Errors are only shown once all jobs of the batch are done
+    if (compilationErrors) {
+      batchCompilation->failedJobs++;
+      batchCompilation->hasUnparsableLines |= compilationErrors->hasUnparsableLines;
+      recordJobErrors(request, compilationErrors->errors);
+    } else if (!failureMessage.empty()) {
+      batchCompilation->failedJobs++;
+      batchCompilation->failureMessages.push_back(request.filePath + L": " + failureMessage);
+    } else {
+      recordJobErrors(request, std::vector<Error>());
+    }
+
+    batchCompilation->runningJobs--;
+    if (batchCompilation->waitingJobs.empty()) {
+      if (batchCompilation->runningJobs == 0) {
+        showBatchResults();
+      }
+    } else {
+      submitBatchJobs();
+    }
+  }
+
+  void Plugin::showBatchResults() {
+    // Take over the finished batch, so a new one can be started while message boxes are shown
+    std::unique_ptr<BatchCompilation> batch = std::move(batchCompilation);
+    showJobErrors();
+
+    std::wstring msg(L"Batch compilation ");
+    msg += (batch->failedJobs == 0) ? L"successful" : L"failed";
+    msg += L": " + std::to_wstring(batch->totalJobs - batch->failedJobs) + L" of " + std::to_wstring(batch->totalJobs) + L" jobs succeeded";
+    if (batch->upToDateJobs > 0) {
+      msg += (batch->upToDateJobs == batch->totalJobs) ? L" (all up to date)" : L", " + std::to_wstring(batch->upToDateJobs) + L" of them up to date";
+    }
+    ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+
+    if (!batch->failureMessages.empty()) {
+      std::wstring failures;
+      for (const auto& failureMessage : batch->failureMessages) {
+        failures += failureMessage + L"\r\n";
+      }
+      ::MessageBox(nppData._nppHandle, failures.c_str(), PLUGIN_NAME L" error", MB_ICONEXCLAMATION | MB_OK);
+    }
+
+    if (batch->hasUnparsableLines) {
+      ::MessageBox(nppData._nppHandle, L"There are unparsable compilation errors.", PLUGIN_NAME L" error", MB_ICONEXCLAMATION | MB_OK);
+    }
   }
 
   LRESULT CALLBACK Plugin::messageHandleProc(HWND window, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -375,76 +745,120 @@ namespace papyrus {
 
   LRESULT Plugin::handleOwnMessage(HWND window, UINT message, WPARAM wParam, LPARAM lParam) {
     switch (message) {
+      // Compiler messages are sent by each compilation job along with its request
       case PPM_COMPILATION_DONE: {
-        if (errorsWindow) {
-          errorsWindow->clear();
-          errorsWindow->hide();
+        const CompilationRequest& request = *reinterpret_cast<const CompilationRequest*>(wParam);
+        if (request.isBatchJob) {
+          if (batchCompilation && lParam == PARAM_COMPILATION_UP_TO_DATE) {
+            batchCompilation->upToDateJobs++;
+          }
+          finishBatchJob(request, nullptr, std::wstring());
+          return 0;
         }
 
-        std::wstring msg(L"Compilation ");
-        if (wParam == PARAM_COMPILATION_WITH_ANONYMIZATION) {
-          msg += L"and anonymization ";
+        recordJobErrors(request, std::vector<Error>());
+        showJobErrors();
+
+        std::wstring msg;
+        if (lParam == PARAM_COMPILATION_UP_TO_DATE) {
+          msg = L"Script is up to date";
+        } else {
+          msg = L"Compilation ";
+          if (lParam == PARAM_COMPILATION_WITH_ANONYMIZATION) {
+            msg += L"and anonymization ";
+          }
+          msg += L"successful";
+          if (lParam == PARAM_COMPILATION_FROM_CACHE) {
+            msg += L" (restored from cache)";
+          }
         }
-        msg += L"successful";
-        if (!isComplingCurrentFile) {
-          msg += L": " + activeCompilationRequest.filePath;
+        if (!isCurrentFile(request.filePath)) {
+          msg += L": " + request.filePath;
         }
         ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
-        clearActiveCompilation();
+        finishCompilation(request);
         return 0;
       }
 
       case PPM_COMPILATION_FAILED: {
-        if (errorsWindow) {
-          errorsWindow->clear();
-          if (wParam) {
-            std::vector<Error>* errors = reinterpret_cast<std::vector<Error>*>(wParam);
-
-            errorsWindow->show(*errors);
-
-            if (errorAnnotator) {
-              errorAnnotator->annotate(*errors);
-            }
-          }
+        const CompilationRequest& request = *reinterpret_cast<const CompilationRequest*>(wParam);
+        const CompilationErrors& compilationErrors = *reinterpret_cast<const CompilationErrors*>(lParam);
+        if (request.isBatchJob) {
+          finishBatchJob(request, &compilationErrors, std::wstring());
+          return 0;
         }
 
+        recordJobErrors(request, compilationErrors.errors);
+        showJobErrors();
+
         std::wstring msg(L"Compilation failed");
-        if (!isComplingCurrentFile) {
-          msg += L": " + activeCompilationRequest.filePath;
+        if (!isCurrentFile(request.filePath)) {
+          msg += L": " + request.filePath;
         }
         ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
-        clearActiveCompilation();
+        finishCompilation(request);
 
-        if (lParam) {
+        if (compilationErrors.hasUnparsableLines) {
           ::MessageBox(nppData._nppHandle, L"There are unparsable compilation errors.", PLUGIN_NAME L" error", MB_ICONEXCLAMATION | MB_OK);
         }
         return 0;
       }
 
+      case PPM_COMPILATION_PROGRESS: {
+        // Errors are added to those of the job reporting them, which are replaced once it's done. Errors of a batch job are
+        // only shown along with results of the whole batch.
+        const CompilationRequest& request = *reinterpret_cast<const CompilationRequest*>(wParam);
+        const std::vector<Error>& newErrors = *reinterpret_cast<const std::vector<Error>*>(lParam);
+        if (!request.isBatchJob && !newErrors.empty()) {
+          auto& errors = jobErrors[utility::toUpper(request.filePath)];
+          errors.insert(errors.end(), newErrors.begin(), newErrors.end());
+          showJobErrors();
+        }
+        return 0;
+      }
+
       case PPM_COMPILER_NOT_FOUND: {
-        clearActiveCompilation();
+        const CompilationRequest& request = *reinterpret_cast<const CompilationRequest*>(wParam);
+        if (request.isBatchJob) {
+          finishBatchJob(request, nullptr, L"Can't find the compiler executable");
+          return 0;
+        }
+
+        finishCompilation(request);
         ::MessageBox(nppData._nppHandle, L"Can't find the compiler executable", PLUGIN_NAME L" error", MB_ICONEXCLAMATION | MB_OK);
         return 0;
       }
 
       case PPM_ANONYMIZATION_FAILED: {
-        if (errorsWindow) {
-          errorsWindow->clear();
+        const CompilationRequest& request = *reinterpret_cast<const CompilationRequest*>(wParam);
+        if (request.isBatchJob) {
+          finishBatchJob(request, nullptr, L"Compilation successful but anonymization failed: " + std::wstring(reinterpret_cast<const wchar_t*>(lParam)));
+          return 0;
         }
 
+        recordJobErrors(request, std::vector<Error>());
+        showJobErrors();
+
         std::wstring msg(L"Compilation successful but anonymization failed: ");
-        msg += reinterpret_cast<const wchar_t*>(wParam);
-        if (!isComplingCurrentFile) {
-          msg += L" File: " + activeCompilationRequest.filePath;
+        msg += reinterpret_cast<const wchar_t*>(lParam);
+        if (!isCurrentFile(request.filePath)) {
+          msg += L" File: " + request.filePath;
         }
         ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
-        clearActiveCompilation();
+        finishCompilation(request);
         return 0;
       }
 
       case PPM_OTHER_ERROR: {
-        clearActiveCompilation();
-        ::MessageBox(nppData._nppHandle, reinterpret_cast<wchar_t*>(wParam), reinterpret_cast<wchar_t*>(lParam), MB_ICONEXCLAMATION | MB_OK);
+        const CompilationRequest& request = *reinterpret_cast<const CompilationRequest*>(wParam);
+        const CompilerError& error = *reinterpret_cast<const CompilerError*>(lParam);
+        if (request.isBatchJob) {
+          finishBatchJob(request, nullptr, error.title + L" " + error.message);
+          return 0;
+        }
+
+        finishCompilation(request);
+        ::MessageBox(nppData._nppHandle, error.message.c_str(), error.title.c_str(), MB_ICONEXCLAMATION | MB_OK);
         return 0;
       }
 
@@ -463,6 +877,16 @@ namespace papyrus {
         return 0;
       }
 
+      case PPM_CLASS_NAMES_UPDATED: {
+        requestRestyle(Lexer::UnresolvedNames);
+        return 0;
+      }
+
+      case PPM_RESTYLE_DOCUMENTS: {
+        restyleDocuments();
+        return 0;
+      }
+
       default: {
         return DefWindowProc(window, message, wParam, lParam);
       }
@@ -547,6 +971,56 @@ namespace papyrus {
     }
   }
 
+  void Plugin::showLexerStatistics() {
+    npp_view_t currentView = static_cast<npp_view_t>(::SendMessage(nppData._nppHandle, NPPM_GETCURRENTVIEW, 0, 0));
+    HWND handle = (currentView == MAIN_VIEW) ? nppData._scintillaMainHandle : nppData._scintillaSecondHandle;
+    if (::SendMessage(handle, SCI_GETLEXER, 0, 0) == SCLEX_PAPYRUS_SCRIPT) {
+      Lexer::Statistics statistics {};
+      ::SendMessage(handle, SCI_PRIVATELEXERCALL, PAPYRUS_LEXER_CALL_GET_STATISTICS, reinterpret_cast<LPARAM>(&statistics));
+      std::wstring msg(L"Lexer statistics of current document are listed below\r\n\r\n");
+      msg += L"Token cache hits: " + std::to_wstring(statistics.tokenCacheHits) + L"\r\n";
+      msg += L"Token cache misses: " + std::to_wstring(statistics.tokenCacheMisses) + L"\r\n";
+      msg += L"Tokens scanned: " + std::to_wstring(statistics.tokensScanned) + L"\r\n\r\n";
+      auto formatTiming = [](const wchar_t* title, const Lexer::Timing& timing) {
+        std::wstring text = std::wstring(title) + L": " + std::to_wstring(timing.calls) + L" calls, " + std::to_wstring(timing.lines) + L" lines, ";
+        text += std::to_wstring(timing.totalTime) + L" \u00B5s total, " + std::to_wstring(timing.maxTime) + L" \u00B5s max";
+        if (timing.lines > 0) {
+          text += L", " + std::to_wstring(static_cast<double>(timing.totalTime) / 1000 / timing.lines * 10000) + L" ms per 10k lines";
+        }
+        return text;
+      };
+      msg += formatTiming(L"Lex", statistics.lexTiming) + L"\r\n";
+      msg += formatTiming(L"Fold", statistics.foldTiming) + L"\r\n\r\n";
+      msg += L"Style runs written: " + std::to_wstring(statistics.styleRuns) + L"\r\n";
+      msg += L"Lex calls prepared in parallel: " + std::to_wstring(statistics.parallelLexCalls);
+      ClassResolver::CacheUsage cacheUsage = lexerData->classResolver.cacheUsage(lexerData->currentGame);
+      if (cacheUsage.names > 0) {
+        msg += L"\r\nClass name cache: " + std::to_wstring(cacheUsage.names) + L" names, " + std::to_wstring(cacheUsage.memoryUsage / 1024) + L" KB";
+      }
+      ::MessageBox(nppData._nppHandle, msg.c_str(), PLUGIN_NAME L" Plugin", MB_ICONINFORMATION | MB_OK);
+    } else {
+      ::MessageBox(nppData._nppHandle, L"Current document is not using Papyrus Script lexer!", PLUGIN_NAME L" Plugin", MB_ICONEXCLAMATION | MB_OK);
+    }
+  }
+
+  void Plugin::showCompilationCacheStatistics() {
+    if (compiler) {
+      OutputCache::Statistics statistics = compiler->outputCacheStatistics();
+      std::wstring msg(L"Compilation cache statistics of this session are listed below\r\n\r\n");
+      msg += L"Hits: " + std::to_wstring(statistics.hits) + L" scripts\r\n";
+      msg += L"Misses: " + std::to_wstring(statistics.misses) + L" scripts\r\n";
+      if (statistics.hits + statistics.misses > 0) {
+        msg += L"Hit rate: " + std::to_wstring(statistics.hits * 100 / (statistics.hits + statistics.misses)) + L"%\r\n";
+      }
+      msg += L"Stored: " + std::to_wstring(statistics.stores) + L" files\r\n";
+      msg += L"Evicted: " + std::to_wstring(statistics.evictions) + L" files\r\n\r\n";
+      msg += L"Cached: " + std::to_wstring(statistics.entries) + L" files, " + std::to_wstring(statistics.totalSize / 1024) + L" KB";
+      ::MessageBox(nppData._nppHandle, msg.c_str(), PLUGIN_NAME L" Plugin", MB_ICONINFORMATION | MB_OK);
+    } else {
+      ::MessageBox(nppData._nppHandle, L"Waiting for completing Papyrus settings...", PLUGIN_NAME L" Plugin", MB_ICONEXCLAMATION | MB_OK);
+    }
+  }
+
   void Plugin::addAutoCompletion() {
     // Get Notepad++'s plugin home path
     npp_size_t homePathLength = static_cast<npp_size_t>(::SendMessage(nppData._nppHandle, NPPM_GETPLUGINHOMEPATH, 0, 0));
@@ -645,66 +1119,124 @@ namespace papyrus {
 
   void Plugin::compile() {
     if (compiler) {
-      if (activeCompilationRequest.bufferID == 0) {
-        // Get current file path.
-        wchar_t filePath[MAX_PATH];
-        if (::SendMessage(nppData._nppHandle, NPPM_GETFULLCURRENTPATH, MAX_PATH, reinterpret_cast<LPARAM>(filePath))) {
-          // Check if current file is handled by Papyrus Script lexer
-          if (scriptLangID == 0) {
-            detectLangID();
-          }
-          npp_lang_type_t currentFileLangID;
-          ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTLANGTYPE, 0, reinterpret_cast<LPARAM>(&currentFileLangID));
-
-          // Check file extension to make sure it is ".psc", and is lexed by this plugin's lexer or compiling unmanaged files is allowed
-          std::wstring currentFile(filePath);
-          if (utility::endsWith(currentFile, L".psc") && (currentFileLangID == scriptLangID || settings.compilerSettings.allowUnmanagedSource)) {
-            auto [detectedGame, useAutoModeOutputDirectory] = detectGameType(filePath, settings.compilerSettings);
-            if (detectedGame != Game::Auto) {
-              if (errorsWindow) {
-                errorsWindow->clear();
-                errorsWindow->hide();
-              }
-
-              if (errorAnnotator) {
-                errorAnnotator->clear();
-              }
+      // Get current file path.
+      wchar_t filePath[MAX_PATH];
+      if (::SendMessage(nppData._nppHandle, NPPM_GETFULLCURRENTPATH, MAX_PATH, reinterpret_cast<LPARAM>(filePath))) {
+        // Check if current file is handled by Papyrus Script lexer
+        if (scriptLangID == 0) {
+          detectLangID();
+        }
+        npp_lang_type_t currentFileLangID;
+        ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTLANGTYPE, 0, reinterpret_cast<LPARAM>(&currentFileLangID));
 
-              activeCompilationRequest = {
-                .game = detectedGame,
-                .bufferID = ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0),
-                .filePath { currentFile },
-                .useAutoModeOutputDirectory = useAutoModeOutputDirectory
-              };
-              isComplingCurrentFile = true;
+        // Check file extension to make sure it is ".psc", and is lexed by this plugin's lexer or compiling unmanaged files is allowed
+        std::wstring currentFile(filePath);
+        if (isCompiling(currentFile)) {
+          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Already compiling!"));
+        } else if (utility::endsWith(currentFile, L".psc") && (currentFileLangID == scriptLangID || settings.compilerSettings.allowUnmanagedSource)) {
+          auto [detectedGame, useAutoModeOutputDirectory] = detectGameType(filePath, settings.compilerSettings);
+          if (detectedGame != Game::Auto) {
+            CompilationRequest request {
+              .game = detectedGame,
+              .bufferID = ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0),
+              .filePath { currentFile },
+              .useAutoModeOutputDirectory = useAutoModeOutputDirectory,
+              .skipIfUpToDate = settings.compilerSettings.skipUpToDateScripts
+            };
+
+            // Errors of other scripts that are being compiled or have been compiled are still shown
+            recordJobErrors(request, std::vector<Error>());
+            showJobErrors();
+            ::SendMessage(nppData._nppHandle, NPPM_SAVECURRENTFILE, 0, 0);
+
+            // Other scripts may be compiled at the same time, each reporting its own completion
+            if (compiler->start(request)) {
+              activeCompilations.push_back(request);
               ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Compiling..."));
-              ::SendMessage(nppData._nppHandle, NPPM_SAVECURRENTFILE, 0, 0);
-
-              compiler->start(activeCompilationRequest);
             } else {
-              ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Cannot start compilation because no game is configured. Please at least enable one game in Settings dialog!"));
+              ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Can't start compilation because too many scripts are being compiled!"));
             }
           } else {
-            ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"File is not a Papyrus script processed by this lexer!"));
+            ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Cannot start compilation because no game is configured. Please at least enable one game in Settings dialog!"));
           }
         } else {
-          std::wstring errorMsg(L"Can't start compilation due to file path exceeding ");
-          errorMsg += MAX_PATH + L" chars";
-          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(errorMsg.c_str()));
+          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"File is not a Papyrus script processed by this lexer!"));
         }
       } else {
-        if (activeCompilationRequest.bufferID == ::SendMessage(nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0)) {
-          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Already compiling!"));
-        } else {
-          std::wstring errorMsg(L"Can't start compilation due to active compilation of " + activeCompilationRequest.filePath);
-          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(errorMsg.c_str()));
-        }
+        std::wstring errorMsg(L"Can't start compilation due to file path exceeding ");
+        errorMsg += MAX_PATH + L" chars";
+        ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(errorMsg.c_str()));
       }
     } else {
       ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(L"Waiting for completing Papyrus settings..."));
     }
   }
 
+  void Plugin::compileOpenScriptsMenuFunc() {
+    papyrusPlugin.compileOpenScripts();
+  }
+
+  void Plugin::compileOpenScripts() {
+    if (canStartBatchCompilation()) {
+      std::vector<CompilationRequest> requests;
+      for (const auto& [bufferID, filePath] : getOpenScripts()) {
+        // Scripts being compiled on their own are skipped
+        if (!isCompiling(filePath)) {
+          auto [detectedGame, useAutoModeOutputDirectory] = detectGameType(filePath, settings.compilerSettings);
+          if (detectedGame != Game::Auto) {
+            ::SendMessage(nppData._nppHandle, NPPM_SAVEFILE, 0, reinterpret_cast<LPARAM>(filePath.c_str()));
+
+            // Compiler's "-all" flag would compile every script in a folder, not just open ones, so each script is a separate job
+            requests.push_back(CompilationRequest {
+              .game = detectedGame,
+              .bufferID = bufferID,
+              .filePath { filePath },
+              .useAutoModeOutputDirectory = useAutoModeOutputDirectory,
+              .isBatchJob = true,
+              .skipIfUpToDate = settings.compilerSettings.skipUpToDateScripts
+            });
+          }
+        }
+      }
+      startBatchCompilation(std::move(requests));
+    }
+  }
+
+  void Plugin::compileFolderMenuFunc() {
+    papyrusPlugin.compileFolder();
+  }
+
+  void Plugin::compileFolder() {
+    if (canStartBatchCompilation()) {
+      std::wstring folder = selectFolder();
+      if (!folder.empty()) {
+        // Save open scripts under selected folder so their latest changes are compiled
+        std::filesystem::path folderPath(folder);
+        for (const auto& [bufferID, filePath] : getOpenScripts()) {
+          if (utility::startsWith(filePath, (folderPath / L"").wstring())) {
+            ::SendMessage(nppData._nppHandle, NPPM_SAVEFILE, 0, reinterpret_cast<LPARAM>(filePath.c_str()));
+          }
+        }
+
+        // Scripts directly in each folder are compiled together
+        std::vector<CompilationRequest> requests;
+        try {
+          addFolderRequests(folder, requests);
+          for (const auto& entry : std::filesystem::recursive_directory_iterator(folder, std::filesystem::directory_options::skip_permission_denied)) {
+            if (entry.is_directory()) {
+              addFolderRequests(entry.path(), requests);
+            }
+          }
+        } catch (...) {
+          std::wstring msg(L"Can't start compilation because folder " + folder + L" can't be read!");
+          ::SendMessage(nppData._nppHandle, NPPM_SETSTATUSBAR, STATUSBAR_DOC_TYPE, reinterpret_cast<LPARAM>(msg.c_str()));
+          return;
+        }
+        startBatchCompilation(std::move(requests));
+      }
+    }
+  }
+
   void Plugin::settingsMenuFunc() {
     papyrusPlugin.showSettings();
   }
@@ -35,6 +35,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "..\external\npp\PluginInterface.h"
 
+#include <cstdint>
+#include <deque>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -64,6 +67,8 @@ namespace papyrus {
     private:
       enum class Menu {
         Compile,
+        CompileOpenScripts,
+        CompileFolder,
         Options,
         Seperator1,
         Advanced,
@@ -75,7 +80,20 @@ namespace papyrus {
       enum class AdvancedMenu {
         ShowLangID,
         AddAutoCompletion,
-        AddFunctionList
+        AddFunctionList,
+        ShowLexerStatistics,
+        ShowCompilationCacheStatistics
+      };
+
+      // Batch compilation of several scripts, whose results are shown together once all of its jobs are done
+      struct BatchCompilation {
+        std::deque<CompilationRequest> waitingJobs; // Not yet accepted by compiler
+        size_t runningJobs {};
+        size_t totalJobs {};
+        size_t failedJobs {};
+        size_t upToDateJobs {};
+        std::vector<std::wstring> failureMessages; // Failures other than compilation errors
+        bool hasUnparsableLines {};
       };
 
       void initializeComponents();
@@ -90,15 +108,61 @@ namespace papyrus {
       void onSettingsUpdated();
       void updateLexerDataGameSettings(Game game, const CompilerSettings::GameSettings& gameSettings);
 
+      // Request documents shown in both views to be restyled for given reasons (Lexer::RestyleReason). Requests made before
+      // they are handled are coalesced.
+      void requestRestyle(uint32_t reasons);
+
+      // Handle pending restyle requests for documents shown in both views
+      void restyleDocuments();
+
+      // Restyle lines of document shown in the given view that need to be restyled for given reasons, which includes Lex and
+      // Fold. The whole document is restyled if it has been styled with an outdated class index.
+      void restyleDocument(HWND handle, uint32_t reasons);
+
       // Find out langID assigned to Papyrus Script lexer
       void detectLangID();
 
       // Find out game type based on file path and settings
       std::pair<Game, bool> detectGameType(const std::wstring& filePath, const CompilerSettings& compilerSettings);
 
-      // Clear cached active compilation request, so when buffer gets switched
-      // in NPP it can be properly handled
-      void clearActiveCompilation();
+      // Check if the given file is being compiled, or queued to be compiled, either by itself or along with its folder
+      bool isCompiling(const std::wstring& filePath) const;
+
+      // Remove a compilation request that has completed from active compilations
+      void finishCompilation(const CompilationRequest& request);
+
+      // Record errors reported by a compilation job, replacing those it reported last time. Errors of other jobs are kept,
+      // except those of scripts a folder job has compiled again.
+      void recordJobErrors(const CompilationRequest& request, const std::vector<Error>& errors);
+
+      // Show errors of all compilation jobs in errors window, and annotate them
+      void showJobErrors();
+
+      // Check if the given file is the one currently shown in Notepad++
+      bool isCurrentFile(const std::wstring& filePath) const;
+
+      // Get open Papyrus scripts in both views that can be compiled, along with their buffer IDs
+      std::vector<std::pair<npp_buffer_t, std::wstring>> getOpenScripts();
+
+      // Let user select a folder, starting from the one containing current file. Returns empty string if canceled.
+      std::wstring selectFolder() const;
+
+      // Add requests to compile scripts directly in the given folder
+      void addFolderRequests(const std::wstring& folder, std::vector<CompilationRequest>& requests);
+
+      // Check if a new batch compilation can be started, showing the reason on status bar if not
+      bool canStartBatchCompilation();
+
+      // Start a batch compilation with the given requests. Jobs skipped being up to date are reported along with results.
+      void startBatchCompilation(std::vector<CompilationRequest> requests);
+
+      // Pass waiting jobs of current batch compilation to compiler as long as it accepts them
+      void submitBatchJobs();
+
+      // Record the result of a batch compilation job, which is either compilation errors or another failure message,
+      // or neither if it succeeded. Results are shown when all jobs of the batch are done.
+      void finishBatchJob(const CompilationRequest& request, const CompilationErrors* compilationErrors, const std::wstring& failureMessage);
+      void showBatchResults();
 
       // Plugin's own message handling
       static LRESULT CALLBACK messageHandleProc(HWND window, UINT message, WPARAM wparam, LPARAM lparam);
@@ -116,9 +180,15 @@ namespace papyrus {
       void showLangID();
       void addAutoCompletion();
       void addFunctionList();
+      void showLexerStatistics();
+      void showCompilationCacheStatistics();
 
       static void compileMenuFunc();
       void compile();
+      static void compileOpenScriptsMenuFunc();
+      void compileOpenScripts();
+      static void compileFolderMenuFunc();
+      void compileFolder();
       static void settingsMenuFunc();
       void showSettings();
       static void aboutMenuFunc();
@@ -140,8 +210,9 @@ namespace papyrus {
       SettingsDialog settingsDialog {settings};
 
       std::unique_ptr<Compiler> compiler;
-      CompilationRequest activeCompilationRequest;
-      bool isComplingCurrentFile {false};
+      std::list<CompilationRequest> activeCompilations; // In the order they were requested
+      std::unique_ptr<BatchCompilation> batchCompilation;
+      std::map<std::wstring, std::vector<Error>> jobErrors; // Keyed by upper case script or folder path of compilation job
 
       std::unique_ptr<ErrorAnnotator> errorAnnotator;
       std::unique_ptr<ErrorsWindow> errorsWindow;
@@ -150,6 +221,8 @@ namespace papyrus {
 
       npp_lang_type_t scriptLangID {0};
 
+      uint32_t pendingRestyleReasons {0};
+
       AboutDialog aboutDialog;
   };
 
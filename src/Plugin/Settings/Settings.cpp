@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "..\Common\EnumUtil.hpp"
 #include "..\Common\Utility.hpp"
 #include "..\CompilationErrorHandling\ErrorAnnotator.hpp"
+#include "..\Lexer\ClassNameCache.hpp"
 
 #include <fstream>
 
@@ -46,6 +47,7 @@ namespace papyrus {
   void Settings::saveSettings(SettingsStorage& storage) {
     storage.putString(L"lexer.enableFoldMiddle", utility::boolToStr(lexerSettings.enableFoldMiddle));
     storage.putString(L"lexer.enableClassNameCache", utility::boolToStr(lexerSettings.enableClassNameCache));
+    storage.putString(L"lexer.classNameCacheSize", std::to_wstring(lexerSettings.classNameCacheSize));
 
     storage.putString(L"errorAnnotator.enableAnnotation", utility::boolToStr(errorAnnotatorSettings.enableAnnotation));
     storage.putString(L"errorAnnotator.annotationForegroundColor", utility::colorToHexStr(errorAnnotatorSettings.annotationForegroundColor));
@@ -58,6 +60,7 @@ namespace papyrus {
     storage.putString(L"errorAnnotator.indicatorForegroundColor", utility::colorToHexStr(errorAnnotatorSettings.indicatorForegroundColor));
 
     storage.putString(L"compiler.common.allowUnmanagedSource", utility::boolToStr(compilerSettings.allowUnmanagedSource));
+    storage.putString(L"compiler.common.skipUpToDateScripts", utility::boolToStr(compilerSettings.skipUpToDateScripts));
     storage.putString(L"compiler.common.gameMode", game::gameNames[utility::underlying(compilerSettings.gameMode)].first);
     storage.putString(L"compiler.auto.defaultGame", game::gameNames[utility::underlying(compilerSettings.autoModeDefaultGame)].first);
     storage.putString(L"compiler.auto.outputDirectory", compilerSettings.autoModeOutputDirectory);
@@ -91,6 +94,13 @@ namespace papyrus {
       updated = true;
     }
 
+    if (storage.getString(L"lexer.classNameCacheSize", value)) {
+      lexerSettings.classNameCacheSize = std::stoi(value);
+    } else {
+      lexerSettings.classNameCacheSize = DEFAULT_CLASS_NAME_CACHE_SIZE;
+      updated = true;
+    }
+
     // Error annotator settings
     //
     if (storage.getString(L"errorAnnotator.enableAnnotation", value)) {
@@ -179,6 +189,13 @@ namespace papyrus {
       updated = true;
     }
 
+    if (storage.getString(L"compiler.common.skipUpToDateScripts", value)) {
+      compilerSettings.skipUpToDateScripts = utility::strToBool(value);
+    } else {
+      compilerSettings.skipUpToDateScripts = true;
+      updated = true;
+    }
+
     if (storage.getString(L"compiler.common.gameMode", value)) {
       auto iter = game::gameAliases.find(value);
       if (iter != game::gameAliases.end()) {
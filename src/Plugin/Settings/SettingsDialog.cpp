@@ -80,6 +80,7 @@ namespace papyrus {
     //
     setChecked(IDC_SETTINGS_LEXER_FOLDMIDDLE, settings.lexerSettings.enableFoldMiddle);
     setChecked(IDC_SETTINGS_LEXER_CLASSNAMECACHING, settings.lexerSettings.enableClassNameCache);
+    setText(IDC_SETTINGS_LEXER_CLASSNAMECACHE_SIZE, std::to_wstring(settings.lexerSettings.classNameCacheSize));
 
     // Error annotator settings
     //
@@ -115,6 +116,7 @@ namespace papyrus {
     // Compiler settings
     //
     setChecked(IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE, settings.compilerSettings.allowUnmanagedSource);
+    setChecked(IDC_SETTINGS_COMPILER_SKIP_UP_TO_DATE_SCRIPTS, settings.compilerSettings.skipUpToDateScripts);
     setChecked(IDC_SETTINGS_COMPILER_RADIO_AUTO + utility::underlying(settings.compilerSettings.gameMode), true);
     setText(IDC_SETTINGS_COMPILER_AUTO_DEFAULT_OUTPUT, settings.compilerSettings.autoModeOutputDirectory);
     updateAutoModeDefaultGame();
@@ -301,6 +303,8 @@ namespace papyrus {
         setControlVisibility(IDC_SETTINGS_LEXER_SCRIPT_GROUP, show);
         setControlVisibility(IDC_SETTINGS_LEXER_FOLDMIDDLE, show);
         setControlVisibility(IDC_SETTINGS_LEXER_CLASSNAMECACHING, show);
+        setControlVisibility(IDC_SETTINGS_LEXER_CLASSNAMECACHE_SIZE_LABEL, show);
+        setControlVisibility(IDC_SETTINGS_LEXER_CLASSNAMECACHE_SIZE, show);
         break;
       }
 
@@ -354,6 +358,7 @@ namespace papyrus {
         setControlVisibility(IDC_SETTINGS_COMPILER_FO4_TOGGLE, show);
         setControlVisibility(IDC_SETTINGS_COMPILER_FO4_CONFIGURE, show);
         setControlVisibility(IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE, show);
+        setControlVisibility(IDC_SETTINGS_COMPILER_SKIP_UP_TO_DATE_SCRIPTS, show);
         break;
       }
 
@@ -616,10 +621,20 @@ namespace papyrus {
       return false;
     }
 
+    std::wstring classNameCacheSizeStr = getText(IDC_SETTINGS_LEXER_CLASSNAMECACHE_SIZE);
+    int classNameCacheSize {};
+    std::wistringstream(classNameCacheSizeStr) >> classNameCacheSize;
+    if (!utility::isNumber(classNameCacheSizeStr) || classNameCacheSize < 16 || classNameCacheSize > 65536) {
+      ::MessageBox(getHSelf(), L"Class names cache size needs to be a number between 16 and 65536", L"Invalid setting", MB_ICONEXCLAMATION | MB_OK);
+      return false;
+    }
+
     settings.errorAnnotatorSettings.indicatorID = indicatorID;
+    settings.lexerSettings.classNameCacheSize = classNameCacheSize;
 
     settings.lexerSettings.enableClassNameCache = getChecked(IDC_SETTINGS_LEXER_CLASSNAMECACHING);
     settings.compilerSettings.allowUnmanagedSource = getChecked(IDC_SETTINGS_COMPILER_ALLOW_UNMANAGED_SOURCE);
+    settings.compilerSettings.skipUpToDateScripts = getChecked(IDC_SETTINGS_COMPILER_SKIP_UP_TO_DATE_SCRIPTS);
     settings.compilerSettings.autoModeOutputDirectory = getText(IDC_SETTINGS_COMPILER_AUTO_DEFAULT_OUTPUT);
     settings.compilerSettings.autoModeDefaultGame = game::games[getText(IDC_SETTINGS_COMPILER_AUTO_DEFAULT_GAME_DROPDOWN)];
 
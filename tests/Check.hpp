@@ -0,0 +1,86 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// Minimal test framework, so tests don't need anything beyond the standard library. Each test executable registers its
+// test cases with TEST_CASE, and runs them from main() with papyrus::test::runTests().
+namespace papyrus::test {
+
+  struct TestCase {
+    const char* name;
+    void (*function)();
+  };
+
+  inline std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+  }
+
+  inline int& failureCount() {
+    static int count = 0;
+    return count;
+  }
+
+  struct Registration {
+    Registration(const char* name, void (*function)()) {
+      testCases().push_back({name, function});
+    }
+  };
+
+  inline void fail(const char* file, int line, const char* expression) {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    failureCount()++;
+  }
+
+  // Run all registered test cases. Returns exit code of test executable.
+  inline int runTests() {
+    int failedCases = 0;
+    for (const auto& testCase : testCases()) {
+      int failuresBefore = failureCount();
+      testCase.function();
+      bool passed = (failureCount() == failuresBefore);
+      std::printf("[%s] %s\n", passed ? "PASS" : "FAIL", testCase.name);
+      if (!passed) {
+        failedCases++;
+      }
+    }
+    std::printf("%d of %zu test cases failed\n", failedCases, testCases().size());
+    return (failedCases == 0) ? 0 : 1;
+  }
+
+} // namespace
+
+#define TEST_CASE(name) \
+  static void name(); \
+  static papyrus::test::Registration name##Registration(#name, name); \
+  static void name()
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      papyrus::test::fail(__FILE__, __LINE__, #condition); \
+    } \
+  } while (false)
+
+#define CHECK_EQUAL(expected, actual) CHECK((expected) == (actual))
@@ -0,0 +1,128 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Check.hpp"
+
+#include "Plugin/Compiler/ChildProcess.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace papyrus;
+
+namespace {
+  std::wstring stubCommand(const std::wstring& arguments) {
+    return L"\"" + std::filesystem::path(STUB_COMPILER_PATH).wstring() + L"\" " + arguments;
+  }
+
+  // Lines collected from both pipes of a child process
+  struct Output {
+    std::mutex mutex;
+    std::vector<std::string> outputLines;
+    std::vector<std::string> errorLines;
+
+    PipeReader::lines_callback_t outputCallback() {
+      return [this](const std::vector<std::string>& lines) {
+        std::lock_guard lock(mutex);
+        outputLines.insert(outputLines.end(), lines.begin(), lines.end());
+      };
+    }
+
+    PipeReader::lines_callback_t errorCallback() {
+      return [this](const std::vector<std::string>& lines) {
+        std::lock_guard lock(mutex);
+        errorLines.insert(errorLines.end(), lines.begin(), lines.end());
+      };
+    }
+  };
+}
+
+TEST_CASE(drainsBothPipesBeyondBufferSize) {
+  Output output;
+  ChildProcess process(stubCommand(L"flood 20000"), output.outputCallback(), output.errorCallback());
+  auto result = process.run();
+  CHECK(result.status == ChildProcess::Status::Exited);
+  CHECK_EQUAL(0u, result.exitCode);
+  CHECK_EQUAL(20000u, output.outputLines.size());
+  CHECK_EQUAL(20000u, output.errorLines.size());
+  CHECK(result.outputBytes > 65536);
+  CHECK(result.errorBytes > 65536);
+  CHECK_EQUAL(std::string("Compiling line 19999 of a very chatty compiler run"), output.outputLines.back());
+  CHECK_EQUAL(std::string("C:\\Scripts\\Flood.psc(1,1): error 0"), output.errorLines.front());
+}
+
+TEST_CASE(streamsErrorLinesWhileRunning) {
+  // Stub only exits successfully once it sees the file created on its first error line, which can only happen if lines
+  // are handled while it's still running
+  std::filesystem::path handshakeFile = std::filesystem::temp_directory_path() / "PapyrusChildProcessTest.handshake";
+  std::filesystem::remove(handshakeFile);
+  Output output;
+  ChildProcess process(stubCommand(L"handshake \"" + handshakeFile.wstring() + L"\""), output.outputCallback(),
+    [&](const std::vector<std::string>& lines) {
+      output.errorCallback()(lines);
+      std::ofstream(handshakeFile).put('\n');
+    }
+  );
+  auto result = process.run();
+  CHECK(result.status == ChildProcess::Status::Exited);
+  CHECK_EQUAL(0u, result.exitCode);
+  CHECK_EQUAL(1u, output.errorLines.size());
+  std::filesystem::remove(handshakeFile);
+}
+
+TEST_CASE(reportsExitCode) {
+  Output output;
+  ChildProcess process(stubCommand(L"exit 7"), output.outputCallback(), output.errorCallback());
+  auto result = process.run();
+  CHECK(result.status == ChildProcess::Status::Exited);
+  CHECK_EQUAL(7u, result.exitCode);
+  CHECK_EQUAL(0u, result.errorBytes);
+}
+
+TEST_CASE(terminatesRunningProcess) {
+  Output output;
+  ChildProcess process(stubCommand(L"hang"), output.outputCallback(), output.errorCallback());
+  std::thread terminator([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    process.terminate();
+  });
+  auto startTime = std::chrono::steady_clock::now();
+  auto result = process.run();
+  terminator.join();
+  CHECK(result.status == ChildProcess::Status::Terminated);
+  CHECK(std::chrono::steady_clock::now() - startTime < std::chrono::seconds(30));
+}
+
+TEST_CASE(doesNotStartTerminatedProcess) {
+  Output output;
+  ChildProcess process(stubCommand(L"exit 0"), output.outputCallback(), output.errorCallback());
+  process.terminate();
+  CHECK(process.run().status == ChildProcess::Status::Terminated);
+}
+
+int main() {
+  return papyrus::test::runTests();
+}
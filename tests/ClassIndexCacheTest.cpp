@@ -0,0 +1,146 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Check.hpp"
+
+#include "Plugin/Lexer/ClassIndexCache.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace papyrus;
+
+namespace {
+  std::filesystem::path cacheFilePath() {
+    return std::filesystem::temp_directory_path() / "PapyrusClassIndexCacheTest.dat";
+  }
+
+  template <typename T>
+  void writeValue(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  // Write a cache file with valid header followed by the given directory entry fields
+  void writeCacheFile(uint32_t pathLength, const std::wstring& path, uint32_t nameCount, uint16_t nameLength, const std::string& name) {
+    std::ofstream file(cacheFilePath(), std::ios::binary | std::ios::trunc);
+    writeValue<uint32_t>(file, 0x49435050);
+    writeValue<uint32_t>(file, 1);
+    writeValue<uint32_t>(file, 1);
+    writeValue<uint32_t>(file, pathLength);
+    file.write(reinterpret_cast<const char*>(path.data()), path.size() * sizeof(wchar_t));
+    writeValue<int64_t>(file, 42);
+    writeValue<uint32_t>(file, nameCount);
+    writeValue<uint16_t>(file, nameLength);
+    file.write(name.data(), name.size());
+  }
+}
+
+TEST_CASE(savesAndLoadsEntries) {
+  std::filesystem::remove(cacheFilePath());
+  {
+    ClassIndexCache cache;
+    CHECK(!cache.load(cacheFilePath()));
+    cache.addUsers({L"scripts"});
+    cache.update(L"scripts", ClassIndexCache::DirectoryEntry {.modificationTime = 42, .classNames = {"actor", "debug"}});
+    CHECK(cache.save());
+  }
+
+  ClassIndexCache cache;
+  CHECK(cache.load(cacheFilePath()));
+  auto entry = cache.find(L"scripts");
+  CHECK(entry.has_value());
+  if (entry) {
+    CHECK_EQUAL(42, entry->modificationTime);
+    CHECK(entry->classNames == ClassIndexCache::name_list_t({"actor", "debug"}));
+  }
+  std::filesystem::remove(cacheFilePath());
+}
+
+TEST_CASE(dropsUnusedDirectoriesWhenSaving) {
+  std::filesystem::remove(cacheFilePath());
+  {
+    ClassIndexCache cache;
+    cache.load(cacheFilePath());
+    cache.addUsers({L"scripts", L"old"});
+    cache.update(L"scripts", ClassIndexCache::DirectoryEntry {.modificationTime = 42, .classNames = {"actor"}});
+    cache.update(L"old", ClassIndexCache::DirectoryEntry {.modificationTime = 7, .classNames = {"quest"}});
+    CHECK(cache.save());
+  }
+
+  // Entries loaded for directories no longer in use are still dropped, even if nothing else changed
+  {
+    ClassIndexCache cache;
+    CHECK(cache.load(cacheFilePath()));
+    CHECK(cache.find(L"old").has_value());
+    cache.addUsers({L"scripts"});
+    CHECK(cache.save());
+  }
+
+  ClassIndexCache cache;
+  CHECK(cache.load(cacheFilePath()));
+  CHECK(cache.find(L"scripts").has_value());
+  CHECK(!cache.find(L"old").has_value());
+  std::filesystem::remove(cacheFilePath());
+}
+
+TEST_CASE(treatsCorruptFileAsEmpty) {
+  writeCacheFile(7, L"scripts", 1, 5, "actor");
+  {
+    ClassIndexCache cache;
+    CHECK(cache.load(cacheFilePath()));
+    CHECK(cache.find(L"scripts").has_value());
+  }
+
+  // Lengths and counts way beyond file size
+  writeCacheFile(0xFFFFFFF0, L"scripts", 1, 5, "actor");
+  {
+    ClassIndexCache cache;
+    CHECK(!cache.load(cacheFilePath()));
+    CHECK(!cache.find(L"scripts").has_value());
+  }
+
+  writeCacheFile(7, L"scripts", 0xFFFFFFF0, 5, "actor");
+  {
+    ClassIndexCache cache;
+    CHECK(!cache.load(cacheFilePath()));
+    CHECK(!cache.find(L"scripts").has_value());
+  }
+
+  writeCacheFile(7, L"scripts", 1, 0xFFFF, "actor");
+  {
+    ClassIndexCache cache;
+    CHECK(!cache.load(cacheFilePath()));
+    CHECK(!cache.find(L"scripts").has_value());
+  }
+
+  // Truncated file
+  writeCacheFile(7, L"scripts", 1, 5, "act");
+  {
+    ClassIndexCache cache;
+    CHECK(!cache.load(cacheFilePath()));
+  }
+  std::filesystem::remove(cacheFilePath());
+}
+
+int main() {
+  return papyrus::test::runTests();
+}
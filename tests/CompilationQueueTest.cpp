@@ -0,0 +1,171 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Check.hpp"
+
+#include "Plugin/Compiler/ChildProcess.hpp"
+#include "Plugin/Compiler/CompilationQueue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace papyrus;
+
+namespace {
+  std::wstring stubCommand(const std::wstring& arguments) {
+    return L"\"" + std::filesystem::path(STUB_COMPILER_PATH).wstring() + L"\" " + arguments;
+  }
+
+  CompilationRequest makeRequest(const std::wstring& filePath) {
+    return CompilationRequest {
+      .game = Game::Skyrim,
+      .bufferID = 0,
+      .filePath { filePath },
+      .useAutoModeOutputDirectory = false
+    };
+  }
+
+  // Runs stub compiler for each job, keeping running processes registered so they can be killed on shutdown, the same way
+  // Compiler does
+  class StubRunner {
+    public:
+      ChildProcess::Result run(const std::wstring& arguments) {
+        auto ignoreLines = [](const std::vector<std::string>&) {};
+        ChildProcess process(stubCommand(arguments), ignoreLines, ignoreLines);
+        {
+          std::lock_guard lock(mutex);
+          if (cancelled) {
+            process.terminate();
+          } else {
+            processes.insert(&process);
+          }
+        }
+        started++;
+        auto result = process.run();
+        {
+          std::lock_guard lock(mutex);
+          processes.erase(&process);
+          results.push_back(result);
+        }
+        return result;
+      }
+
+      void cancel() {
+        std::lock_guard lock(mutex);
+        cancelled = true;
+        for (ChildProcess* process : processes) {
+          process->terminate();
+        }
+      }
+
+      std::mutex mutex;
+      std::atomic<size_t> started {0};
+      std::vector<ChildProcess::Result> results;
+
+    private:
+      bool cancelled {false};
+      std::set<ChildProcess*> processes;
+  };
+
+  void waitFor(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+TEST_CASE(runsJobsConcurrently) {
+  // Each stub only exits successfully once the file created after all jobs have started exists, which can only happen
+  // if they are running at the same time
+  const size_t jobCount = 3;
+  std::filesystem::path barrierFile = std::filesystem::temp_directory_path() / "PapyrusCompilationQueueTest.barrier";
+  std::filesystem::remove(barrierFile);
+  StubRunner runner;
+  std::atomic<size_t> arrivedJobs {0};
+  {
+    CompilationQueue queue(8, jobCount,
+      [&](const CompilationRequest&) {
+        if (++arrivedJobs == jobCount) {
+          std::ofstream(barrierFile).put('\n');
+        }
+        runner.run(L"handshake \"" + barrierFile.wstring() + L"\"");
+      }
+    );
+    for (size_t i = 0; i < jobCount; i++) {
+      CHECK(queue.push(makeRequest(L"Script" + std::to_wstring(i) + L".psc")));
+    }
+    waitFor([&] { std::lock_guard lock(runner.mutex); return runner.results.size() == jobCount; });
+    CHECK(queue.shutdown(std::chrono::seconds(10), [] {}));
+  }
+
+  CHECK_EQUAL(jobCount, runner.results.size());
+  for (const auto& result : runner.results) {
+    CHECK(result.status == ChildProcess::Status::Exited);
+    CHECK_EQUAL(0u, result.exitCode);
+  }
+  std::filesystem::remove(barrierFile);
+}
+
+TEST_CASE(shutdownKillsRunningJobsAndDropsQueuedOnes) {
+  StubRunner runner;
+  CompilationQueue queue(8, 1, [&](const CompilationRequest&) { runner.run(L"hang"); });
+  for (int i = 0; i < 3; i++) {
+    CHECK(queue.push(makeRequest(L"Hang" + std::to_wstring(i) + L".psc")));
+  }
+  waitFor([&] { return runner.started > 0; });
+
+  auto startTime = std::chrono::steady_clock::now();
+  runner.cancel();
+  CHECK(queue.shutdown(std::chrono::seconds(10), [] {}));
+  CHECK(std::chrono::steady_clock::now() - startTime < std::chrono::seconds(10));
+  CHECK_EQUAL(1u, runner.results.size());
+  CHECK(runner.results.front().status == ChildProcess::Status::Terminated);
+  CHECK(!queue.push(makeRequest(L"Late.psc")));
+}
+
+TEST_CASE(shutdownHandlesMessagesWhileWaiting) {
+  // Job waits for the thread calling shutdown, like a worker sending a message to plugin message window
+  std::atomic<bool> jobStarted {false};
+  std::atomic<bool> messageHandled {false};
+  CompilationQueue queue(8, 1,
+    [&](const CompilationRequest&) {
+      jobStarted = true;
+      waitFor([&] { return messageHandled.load(); });
+    }
+  );
+  CHECK(queue.push(makeRequest(L"Script.psc")));
+  waitFor([&] { return jobStarted.load(); });
+
+  CHECK(queue.shutdown(std::chrono::seconds(10), [&] { messageHandled = true; }));
+  CHECK(messageHandled);
+}
+
+int main() {
+  return papyrus::test::runTests();
+}
@@ -0,0 +1,183 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Check.hpp"
+
+#include "Plugin/Compiler/DependencyGraph.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace papyrus;
+
+namespace {
+  // Scripts live in their own folder, and the class they extend in an import directory. File names are lower case, as
+  // names referred to by scripts are resolved in lower case and test file systems may be case sensitive.
+  struct Project {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "PapyrusDependencyGraphTest";
+    std::filesystem::path importDirectory = root / "import";
+    std::filesystem::path scriptDirectory = root / "scripts";
+    std::filesystem::path outputDirectory = root / "output";
+    std::filesystem::file_time_type baseTime = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+
+    Project() {
+      std::filesystem::remove_all(root);
+      std::filesystem::create_directories(importDirectory);
+      std::filesystem::create_directories(scriptDirectory);
+      std::filesystem::create_directories(outputDirectory);
+      write(importDirectory / "base.psc", "Scriptname Base\n", 0);
+      write(scriptDirectory / "middle.psc", "Scriptname Middle extends Base\n", 0);
+      write(scriptDirectory / "top.psc", "Scriptname Top\nMiddle Property Link Auto ; Unrelated names are ignored\n", 0);
+      write(outputDirectory / "top.pex", "compiled", 10);
+    }
+
+    ~Project() {
+      std::filesystem::remove_all(root);
+    }
+
+    // Write a file with modification time given in seconds after base time
+    void write(const std::filesystem::path& file, const std::string& content, int seconds) {
+      std::ofstream(file, std::ios::binary | std::ios::trunc) << content;
+      touch(file, seconds);
+    }
+
+    void touch(const std::filesystem::path& file, int seconds) {
+      std::filesystem::last_write_time(file, baseTime + std::chrono::seconds(seconds));
+    }
+
+    std::wstring script() const { return (scriptDirectory / "top.psc").wstring(); }
+    std::wstring output() const { return (outputDirectory / "top.pex").wstring(); }
+    std::vector<std::wstring> importDirectories() const { return {importDirectory.wstring()}; }
+
+    void recordBuild(DependencyGraph& graph, const std::wstring& signature = L"signature") const {
+      graph.recordBuild(script(), output(), signature, graph.getInputs(script(), importDirectories(), L""));
+    }
+  };
+}
+
+TEST_CASE(collectsTransitiveInputs) {
+  Project project;
+  DependencyGraph graph;
+  auto inputs = graph.getInputs(project.script(), project.importDirectories(), L"");
+  CHECK_EQUAL(3u, inputs.size());
+  if (inputs.size() == 3) {
+    CHECK(inputs[0].first == project.script());
+    CHECK(inputs[1].first == (project.scriptDirectory / "middle.psc").wstring());
+    CHECK(inputs[2].first == (project.importDirectory / "base.psc").wstring());
+  }
+}
+
+TEST_CASE(refreshesResolvedClassesWhenDirectoryChanges) {
+  Project project;
+  DependencyGraph graph;
+  CHECK_EQUAL(3u, graph.getInputs(project.script(), project.importDirectories(), L"").size());
+
+  // Keywords are never resolved, while a new class file for a referenced name is picked up though the script is unchanged
+  project.write(project.scriptDirectory / "property.psc", "Scriptname Property\n", 0);
+  CHECK_EQUAL(3u, graph.getInputs(project.script(), project.importDirectories(), L"").size());
+  project.write(project.scriptDirectory / "link.psc", "Scriptname Link\n", 0);
+  CHECK_EQUAL(4u, graph.getInputs(project.script(), project.importDirectories(), L"").size());
+}
+
+TEST_CASE(upToDateUntilSignatureOrOutputChanges) {
+  Project project;
+  DependencyGraph graph;
+  CHECK(!graph.isUpToDate(project.script(), project.output(), L"signature"));
+  project.recordBuild(graph);
+  CHECK(graph.isUpToDate(project.script(), project.output(), L"signature"));
+  CHECK(!graph.isUpToDate(project.script(), project.output(), L"other signature"));
+  CHECK(!graph.isUpToDate(project.script(), (project.outputDirectory / "other.pex").wstring(), L"signature"));
+
+  project.touch(project.output(), 20);
+  CHECK(!graph.isUpToDate(project.script(), project.output(), L"signature"));
+}
+
+TEST_CASE(outOfDateWhenTransitiveDependencyModified) {
+  Project project;
+  DependencyGraph graph;
+  project.recordBuild(graph);
+  project.touch(project.importDirectory / "base.psc", 5);
+  CHECK(!graph.isUpToDate(project.script(), project.output(), L"signature"));
+}
+
+TEST_CASE(rejectsOutputOlderThanInputs) {
+  // Script modified after compiler read it
+  Project project;
+  project.touch(project.script(), 20);
+  DependencyGraph graph;
+  project.recordBuild(graph);
+  CHECK(!graph.isUpToDate(project.script(), project.output(), L"signature"));
+}
+
+TEST_CASE(savesAndLoadsBuilds) {
+  Project project;
+  std::filesystem::path graphFile = project.root / "graph.dat";
+  {
+    DependencyGraph graph;
+    CHECK(!graph.load(graphFile));
+    project.recordBuild(graph);
+    CHECK(graph.save());
+  }
+
+  DependencyGraph graph;
+  CHECK(graph.load(graphFile));
+  CHECK(graph.isUpToDate(project.script(), project.output(), L"signature"));
+}
+
+TEST_CASE(treatsCorruptFileAsEmpty) {
+  Project project;
+  std::filesystem::path graphFile = project.root / "graph.dat";
+  {
+    DependencyGraph graph;
+    graph.load(graphFile);
+    project.recordBuild(graph);
+    graph.save();
+  }
+  auto fileSize = std::filesystem::file_size(graphFile);
+
+  // Truncated file
+  std::filesystem::resize_file(graphFile, fileSize - 1);
+  {
+    DependencyGraph graph;
+    CHECK(!graph.load(graphFile));
+    CHECK(!graph.isUpToDate(project.script(), project.output(), L"signature"));
+  }
+
+  // Script count way beyond file size
+  {
+    std::fstream file(graphFile, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(2 * sizeof(uint32_t));
+    uint32_t count = 0xFFFFFFF0;
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  {
+    DependencyGraph graph;
+    CHECK(!graph.load(graphFile));
+    CHECK(!graph.isUpToDate(project.script(), project.output(), L"signature"));
+  }
+}
+
+int main() {
+  return papyrus::test::runTests();
+}
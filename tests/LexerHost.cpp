@@ -0,0 +1,167 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "LexerHost.hpp"
+
+#include "Plugin/Lexer/LexerData.hpp"
+#include "Plugin/Lexer/LexerIDs.hpp"
+
+#include <memory>
+
+namespace papyrus {
+
+  LexerHost::LexerHost(std::string_view text)
+    : memoryDocument(text), lexerInstance(static_cast<Lexer*>(Lexer::factory())) {
+    if (!lexerData) {
+      lexerData = std::make_unique<LexerData>(settings());
+    }
+    for (int index = 0; index < static_cast<int>(wordLists().size()); index++) {
+      lexerInstance->WordListSet(index, wordLists()[index]);
+    }
+  }
+
+  LexerHost::~LexerHost() {
+    lexerInstance->Release();
+  }
+
+  LexerSettings& LexerHost::settings() {
+    static LexerSettings lexerSettings {
+      .enableFoldMiddle = false,
+      .enableClassNameCache = false,
+      .classNameCacheSize = 256
+    };
+    return lexerSettings;
+  }
+
+  const std::vector<const char*>& LexerHost::wordLists() {
+    static const std::vector<const char*> papyrusWordLists {
+      "( ) [ ] , = + - * / % . ! > < | & as",
+      "if else elseif endif while endwhile",
+      "bool float int string",
+      "scriptname extends import event endevent state endstate function endfunction global native property endproperty auto autoreadonly conditional hidden new return length",
+      "none parent self true false",
+      "if while function property event state",
+      "else elseif",
+      "auto autoreadonly endevent endfunction endif endproperty endstate endwhile"
+    };
+    return papyrusWordLists;
+  }
+
+  void LexerHost::colourise(Sci_Position start, Sci_Position end) {
+    Sci_Position length = memoryDocument.Length();
+    if (end == -1 || end > length) {
+      end = length;
+    }
+    start = memoryDocument.LineStart(memoryDocument.LineFromPosition(start));
+    if (end > start) {
+      int initStyle = (start > 0) ? memoryDocument.StyleAt(start - 1) : 0;
+      lexerInstance->Lex(start, end - start, initStyle, &memoryDocument);
+      lexerInstance->Fold(start, end - start, initStyle, &memoryDocument);
+    }
+  }
+
+  void LexerHost::ensureStyled() {
+    colourise(memoryDocument.endStyled(), -1);
+  }
+
+  void LexerHost::insertText(Sci_Position position, std::string_view text, bool notify) {
+    SCNotification notification = memoryDocument.insertText(position, text);
+    if (notify) {
+      notifyModified(notification);
+    }
+    ensureStyled();
+  }
+
+  void LexerHost::deleteText(Sci_Position position, Sci_Position length, bool notify) {
+    SCNotification notification = memoryDocument.deleteText(position, length);
+    if (notify) {
+      notifyModified(notification);
+    }
+    ensureStyled();
+  }
+
+  void LexerHost::replaceText(Sci_Position position, Sci_Position length, std::string_view text, bool notify) {
+    SCNotification deletion = memoryDocument.deleteText(position, length);
+    SCNotification insertion = memoryDocument.insertText(position, text);
+    if (notify) {
+      notifyModified(deletion);
+      notifyModified(insertion);
+    }
+    ensureStyled();
+  }
+
+  int LexerHost::styleAt(Sci_Position line, Sci_Position column) const {
+    return static_cast<unsigned char>(memoryDocument.StyleAt(memoryDocument.LineStart(line) + column));
+  }
+
+  int LexerHost::foldLevel(Sci_Position line) const {
+    return (memoryDocument.GetLevel(line) & SC_FOLDLEVELNUMBERMASK) - SC_FOLDLEVELBASE;
+  }
+
+  bool LexerHost::isFoldHeader(Sci_Position line) const {
+    return (memoryDocument.GetLevel(line) & SC_FOLDLEVELHEADERFLAG) != 0;
+  }
+
+  std::vector<Lexer::OutlineEntry> LexerHost::outline() {
+    std::vector<Lexer::OutlineEntry> entries;
+    lexerInstance->PrivateCall(PAPYRUS_LEXER_CALL_GET_OUTLINE, &entries);
+    return entries;
+  }
+
+  Lexer::Statistics LexerHost::statistics() {
+    Lexer::Statistics statistics {};
+    lexerInstance->PrivateCall(PAPYRUS_LEXER_CALL_GET_STATISTICS, &statistics);
+    return statistics;
+  }
+
+  std::vector<Lexer::TextRange> LexerHost::restyleRanges(uint32_t reasons) {
+    Lexer::RestyleQuery query {
+      .reasons = reasons
+    };
+    lexerInstance->PrivateCall(PAPYRUS_LEXER_CALL_GET_RESTYLE_RANGES, &query);
+    return query.ranges;
+  }
+
+  bool LexerHost::isOutdated() {
+    return lexerInstance->PrivateCall(PAPYRUS_LEXER_CALL_IS_OUTDATED, nullptr) != nullptr;
+  }
+
+  void LexerHost::setLexWorkers(size_t workerCount) {
+    lexerInstance->PrivateCall(PAPYRUS_LEXER_CALL_SET_LEX_WORKERS, &workerCount);
+  }
+
+  void LexerHost::restyle(uint32_t reasons) {
+    if (isOutdated()) {
+      colourise(0, -1);
+    } else {
+      for (const auto& range : restyleRanges(reasons)) {
+        colourise(range.startPos, range.endPos);
+      }
+    }
+  }
+
+  // Private methods
+  //
+
+  void LexerHost::notifyModified(SCNotification notification) {
+    lexerInstance->PrivateCall(PAPYRUS_LEXER_CALL_DOCUMENT_MODIFIED, &notification);
+  }
+
+} // namespace
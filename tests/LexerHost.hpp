@@ -0,0 +1,93 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "MemoryDocument.hpp"
+
+#include "Plugin/Lexer/Lexer.hpp"
+#include "Plugin/Lexer/LexerSettings.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // Hosts a lexer over an in-memory document the way Notepad++ does: word lists are the ones from Papyrus.xml, edits are
+  // reported to the lexer, and styling goes through the same steps as Scintilla's SCI_COLOURISE and painting.
+  class LexerHost {
+    public:
+      explicit LexerHost(std::string_view text);
+      ~LexerHost();
+
+      LexerHost(const LexerHost&) = delete;
+      LexerHost& operator=(const LexerHost&) = delete;
+
+      // Settings used by all lexer instances
+      static LexerSettings& settings();
+
+      // Word lists in Papyrus.xml, in the order of word list sets: instre1 & 2, then type1 - 6
+      static const std::vector<const char*>& wordLists();
+
+      inline MemoryDocument& document() { return memoryDocument; }
+      inline Lexer& lexer() { return *lexerInstance; }
+
+      // Same as SCI_COLOURISE, which lexes and folds the given range starting from its first line. End of -1 means end of document.
+      void colourise(Sci_Position start = 0, Sci_Position end = -1);
+
+      // Style text not styled yet, same as Scintilla does before painting
+      void ensureStyled();
+
+      // Edit text and style it again. Without notification the edit is like one made through another view the plugin
+      // doesn't hear from, e.g. Replace All in all opened documents.
+      void insertText(Sci_Position position, std::string_view text, bool notify = true);
+      void deleteText(Sci_Position position, Sci_Position length, bool notify = true);
+
+      // Replace text with both edits done before styling, same as Scintilla's target replacement
+      void replaceText(Sci_Position position, Sci_Position length, std::string_view text, bool notify = true);
+
+      // Style at a column of a line
+      int styleAt(Sci_Position line, Sci_Position column) const;
+
+      // Fold level of a line without flags, and whether it's a fold header
+      int foldLevel(Sci_Position line) const;
+      bool isFoldHeader(Sci_Position line) const;
+
+      std::vector<Lexer::OutlineEntry> outline();
+      Lexer::Statistics statistics();
+      std::vector<Lexer::TextRange> restyleRanges(uint32_t reasons);
+      bool isOutdated();
+
+      // Number of threads preparing lines of a large Lex range, or 0 for one per processor core
+      void setLexWorkers(size_t workerCount);
+
+      // Restyle lines for the given reasons, same as the plugin does when they may be styled differently now
+      void restyle(uint32_t reasons);
+
+    private:
+      void notifyModified(SCNotification notification);
+
+      // Private members
+      //
+      MemoryDocument memoryDocument;
+      Lexer* lexerInstance;
+  };
+
+} // namespace
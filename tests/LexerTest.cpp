@@ -0,0 +1,378 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Check.hpp"
+#include "LexerHost.hpp"
+
+#include "Plugin/Lexer/LexerData.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace papyrus;
+
+namespace {
+  const char* const script =
+    "Scriptname Foo extends Quest\n"         // 0
+    "; comment\n"                             // 1
+    "Int Property Count Auto\n"               // 2
+    "Function Bar(int a)\n"                   // 3
+    "  If a > 1 ; x\n"                        // 4
+    "    Count = -1.5 + a\n"                  // 5
+    "  ElseIf a\n"                            // 6
+    "    Debug.Trace(\"h\\\"i\")\n"           // 7
+    "  EndIf\n"                               // 8
+    "EndFunction\n"                           // 9
+    "{doc\n"                                  // 10
+    "comment}\n"                              // 11
+    ";/ multi\n"                              // 12
+    "line /;\n"                               // 13
+    "Event OnInit()\n"                        // 14
+    "EndEvent\n";                             // 15
+
+  // Style of the first occurrence of a word in a line, or -1 if the word isn't found or isn't styled the same throughout
+  int styleOf(LexerHost& host, Sci_Position line, std::string_view word) {
+    Sci_Position lineStart = host.document().LineStart(line);
+    std::string lineText = host.document().text().substr(lineStart, host.document().LineEnd(line) - lineStart);
+    size_t column = lineText.find(word);
+    if (column == std::string::npos) {
+      return -1;
+    }
+    int style = host.styleAt(line, column);
+    for (size_t index = 1; index < word.size(); index++) {
+      if (host.styleAt(line, column + index) != style) {
+        return -1;
+      }
+    }
+    return style;
+  }
+
+  // Check that styles and fold levels of an incrementally styled document are the same as styling its text from scratch
+  void checkSameAsFullStyling(LexerHost& host) {
+    LexerHost fresh(host.document().text());
+    fresh.colourise();
+    CHECK_EQUAL(fresh.document().styles(0, fresh.document().Length()), host.document().styles(0, host.document().Length()));
+    for (Sci_Position line = 0; line < fresh.document().lineCount(); line++) {
+      CHECK_EQUAL(fresh.document().GetLevel(line), host.document().GetLevel(line));
+    }
+  }
+}
+
+TEST_CASE(stylesTokens) {
+  LexerHost host(script);
+  host.colourise();
+
+  CHECK_EQUAL(4, styleOf(host, 0, "Scriptname"));
+  CHECK_EQUAL(4, styleOf(host, 0, "extends"));
+  CHECK_EQUAL(9, styleOf(host, 1, "; comment"));
+  CHECK_EQUAL(3, styleOf(host, 2, "Int"));
+  CHECK_EQUAL(4, styleOf(host, 2, "Property"));
+  CHECK_EQUAL(14, styleOf(host, 2, "Count"));
+  CHECK_EQUAL(16, styleOf(host, 3, "Bar"));
+  CHECK_EQUAL(1, styleOf(host, 3, "("));
+  CHECK_EQUAL(2, styleOf(host, 4, "If"));
+  CHECK_EQUAL(9, styleOf(host, 4, "; x"));
+  CHECK_EQUAL(14, styleOf(host, 5, "Count"));
+  CHECK_EQUAL(12, styleOf(host, 5, "-1.5"));
+  CHECK_EQUAL(2, styleOf(host, 6, "ElseIf"));
+  CHECK_EQUAL(13, styleOf(host, 7, "\"h\\\"i\""));
+  CHECK_EQUAL(0, styleOf(host, 7, "Debug"));
+  CHECK_EQUAL(11, styleOf(host, 10, "{doc"));
+  CHECK_EQUAL(11, styleOf(host, 11, "comment}"));
+  CHECK_EQUAL(10, styleOf(host, 12, ";/ multi"));
+  CHECK_EQUAL(10, styleOf(host, 13, "line /;"));
+  CHECK_EQUAL(4, styleOf(host, 14, "Event"));
+}
+
+TEST_CASE(stylesCrLfLineEnds) {
+  std::string text(script);
+  for (size_t position = text.find('\n'); position != std::string::npos; position = text.find('\n', position + 2)) {
+    text.insert(position, 1, '\r');
+  }
+  LexerHost host(text);
+  host.colourise();
+
+  CHECK_EQUAL(16, host.document().lineCount() - 1);
+  CHECK_EQUAL(14, styleOf(host, 5, "Count"));
+  CHECK_EQUAL(11, styleOf(host, 11, "comment}"));
+  CHECK_EQUAL(10, styleOf(host, 13, "line /;"));
+  CHECK_EQUAL(4, styleOf(host, 14, "Event"));
+}
+
+TEST_CASE(foldsBlocks) {
+  LexerHost host(script);
+  host.colourise();
+
+  CHECK(host.isFoldHeader(3));
+  CHECK_EQUAL(0, host.foldLevel(3));
+  CHECK(host.isFoldHeader(4));
+  CHECK_EQUAL(1, host.foldLevel(4));
+  CHECK_EQUAL(2, host.foldLevel(5));
+  CHECK(!host.isFoldHeader(6));
+  CHECK_EQUAL(2, host.foldLevel(8));
+  CHECK_EQUAL(1, host.foldLevel(9));
+  CHECK_EQUAL(0, host.foldLevel(10));
+  CHECK(host.isFoldHeader(14));
+  CHECK_EQUAL(1, host.foldLevel(15));
+  CHECK_EQUAL(0, host.foldLevel(16));
+}
+
+TEST_CASE(foldsMiddleWhenEnabled) {
+  LexerHost::settings().enableFoldMiddle = true;
+  LexerHost host(script);
+  host.colourise();
+  LexerHost::settings().enableFoldMiddle = false;
+
+  CHECK(host.isFoldHeader(6));
+  CHECK_EQUAL(1, host.foldLevel(6));
+  CHECK_EQUAL(2, host.foldLevel(7));
+}
+
+TEST_CASE(refoldsAllRangesWhenFoldMiddleToggled) {
+  // Fold middle lines close enough to be merged into one restyle range, and another such range further down
+  std::string text =
+    "Function Bar(int a)\n"
+    "  If a\n"
+    "  ElseIf a > 1\n"
+    "    a = 1\n"
+    "    a = 2\n"
+    "  ElseIf a > 2\n"
+    "  EndIf\n";
+  for (int line = 0; line < 10; line++) {
+    text += "  a = 0\n";
+  }
+  text +=
+    "  If a\n"
+    "  ElseIf a > 1\n"
+    "    a = 1\n"
+    "  Else\n"
+    "  EndIf\n"
+    "EndFunction\n";
+  LexerHost host(text);
+  host.colourise();
+
+  for (bool enabled : {true, false}) {
+    LexerHost::settings().enableFoldMiddle = enabled;
+    host.restyle(Lexer::FoldMiddle);
+    CHECK_EQUAL(enabled, host.isFoldHeader(2));
+    CHECK_EQUAL(enabled, host.isFoldHeader(5));
+    CHECK_EQUAL(enabled, host.isFoldHeader(18));
+    CHECK_EQUAL(enabled, host.isFoldHeader(20));
+    checkSameAsFullStyling(host);
+  }
+  LexerHost::settings().enableFoldMiddle = false;
+}
+
+TEST_CASE(restylesAfterEdits) {
+  LexerHost host(script);
+  host.colourise();
+
+  // Open a doc comment that swallows lines up to the existing one's end, then close it again
+  host.insertText(host.document().LineStart(4), "{");
+  CHECK_EQUAL(11, styleOf(host, 5, "Count"));
+  CHECK_EQUAL(11, styleOf(host, 9, "EndFunction"));
+  checkSameAsFullStyling(host);
+
+  host.deleteText(host.document().LineStart(4), 1);
+  CHECK_EQUAL(14, styleOf(host, 5, "Count"));
+  CHECK_EQUAL(11, styleOf(host, 10, "{doc"));
+  checkSameAsFullStyling(host);
+
+  // Add and remove lines, including ones changing properties and folds
+  host.insertText(host.document().LineStart(3), "Float Property Ratio Auto\nFunction Baz()\n");
+  CHECK_EQUAL(14, styleOf(host, 3, "Ratio"));
+  CHECK(host.isFoldHeader(4));
+  checkSameAsFullStyling(host);
+
+  host.insertText(host.document().LineStart(7), "    Ratio = 2\n");
+  CHECK_EQUAL(14, styleOf(host, 7, "Ratio"));
+  checkSameAsFullStyling(host);
+
+  host.deleteText(host.document().LineStart(3), host.document().LineStart(5) - host.document().LineStart(3));
+  CHECK_EQUAL(0, styleOf(host, 5, "Ratio"));
+  checkSameAsFullStyling(host);
+
+  Lexer::Statistics statistics = host.statistics();
+  CHECK(statistics.tokenCacheHits > 0);
+  CHECK(statistics.lexTiming.calls > 0);
+}
+
+TEST_CASE(recordsOnlyLinesStyledBeforeStoppingEarly) {
+  LexerHost host(script);
+  host.colourise();
+  size_t linesBefore = host.statistics().lexTiming.lines;
+
+  // Edit doesn't change the state line 5 ends with, so Lex stops right after it
+  host.replaceText(host.document().LineStart(5) + 4, 5, "Total");
+  CHECK_EQUAL(linesBefore + 1, host.statistics().lexTiming.lines);
+}
+
+TEST_CASE(preparesLargeRangesInParallelSameAsSerially) {
+  // Comments span the boundaries of chunks prepared by 4 workers, so chunks are stitched from speculative styling.
+  // Non-ASCII identifiers and an invalid UTF-8 byte go through multi-byte decoding of the snapshot workers read.
+  std::string text(script);
+  for (int line = 16; line < 12000; line++) {
+    if (line % 3000 == 2995) {
+      text += (line % 6000 == 2995) ? "{doc spanning chunks\n" : ";/ multi-line spanning chunks\n";
+    } else if (line % 3000 == 5) {
+      text += (line % 6000 == 3005) ? "end of doc}\n" : "end of multi-line /;\n";
+    } else if (line % 50 == 0) {
+      text += "Function F\xC3\xBCr" + std::to_string(line) + "()\n";
+    } else if (line % 50 == 1) {
+      text += "  Count = \"\xFF\" + Count ; Zw\xC3\xB6lf\n";
+    } else if (line % 50 == 2) {
+      text += "EndFunction\n";
+    } else {
+      text += "  Int i" + std::to_string(line) + " = Count * 2\n";
+    }
+  }
+
+  LexerHost serialHost(text);
+  serialHost.setLexWorkers(1);
+  serialHost.colourise();
+  LexerHost parallelHost(text);
+  parallelHost.setLexWorkers(4);
+  parallelHost.colourise();
+
+  CHECK_EQUAL(0u, serialHost.statistics().parallelLexCalls);
+  CHECK_EQUAL(1u, parallelHost.statistics().parallelLexCalls);
+  CHECK_EQUAL(11, parallelHost.styleAt(3001, 0));
+  CHECK_EQUAL(10, parallelHost.styleAt(6001, 0));
+  CHECK(serialHost.document().styles(0, serialHost.document().Length()) == parallelHost.document().styles(0, parallelHost.document().Length()));
+  for (Sci_Position line = 0; line < serialHost.document().lineCount(); line++) {
+    if (serialHost.document().GetLevel(line) != parallelHost.document().GetLevel(line)) {
+      CHECK_EQUAL(serialHost.document().GetLevel(line), parallelHost.document().GetLevel(line));
+      break;
+    }
+  }
+}
+
+TEST_CASE(restylesEditsWithoutNotification) {
+  LexerHost host(script);
+  host.colourise();
+
+  // Same length edits through another view, so only text tells the lines apart from what was tokenized before
+  host.replaceText(host.document().LineStart(5) + 4, 5, "Total", false);
+  CHECK_EQUAL(0, styleOf(host, 5, "Total"));
+
+  host.replaceText(host.document().LineStart(4) + 2, 2, "Xf", false);
+  CHECK(!host.isFoldHeader(4));
+  CHECK_EQUAL(1, host.foldLevel(5));
+  checkSameAsFullStyling(host);
+}
+
+TEST_CASE(restylesSeparateEditsWithoutNotification) {
+  LexerHost host(script);
+  host.colourise();
+
+  // Both edits are made before styling, with unchanged lines between them that end in the same state as before
+  host.document().deleteText(host.document().LineStart(4) + 2, 2);
+  host.document().insertText(host.document().LineStart(4) + 2, "Xf");
+  host.document().deleteText(host.document().LineStart(8) + 2, 5);
+  host.document().insertText(host.document().LineStart(8) + 2, "EndXf");
+  host.ensureStyled();
+
+  CHECK(!host.isFoldHeader(4));
+  CHECK_EQUAL(0, styleOf(host, 8, "EndXf"));
+  CHECK_EQUAL(1, host.foldLevel(8));
+  CHECK_EQUAL(1, host.foldLevel(9));
+  checkSameAsFullStyling(host);
+}
+
+TEST_CASE(staysOutdatedUntilWholeDocumentRestyled) {
+  std::filesystem::path importDirectory = std::filesystem::temp_directory_path() / "PapyrusLexerTest";
+  std::filesystem::create_directories(importDirectory);
+  std::ofstream(importDirectory / "Debug.psc") << "Scriptname Debug Hidden\n";
+
+  LexerHost host(script);
+  host.colourise();
+  CHECK(!host.isOutdated());
+  CHECK_EQUAL(0, styleOf(host, 7, "Debug"));
+
+  // Class index gets built in background
+  lexerData->currentGame = Game::Skyrim;
+  lexerData->classResolver.setImportDirectories(Game::Skyrim, {importDirectory.wstring()}, []() {});
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (lexerData->classResolver.classIndexVersion(Game::Skyrim) == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  CHECK(lexerData->classResolver.classIndexVersion(Game::Skyrim) != 0);
+  CHECK(host.isOutdated());
+
+  // Styling only some lines, e.g. when painting, doesn't bring the rest of the document up to date
+  host.colourise(host.document().LineStart(7), host.document().LineStart(8));
+  CHECK_EQUAL(15, styleOf(host, 7, "Debug"));
+  CHECK(host.isOutdated());
+
+  host.restyle(Lexer::UnresolvedNames);
+  CHECK(!host.isOutdated());
+  checkSameAsFullStyling(host);
+
+  lexerData->classResolver.setImportDirectories(Game::Skyrim, {}, []() {});
+  lexerData->currentGame = Game::Auto;
+  std::filesystem::remove_all(importDirectory);
+}
+
+TEST_CASE(reportsOutline) {
+  LexerHost host(script);
+  host.colourise();
+
+  auto outline = host.outline();
+  CHECK_EQUAL(3u, outline.size());
+  if (outline.size() == 3) {
+    CHECK(outline[0].kind == Lexer::OutlineKind::Property);
+    CHECK_EQUAL("count", outline[0].name);
+    CHECK_EQUAL(2, outline[0].endLine);
+    CHECK(outline[1].kind == Lexer::OutlineKind::Function);
+    CHECK_EQUAL("bar", outline[1].name);
+    CHECK_EQUAL(3, outline[1].startLine);
+    CHECK_EQUAL(9, outline[1].endLine);
+    CHECK(outline[2].kind == Lexer::OutlineKind::Event);
+    CHECK_EQUAL(14, outline[2].startLine);
+    CHECK_EQUAL(15, outline[2].endLine);
+  }
+}
+
+TEST_CASE(updatesOutlineFromEditsMadeBeforeQuery) {
+  LexerHost host(script);
+  host.colourise();
+  CHECK_EQUAL(3u, host.outline().size());
+
+  // Rename the function and comment out the event up to document end before outline is queried again
+  host.replaceText(host.document().LineStart(3) + 9, 3, "Baz");
+  host.insertText(host.document().LineStart(14), ";/ ");
+  auto outline = host.outline();
+  CHECK_EQUAL(2u, outline.size());
+  if (outline.size() == 2) {
+    CHECK_EQUAL("baz", outline[1].name);
+    CHECK_EQUAL(9, outline[1].endLine);
+  }
+
+  host.deleteText(host.document().LineStart(14), 3);
+  CHECK_EQUAL(3u, host.outline().size());
+}
+
+int main() {
+  return papyrus::test::runTests();
+}
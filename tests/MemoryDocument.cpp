@@ -0,0 +1,294 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "MemoryDocument.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace papyrus {
+
+  MemoryDocument::MemoryDocument(std::string_view text, int codePage)
+    : content(text), styleBytes(text.size(), '\0'), codePage(codePage) {
+    updateLineStarts();
+    levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+    lineStates.assign(lineStarts.size(), 0);
+  }
+
+  SCNotification MemoryDocument::insertText(Sci_Position position, std::string_view text) {
+    position = std::clamp(position, Sci_Position(0), Length());
+    Sci_Position line = LineFromPosition(position);
+    Sci_Position lineCountBefore = lineCount();
+    content.insert(static_cast<size_t>(position), text);
+    styleBytes.insert(static_cast<size_t>(position), text.size(), '\0');
+    updateLineStarts();
+    Sci_Position linesAdded = lineCount() - lineCountBefore;
+    modified(line, linesAdded, position);
+
+    SCNotification notification {};
+    notification.nmhdr.code = SCN_MODIFIED;
+    notification.modificationType = SC_MOD_INSERTTEXT;
+    notification.position = position;
+    notification.length = static_cast<Sci_Position>(text.size());
+    notification.linesAdded = linesAdded;
+    return notification;
+  }
+
+  SCNotification MemoryDocument::deleteText(Sci_Position position, Sci_Position length) {
+    position = std::clamp(position, Sci_Position(0), Length());
+    length = std::clamp(length, Sci_Position(0), Length() - position);
+    Sci_Position line = LineFromPosition(position);
+    Sci_Position lineCountBefore = lineCount();
+    content.erase(static_cast<size_t>(position), static_cast<size_t>(length));
+    styleBytes.erase(static_cast<size_t>(position), static_cast<size_t>(length));
+    updateLineStarts();
+    Sci_Position linesAdded = lineCount() - lineCountBefore;
+    modified(line, linesAdded, position);
+
+    SCNotification notification {};
+    notification.nmhdr.code = SCN_MODIFIED;
+    notification.modificationType = SC_MOD_DELETETEXT;
+    notification.position = position;
+    notification.length = length;
+    notification.linesAdded = linesAdded;
+    return notification;
+  }
+
+  std::string MemoryDocument::styles(Sci_Position position, Sci_Position length) const {
+    position = std::clamp(position, Sci_Position(0), Length());
+    length = std::clamp(length, Sci_Position(0), Length() - position);
+    return styleBytes.substr(static_cast<size_t>(position), static_cast<size_t>(length));
+  }
+
+  std::string MemoryDocument::lineStyles(Sci_Position line) const {
+    return styles(LineStart(line), LineEnd(line) - LineStart(line));
+  }
+
+  // IDocument interface
+  //
+
+  int SCI_METHOD MemoryDocument::Version() const {
+    return Scintilla::dvRelease4;
+  }
+
+  void SCI_METHOD MemoryDocument::SetErrorStatus(int status) {
+    errorStatus = status;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::Length() const {
+    return static_cast<Sci_Position>(content.size());
+  }
+
+  void SCI_METHOD MemoryDocument::GetCharRange(char* buffer, Sci_Position position, Sci_Position lengthRetrieve) const {
+    // Same as Scintilla, the part of the range that is out of the document is filled with blanks
+    for (Sci_Position i = 0; i < lengthRetrieve; i++) {
+      Sci_Position current = position + i;
+      buffer[i] = (current >= 0 && current < Length()) ? content[static_cast<size_t>(current)] : ' ';
+    }
+  }
+
+  char SCI_METHOD MemoryDocument::StyleAt(Sci_Position position) const {
+    return (position >= 0 && position < Length()) ? styleBytes[static_cast<size_t>(position)] : '\0';
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::LineFromPosition(Sci_Position position) const {
+    if (position <= 0) {
+      return 0;
+    }
+    auto iterLine = std::upper_bound(lineStarts.begin(), lineStarts.end(), position);
+    return static_cast<Sci_Position>(iterLine - lineStarts.begin()) - 1;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::LineStart(Sci_Position line) const {
+    if (line <= 0) {
+      return 0;
+    }
+    return (line < lineCount()) ? lineStarts[static_cast<size_t>(line)] : Length();
+  }
+
+  int SCI_METHOD MemoryDocument::GetLevel(Sci_Position line) const {
+    return (line >= 0 && line < lineCount()) ? levels[static_cast<size_t>(line)] : SC_FOLDLEVELBASE;
+  }
+
+  int SCI_METHOD MemoryDocument::SetLevel(Sci_Position line, int level) {
+    if (line < 0 || line >= lineCount()) {
+      return SC_FOLDLEVELBASE;
+    }
+    return std::exchange(levels[static_cast<size_t>(line)], level);
+  }
+
+  int SCI_METHOD MemoryDocument::GetLineState(Sci_Position line) const {
+    return (line >= 0 && line < lineCount()) ? lineStates[static_cast<size_t>(line)] : 0;
+  }
+
+  int SCI_METHOD MemoryDocument::SetLineState(Sci_Position line, int state) {
+    if (line < 0 || line >= lineCount()) {
+      return 0;
+    }
+    return std::exchange(lineStates[static_cast<size_t>(line)], state);
+  }
+
+  void SCI_METHOD MemoryDocument::StartStyling(Sci_Position position) {
+    stylingPosition = std::clamp(position, Sci_Position(0), Length());
+    styledEnd = stylingPosition;
+  }
+
+  bool SCI_METHOD MemoryDocument::SetStyleFor(Sci_Position length, char style) {
+    if (length < 0 || stylingPosition + length > Length()) {
+      return false;
+    }
+    std::fill_n(styleBytes.begin() + stylingPosition, length, style);
+    stylingPosition += length;
+    styledEnd = stylingPosition;
+    return true;
+  }
+
+  bool SCI_METHOD MemoryDocument::SetStyles(Sci_Position length, const char* styles) {
+    if (length < 0 || stylingPosition + length > Length()) {
+      return false;
+    }
+    std::copy_n(styles, length, styleBytes.begin() + stylingPosition);
+    stylingPosition += length;
+    styledEnd = stylingPosition;
+    return true;
+  }
+
+  void SCI_METHOD MemoryDocument::DecorationSetCurrentIndicator(int indicator) {
+  }
+
+  void SCI_METHOD MemoryDocument::DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) {
+  }
+
+  void SCI_METHOD MemoryDocument::ChangeLexerState(Sci_Position start, Sci_Position end) {
+    styledEnd = (std::min)(styledEnd, start);
+  }
+
+  int SCI_METHOD MemoryDocument::CodePage() const {
+    return codePage;
+  }
+
+  bool SCI_METHOD MemoryDocument::IsDBCSLeadByte(char ch) const {
+    // Only single byte and UTF-8 documents are supported
+    return false;
+  }
+
+  const char* SCI_METHOD MemoryDocument::BufferPointer() {
+    return content.c_str();
+  }
+
+  int SCI_METHOD MemoryDocument::GetLineIndentation(Sci_Position line) {
+    int indentation = 0;
+    for (Sci_Position position = LineStart(line); position < LineEnd(line); position++) {
+      char ch = content[static_cast<size_t>(position)];
+      if (ch == ' ') {
+        indentation++;
+      } else if (ch == '\t') {
+        indentation = (indentation / 4 + 1) * 4;
+      } else {
+        break;
+      }
+    }
+    return indentation;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::LineEnd(Sci_Position line) const {
+    if (line < 0 || line >= lineCount() - 1) {
+      return (line < 0) ? 0 : Length();
+    }
+    Sci_Position position = LineStart(line + 1);
+    if (position > 0 && content[static_cast<size_t>(position - 1)] == '\n') {
+      position--;
+      if (position > LineStart(line) && content[static_cast<size_t>(position - 1)] == '\r') {
+        position--;
+      }
+    } else if (position > 0 && content[static_cast<size_t>(position - 1)] == '\r') {
+      position--;
+    }
+    return position;
+  }
+
+  Sci_Position SCI_METHOD MemoryDocument::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const {
+    Sci_Position position = positionStart;
+    for (; characterOffset > 0 && position < Length(); characterOffset--) {
+      Sci_Position width = 1;
+      GetCharacterAndWidth(position, &width);
+      position += width;
+    }
+    for (; characterOffset < 0 && position > 0; characterOffset++) {
+      position--;
+      while (codePage == SC_CP_UTF8 && position > 0 && (static_cast<unsigned char>(content[static_cast<size_t>(position)]) & 0xC0) == 0x80) {
+        position--;
+      }
+    }
+    return (characterOffset == 0) ? position : -1;
+  }
+
+  int SCI_METHOD MemoryDocument::GetCharacterAndWidth(Sci_Position position, Sci_Position* pWidth) const {
+    Sci_Position width = 1;
+    int ch = (position >= 0 && position < Length()) ? static_cast<unsigned char>(content[static_cast<size_t>(position)]) : 0;
+    if (codePage == SC_CP_UTF8 && ch >= 0x80) {
+      // Same as Scintilla, an invalid byte is reported as a character in the low surrogate range
+      int length = (ch >= 0xF0 && ch < 0xF8) ? 4 : (ch >= 0xE0) ? 3 : (ch >= 0xC2) ? 2 : 0;
+      int value = ch & ((length == 4) ? 0x07 : (length == 3) ? 0x0F : 0x1F);
+      bool valid = (length > 0 && position + length <= Length());
+      for (int i = 1; valid && i < length; i++) {
+        unsigned char trail = static_cast<unsigned char>(content[static_cast<size_t>(position + i)]);
+        valid = ((trail & 0xC0) == 0x80);
+        value = (value << 6) | (trail & 0x3F);
+      }
+      if (valid) {
+        ch = value;
+        width = length;
+      } else {
+        ch = 0xDC80 + ch;
+      }
+    }
+    if (pWidth) {
+      *pWidth = width;
+    }
+    return ch;
+  }
+
+  // Private methods
+  //
+
+  void MemoryDocument::updateLineStarts() {
+    lineStarts.assign(1, 0);
+    for (size_t i = 0; i < content.size(); i++) {
+      if (content[i] == '\n' || (content[i] == '\r' && (i + 1 >= content.size() || content[i + 1] != '\n'))) {
+        lineStarts.push_back(static_cast<Sci_Position>(i + 1));
+      }
+    }
+  }
+
+  void MemoryDocument::modified(Sci_Position line, Sci_Position linesAdded, Sci_Position position) {
+    // New lines take the level of the modified line, same as in Scintilla
+    size_t nextLine = static_cast<size_t>(line) + 1;
+    if (linesAdded > 0) {
+      levels.insert(levels.begin() + nextLine, static_cast<size_t>(linesAdded), levels[static_cast<size_t>(line)]);
+      lineStates.insert(lineStates.begin() + nextLine, static_cast<size_t>(linesAdded), 0);
+    } else if (linesAdded < 0) {
+      levels.erase(levels.begin() + nextLine, levels.begin() + nextLine - linesAdded);
+      lineStates.erase(lineStates.begin() + nextLine, lineStates.begin() + nextLine - linesAdded);
+    }
+    styledEnd = (std::min)(styledEnd, position);
+  }
+
+} // namespace
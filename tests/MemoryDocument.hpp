@@ -0,0 +1,103 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "external/scintilla/ILexer.h"
+#include "external/scintilla/Scintilla.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace papyrus {
+
+  // In-memory implementation of the document interface Scintilla provides to lexers, so a lexer can be run without
+  // Notepad++. Text, styles and fold levels are kept the way Scintilla keeps them: styles per byte, levels per line, and
+  // lines end with CR LF, LF or a lone CR.
+  //
+  // Edits return the SCN_MODIFIED notification Scintilla would send for them, which can be passed on to the lexer or
+  // withheld to act like an edit made through a view the lexer doesn't hear from.
+  //
+  class MemoryDocument : public Scintilla::IDocument {
+    public:
+      explicit MemoryDocument(std::string_view text = std::string_view(), int codePage = SC_CP_UTF8);
+
+      inline const std::string& text() const { return content; }
+      inline Sci_Position lineCount() const { return static_cast<Sci_Position>(lineStarts.size()); }
+
+      // End of styled text. Lowered by edits, same as in Scintilla, so restyling can start from there.
+      inline Sci_Position endStyled() const { return styledEnd; }
+
+      // Edit text, returning the notification of the modification
+      SCNotification insertText(Sci_Position position, std::string_view text);
+      SCNotification deleteText(Sci_Position position, Sci_Position length);
+
+      // Styles of a range of text, or of a whole line without its line end
+      std::string styles(Sci_Position position, Sci_Position length) const;
+      std::string lineStyles(Sci_Position line) const;
+
+      // IDocument interface
+      int SCI_METHOD Version() const override;
+      void SCI_METHOD SetErrorStatus(int status) override;
+      Sci_Position SCI_METHOD Length() const override;
+      void SCI_METHOD GetCharRange(char* buffer, Sci_Position position, Sci_Position lengthRetrieve) const override;
+      char SCI_METHOD StyleAt(Sci_Position position) const override;
+      Sci_Position SCI_METHOD LineFromPosition(Sci_Position position) const override;
+      Sci_Position SCI_METHOD LineStart(Sci_Position line) const override;
+      int SCI_METHOD GetLevel(Sci_Position line) const override;
+      int SCI_METHOD SetLevel(Sci_Position line, int level) override;
+      int SCI_METHOD GetLineState(Sci_Position line) const override;
+      int SCI_METHOD SetLineState(Sci_Position line, int state) override;
+      void SCI_METHOD StartStyling(Sci_Position position) override;
+      bool SCI_METHOD SetStyleFor(Sci_Position length, char style) override;
+      bool SCI_METHOD SetStyles(Sci_Position length, const char* styles) override;
+      void SCI_METHOD DecorationSetCurrentIndicator(int indicator) override;
+      void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+      void SCI_METHOD ChangeLexerState(Sci_Position start, Sci_Position end) override;
+      int SCI_METHOD CodePage() const override;
+      bool SCI_METHOD IsDBCSLeadByte(char ch) const override;
+      const char* SCI_METHOD BufferPointer() override;
+      int SCI_METHOD GetLineIndentation(Sci_Position line) override;
+      Sci_Position SCI_METHOD LineEnd(Sci_Position line) const override;
+      Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const override;
+      int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position* pWidth) const override;
+
+    private:
+      // Find line starts again after text is modified
+      void updateLineStarts();
+
+      // Adjust per line data for lines added or removed after the given line, and lower end of styled text
+      void modified(Sci_Position line, Sci_Position linesAdded, Sci_Position position);
+
+      // Private members
+      //
+      std::string content;
+      std::string styleBytes;
+      std::vector<Sci_Position> lineStarts;
+      std::vector<int> levels;
+      std::vector<int> lineStates;
+      int codePage;
+      Sci_Position stylingPosition {0};
+      Sci_Position styledEnd {0};
+      int errorStatus {0};
+  };
+
+} // namespace
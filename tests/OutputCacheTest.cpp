@@ -0,0 +1,194 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Check.hpp"
+
+#include "Plugin/Compiler/OutputCache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace papyrus;
+
+namespace {
+  // Every compiled output is 8 bytes, so capacity can be given in number of entries
+  constexpr uint64_t outputSize = 8;
+
+  struct Workspace {
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "PapyrusOutputCacheTest";
+    std::filesystem::path cacheDirectory = root / "cache";
+    std::filesystem::path sourceDirectory = root / "source";
+    std::filesystem::path outputDirectory = root / "output";
+
+    Workspace() {
+      std::filesystem::remove_all(root);
+      std::filesystem::create_directories(sourceDirectory);
+      std::filesystem::create_directories(outputDirectory);
+      write(root / "compiler.exe", "compiler");
+    }
+
+    ~Workspace() {
+      std::filesystem::remove_all(root);
+    }
+
+    void write(const std::filesystem::path& file, const std::string& content) const {
+      std::ofstream(file, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    std::string read(const std::filesystem::path& file) const {
+      std::ifstream stream(file, std::ios::binary);
+      return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    std::wstring compiler() const { return (root / "compiler.exe").wstring(); }
+    std::wstring source(const std::string& name) const { return (sourceDirectory / (name + ".psc")).wstring(); }
+    std::wstring output(const std::string& name) const { return (outputDirectory / (name + ".pex")).wstring(); }
+
+    // Write an output file with the given name as content, padded to output size, and store it in the cache
+    void storeOutput(OutputCache& cache, const std::wstring& key, const std::string& name) const {
+      write(output(name), (name + "________").substr(0, outputSize));
+      cache.store({{key, output(name)}});
+    }
+  };
+}
+
+TEST_CASE(keysDependOnlyOnContentsAndNames) {
+  Workspace workspace;
+  workspace.write(workspace.source("top"), "Scriptname Top\n");
+  workspace.write(workspace.source("base"), "Scriptname Base\n");
+  std::vector<std::wstring> inputs {workspace.source("top"), workspace.source("base")};
+
+  OutputCache cache(16 * outputSize);
+  auto key = cache.computeKey(inputs, workspace.compiler(), L"signature");
+  CHECK(key.has_value());
+  CHECK(key == cache.computeKey(inputs, workspace.compiler(), L"signature"));
+  CHECK(key == OutputCache(16 * outputSize).computeKey(inputs, workspace.compiler(), L"signature"));
+  CHECK(key != cache.computeKey(inputs, workspace.compiler(), L"other signature"));
+
+  // A dependency only matters by its name and content, not where it's found
+  std::filesystem::create_directories(workspace.root / "import");
+  std::wstring movedBase = (workspace.root / "import" / "base.psc").wstring();
+  workspace.write(movedBase, "Scriptname Base\n");
+  CHECK(key == cache.computeKey({workspace.source("top"), movedBase}, workspace.compiler(), L"signature"));
+
+  // Rewriting a file with the same content keeps the key, while changing it doesn't
+  std::filesystem::last_write_time(workspace.source("base"), std::filesystem::file_time_type::clock::now() + std::chrono::seconds(10));
+  CHECK(key == cache.computeKey(inputs, workspace.compiler(), L"signature"));
+  workspace.write(workspace.source("base"), "Scriptname Base Hidden\n");
+  CHECK(key != cache.computeKey(inputs, workspace.compiler(), L"signature"));
+
+  CHECK(!cache.computeKey({workspace.source("missing")}, workspace.compiler(), L"signature"));
+  CHECK(!cache.computeKey(inputs, (workspace.root / "missing.exe").wstring(), L"signature"));
+}
+
+TEST_CASE(restoresAllOrNothing) {
+  Workspace workspace;
+  OutputCache cache(16 * outputSize);
+  cache.open(workspace.cacheDirectory);
+  workspace.storeOutput(cache, L"a", "a");
+  std::filesystem::remove(workspace.output("a"));
+
+  CHECK(!cache.restore({{L"a", workspace.output("a")}, {L"b", workspace.output("b")}}));
+  CHECK(!std::filesystem::exists(workspace.output("a")));
+
+  CHECK(cache.restore({{L"a", workspace.output("a")}}));
+  CHECK_EQUAL(std::string("a_______"), workspace.read(workspace.output("a")));
+
+  // Nothing is restored before the cache is opened
+  OutputCache unopened(16 * outputSize);
+  CHECK(!unopened.restore({{L"a", workspace.output("a")}}));
+}
+
+TEST_CASE(evictsLeastRecentlyUsedEntries) {
+  Workspace workspace;
+  {
+    OutputCache cache(2 * outputSize);
+    cache.open(workspace.cacheDirectory);
+    workspace.storeOutput(cache, L"a", "a");
+    workspace.storeOutput(cache, L"b", "b");
+    CHECK(cache.restore({{L"a", workspace.output("a")}}));
+    workspace.storeOutput(cache, L"c", "c");
+
+    CHECK(!cache.restore({{L"b", workspace.output("b")}}));
+    CHECK(cache.restore({{L"c", workspace.output("c")}}));
+    CHECK(cache.restore({{L"a", workspace.output("a")}}));
+  }
+
+  // Recency is kept across sessions, so a smaller cache keeps the most recently restored entry
+  OutputCache cache(outputSize);
+  cache.open(workspace.cacheDirectory);
+  CHECK(cache.restore({{L"a", workspace.output("a")}}));
+  CHECK(!cache.restore({{L"c", workspace.output("c")}}));
+  CHECK_EQUAL(1u, cache.statistics().evictions);
+}
+
+TEST_CASE(staysWithinCapacityWhileEntriesArePinned) {
+  Workspace workspace;
+  OutputCache cache(outputSize);
+  cache.open(workspace.cacheDirectory);
+  workspace.storeOutput(cache, L"pinned", "pinned");
+
+  // Stores evict while the entry being restored is pinned, and whatever was held back is evicted once restores are done
+  std::thread restorer([&] {
+    for (int i = 0; i < 200; i++) {
+      if (cache.restore({{L"pinned", workspace.output("restored")}})) {
+        CHECK_EQUAL(std::string("pinned__"), workspace.read(workspace.output("restored")));
+      }
+    }
+  });
+  for (int i = 0; i < 200; i++) {
+    workspace.storeOutput(cache, L"stored" + std::to_wstring(i), "stored");
+  }
+  restorer.join();
+
+  auto statistics = cache.statistics();
+  CHECK_EQUAL(200u, statistics.hits + statistics.misses);
+  CHECK(statistics.totalSize <= outputSize);
+  CHECK_EQUAL(statistics.entries, static_cast<size_t>(std::distance(std::filesystem::directory_iterator(workspace.cacheDirectory), std::filesystem::directory_iterator())));
+}
+
+TEST_CASE(countsHitsMissesStoresAndEvictions) {
+  Workspace workspace;
+  OutputCache cache(2 * outputSize);
+  cache.open(workspace.cacheDirectory);
+  workspace.storeOutput(cache, L"a", "a");
+  workspace.storeOutput(cache, L"b", "b");
+  workspace.storeOutput(cache, L"b", "b");
+  CHECK(cache.restore({{L"a", workspace.output("a")}, {L"b", workspace.output("b")}}));
+  CHECK(!cache.restore({{L"a", workspace.output("a")}, {L"c", workspace.output("c")}}));
+  workspace.storeOutput(cache, L"c", "c");
+
+  auto statistics = cache.statistics();
+  CHECK_EQUAL(2u, statistics.hits);
+  CHECK_EQUAL(2u, statistics.misses);
+  CHECK_EQUAL(4u, statistics.stores);
+  CHECK_EQUAL(1u, statistics.evictions);
+  CHECK_EQUAL(2u, statistics.entries);
+  CHECK_EQUAL(2 * outputSize, statistics.totalSize);
+}
+
+int main() {
+  return papyrus::test::runTests();
+}
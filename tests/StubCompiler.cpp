@@ -0,0 +1,73 @@
+/*
+This file is part of Papyrus Plugin for Notepad++.
+
+Copyright (C) 2021 blu3mania <blu3mania@hotmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Stand-in for Papyrus compiler used by compiler process tests. Its behavior is selected by the first argument:
+//   flood <count>       write the given number of lines to both stdout and stderr, more than any pipe buffer holds
+//   handshake <file>    report an error on stderr, then wait for the given file to be created by whoever reads it
+//   hang                sleep until killed
+//   exit <code>         exit with the given code
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#define HANDSHAKE_TIMEOUT  10   // Seconds to wait for handshake file before giving up
+#define HANG_TIME          120  // Seconds to sleep when asked to hang
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    return 2;
+  }
+
+  if (std::strcmp(argv[1], "flood") == 0 && argc > 2) {
+    int count = std::atoi(argv[2]);
+    for (int i = 0; i < count; i++) {
+      std::fprintf(stdout, "Compiling line %d of a very chatty compiler run\n", i);
+      std::fprintf(stderr, "C:\\Scripts\\Flood.psc(%d,1): error %d\n", i + 1, i);
+    }
+    return 0;
+  }
+
+  if (std::strcmp(argv[1], "handshake") == 0 && argc > 2) {
+    std::fprintf(stderr, "C:\\Scripts\\Handshake.psc(1,1): waiting for reader\n");
+    std::fflush(stderr);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(HANDSHAKE_TIMEOUT);
+    while (!std::filesystem::exists(argv[2])) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return 3;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return 0;
+  }
+
+  if (std::strcmp(argv[1], "hang") == 0) {
+    std::this_thread::sleep_for(std::chrono::seconds(HANG_TIME));
+    return 0;
+  }
+
+  if (std::strcmp(argv[1], "exit") == 0 && argc > 2) {
+    return std::atoi(argv[2]);
+  }
+
+  return 2;
+}